@@ -41,6 +41,10 @@ if("${CB_STATS}" STREQUAL "on")
   add_definitions(-DZJS_PRINT_CALLBACK_STATS)
 endif()
 
+if("${CB_TRACE}" STREQUAL "on")
+  add_definitions(-DZJS_TRACE_CALLBACKS)
+endif()
+
 if("${VARIANT}" STREQUAL "debug")
   add_definitions(-DDEBUG_BUILD -DOC_DEBUG)
 endif()
@@ -70,7 +74,11 @@ set(APP_SRC
   src/zjs_callbacks.c
   src/zjs_common.c
   src/zjs_error.c
+  src/zjs_hrtime.c
+  src/zjs_loop_stats.c
   src/zjs_modules.c
+  src/zjs_mpsc_queue.c
+  src/zjs_msgblock.c
   src/zjs_script.c
   src/zjs_timers.c
   src/zjs_util.c
@@ -11,6 +11,10 @@ set(JERRY_PROFILE es2015-subset)
 
 set(JERRY_LIBDIR ${CMAKE_BINARY_DIR}/jerry)
 
+if(NOT MEM_STATS)
+  set(MEM_STATS off)
+endif()
+
 # define the modules that will be pulled into the linux build
 set(LINUX_MODULES "zjs_board.json, zjs_buffer.json, zjs_console.json, zjs_event.json, zjs_gpio.json,")
 
@@ -29,14 +33,20 @@ set(APP_SRC
   ${CMAKE_SOURCE_DIR}/src/zjs_common.c
   ${CMAKE_SOURCE_DIR}/src/zjs_console.c
   ${CMAKE_SOURCE_DIR}/src/zjs_error.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_hrtime.c
   ${CMAKE_SOURCE_DIR}/src/zjs_event.c
   ${CMAKE_SOURCE_DIR}/src/zjs_gpio.c
   ${CMAKE_SOURCE_DIR}/src/zjs_gpio_mock.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_linux_loop.c
   ${CMAKE_SOURCE_DIR}/src/zjs_linux_ring_buffer.c
   ${CMAKE_SOURCE_DIR}/src/zjs_linux_time.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_loop_stats.c
   ${CMAKE_SOURCE_DIR}/src/zjs_modules.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_mpsc_queue.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_msgblock.c
   ${CMAKE_SOURCE_DIR}/src/zjs_performance.c
   ${CMAKE_SOURCE_DIR}/src/zjs_script.c
+  ${CMAKE_SOURCE_DIR}/src/zjs_snapshot_cache.c
   ${CMAKE_SOURCE_DIR}/src/zjs_timers.c
   ${CMAKE_SOURCE_DIR}/src/zjs_test_promise.c
   ${CMAKE_SOURCE_DIR}/src/zjs_test_callbacks.c
@@ -69,6 +79,8 @@ add_definitions(
   -DZJS_LINUX_BUILD
   -DZJS_GPIO_MOCK
   -DZJS_FIND_FUNC_NAME
+  -DZJS_LOOP_STATS
+  -DZJS_CALLBACK_TUNING
   )
 
 set(APP_COMPILE_OPTIONS
@@ -81,6 +93,10 @@ if("${CB_STATS}" STREQUAL "on")
   add_definitions(-DZJS_PRINT_CALLBACK_STATS)
 endif()
 
+if("${CB_TRACE}" STREQUAL "on")
+  add_definitions(-DZJS_TRACE_CALLBACKS)
+endif()
+
 if("${VARIANT}" STREQUAL "debug")
   add_definitions(-DDEBUG_BUILD -DOC_DEBUG)
   list(APPEND APP_COMPILE_OPTIONS -g)
@@ -171,6 +187,9 @@ add_custom_command(
     --jerry-cmdline=OFF
     --jerry-libc=OFF
     --jerry-debugger=${DEBUGGER}
+    --mem-stats=${MEM_STATS}
+    --snapshot-exec=ON
+    --snapshot-save=ON
   )
 
 add_executable(jslinux ${APP_SRC})
@@ -36,6 +36,7 @@
 // Platform agnostic modules/headers
 #include "zjs_callbacks.h"
 #include "zjs_error.h"
+#include "zjs_loop_stats.h"
 #include "zjs_modules.h"
 #ifdef BUILD_MODULE_SENSOR
 #include "zjs_sensor.h"
@@ -48,6 +49,7 @@
 #include "zjs_ble.h"
 #endif
 #ifdef ZJS_LINUX_BUILD
+#include "zjs_snapshot_cache.h"
 #include "zjs_unit_tests.h"
 #endif
 #ifdef CONFIG_BOARD_ARDUINO_101
@@ -88,6 +90,18 @@ static u8_t no_exit = 0;
 static u32_t exit_after = 0;
 static struct timespec exit_timer;
 
+// returns the sooner of two wait times, where ZJS_TICKS_FOREVER means no limit
+static s32_t min_wait(s32_t a, s32_t b)
+{
+    if (a == ZJS_TICKS_FOREVER) {
+        return b;
+    }
+    if (b == ZJS_TICKS_FOREVER) {
+        return a;
+    }
+    return (a < b) ? a : b;
+}
+
 u8_t process_cmd_line(int argc, char *argv[])
 {
     int i;
@@ -105,6 +119,21 @@ u8_t process_cmd_line(int argc, char *argv[])
 #endif
         } else if (!strncmp(argv[i], "--noexit", 8)) {
             no_exit = 1;
+        } else if (!strncmp(argv[i], "--loopstats", 11)) {
+            // report main loop sleep/wakeup statistics on exit
+            atexit(zjs_loop_print_stats);
+#ifdef ZJS_LOOP_STATS
+            atexit(zjs_loop_stats_print);
+#endif
+        } else if (!strncmp(argv[i], "--snapshot-cache", 16)) {
+            if (i == argc - 1) {
+                ERR_PRINT("no directory given after '--snapshot-cache'\n");
+                return 0;
+            }
+            // save parsed scripts and modules, and reuse them next time
+            if (!zjs_snapshot_cache_init(argv[i + 1])) {
+                return 0;
+            }
         } else if (!strncmp(argv[i], "-t", 2)) {
             if (i == argc - 1) {
                 // no time argument, return error
@@ -198,13 +227,13 @@ int main(int argc, char *argv[])
     file_name = "js.tmp";
     file_name_len = strlen("js.tmp");
 #endif
-    jerry_value_t code_eval;
+    jerry_value_t code_eval = ZJS_UNDEFINED;
     u32_t script_len = 0;
 #endif
 #ifndef ZJS_LINUX_BUILD
     DBG_PRINT("Main Thread ID: %p\n", (void *)k_current_get());
-    zjs_loop_init();
 #endif
+    zjs_loop_init();
     jerry_value_t result;
 
     // print newline here to make it easier to find
@@ -214,6 +243,9 @@ int main(int argc, char *argv[])
     jerry_init(JERRY_INIT_EMPTY);
     // initialize modules
     zjs_modules_init();
+#if defined(ZJS_LINUX_BUILD) && defined(ZJS_TRACE_CALLBACKS)
+    atexit(zjs_dump_callback_trace);
+#endif
 
 #ifdef BUILD_MODULE_OCF
     zjs_register_service_routine(NULL, main_poll_routine);
@@ -289,20 +321,31 @@ int main(int argc, char *argv[])
     if (start_debug_server) {
         ZJS_PRINT("Debugger mode: connect using jerry-client-ws.py\n\n");
         jerry_debugger_init(debug_port);
+#ifdef ZJS_LINUX_BUILD
+        // snapshots carry no source for the debugger to show
+        zjs_snapshot_cache_init(NULL);
+#endif
     }
 #endif
 
 #ifndef ZJS_SNAPSHOT_BUILD
-    code_eval = jerry_parse((jerry_char_t *)file_name,
-                            file_name_len,
-                            (jerry_char_t *)script,
-                            script_len,
-                            JERRY_PARSE_NO_OPTS);
-
-    if (jerry_value_is_error(code_eval)) {
-        DBG_PRINT("Error parsing JS\n");
-        zjs_print_error_message(code_eval, ZJS_UNDEFINED);
-        goto error;
+    bool from_snapshot = false;
+#ifdef ZJS_LINUX_BUILD
+    from_snapshot = zjs_snapshot_cache_run(file_name, script, script_len,
+                                           &result);
+#endif
+    if (!from_snapshot) {
+        code_eval = jerry_parse((jerry_char_t *)file_name,
+                                file_name_len,
+                                (jerry_char_t *)script,
+                                script_len,
+                                JERRY_PARSE_NO_OPTS);
+
+        if (jerry_value_is_error(code_eval)) {
+            DBG_PRINT("Error parsing JS\n");
+            zjs_print_error_message(code_eval, ZJS_UNDEFINED);
+            goto error;
+        }
     }
 #endif
 
@@ -317,7 +360,9 @@ int main(int argc, char *argv[])
                                  JERRY_SNAPSHOT_EXEC_COPY_DATA);
 
 #else
-    result = jerry_run(code_eval);
+    if (!from_snapshot) {
+        result = jerry_run(code_eval);
+    }
 #endif
 
     if (jerry_value_is_error(result)) {
@@ -367,6 +412,9 @@ int main(int argc, char *argv[])
         zjs_ashell_init();
     }
 #endif
+    // ticks queued by the main script run before anything else
+    zjs_timers_process_ticks();
+    zjs_loop_stats_init();
     while (1) {
 #ifdef ZJS_DYNAMIC_LOAD
         // Check if we should load a new JS file
@@ -387,25 +435,43 @@ int main(int argc, char *argv[])
             // FIXME: need to consider the chicken and egg problems here
             serviced = 1;
         }
+        zjs_loop_stats_mark(ZJS_PHASE_CALLBACKS);
 #ifdef ZJS_LINUX_BUILD
         // FIXME - reverted patch #1542 to old timer implementation
-        u64_t wait = zjs_timers_process_events();
+        s32_t wait = zjs_timers_process_events();
         if (wait != ZJS_TICKS_FOREVER) {
             serviced = 1;
-            wait_time = (wait < wait_time) ? wait : wait_time;
+            wait_time = min_wait(wait, wait_time);
         }
+        zjs_loop_stats_mark(ZJS_PHASE_TIMERS);
         wait = zjs_service_routines();
+        if (wait != ZJS_TICKS_FOREVER) {
+            serviced = 1;
+            wait_time = min_wait(wait, wait_time);
+        }
 #else
         u64_t wait = zjs_service_routines();
-#endif
         if (wait != ZJS_TICKS_FOREVER) {
             serviced = 1;
             wait_time = (wait < wait_time) ? wait : wait_time;
         }
+#endif
+        zjs_loop_stats_mark(ZJS_PHASE_ROUTINES);
         // callback cannot return a wait time
         if (zjs_service_callbacks()) {
             serviced = 1;
         }
+        zjs_loop_stats_mark(ZJS_PHASE_CALLBACKS);
+
+        // immediates run after I/O callbacks, then ticks, so anything queued
+        //   with process.nextTick() runs ahead of promise jobs
+        if (zjs_timers_process_immediates()) {
+            serviced = 1;
+        }
+        if (zjs_timers_process_ticks()) {
+            serviced = 1;
+        }
+        zjs_loop_stats_mark(ZJS_PHASE_IMMEDIATES);
 
 #ifdef BUILD_MODULE_PROMISE
         // run queued jobs for promises
@@ -415,11 +481,15 @@ int main(int argc, char *argv[])
             zjs_print_error_message(result, ZJS_UNDEFINED);
             goto error;
         }
+        zjs_loop_stats_mark(ZJS_PHASE_JOBS);
 #endif
+        if (zjs_timers_calls_pending() || zjs_callbacks_pending()) {
+            // more immediates or ticks were queued, or callbacks were left
+            //   over when the budget ran out, so don't sleep
+            serviced = 1;
+            wait_time = ZJS_TICKS_NONE;
+        }
 
-#ifndef ZJS_LINUX_BUILD
-        zjs_loop_block(wait_time);
-#endif
 #ifdef ZJS_LINUX_BUILD
         if (!no_exit) {
             // if the last and current loop had no pending "events" (timers or
@@ -430,6 +500,10 @@ int main(int argc, char *argv[])
                 ZJS_PRINT("   * to run your script for a set timeout, use -t <ms>\n");
                 return 0;
             }
+            if (serviced == 0) {
+                // don't sleep, so the next pass can decide whether to exit
+                wait_time = ZJS_TICKS_NONE;
+            }
         }
         if (exit_after != 0) {
             // an exit timeout was passed in
@@ -442,9 +516,13 @@ int main(int argc, char *argv[])
                           (unsigned int)elapsed);
                 return 0;
             }
+            wait_time = min_wait(wait_time, exit_after - elapsed);
         }
         last_serviced = serviced;
 #endif
+        zjs_loop_block(wait_time);
+        zjs_loop_stats_mark(ZJS_PHASE_IDLE);
+        zjs_loop_stats_iteration();
     }
 error:
 #ifdef ZJS_LINUX_BUILD
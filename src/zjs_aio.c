@@ -98,6 +98,8 @@ static ZJS_DECL_FUNC_ARGS(aio_pin_read, bool async)
                            "readAsync");
 #endif
         zjs_callback_id id = zjs_add_callback_once(argv[0], this, NULL, NULL);
+        // service with other hardware events rather than behind timers
+        zjs_set_callback_lane(id, ZJS_CB_LANE_HW);
         zjs_signal_callback(id, &result, sizeof(result));
         return ZJS_UNDEFINED;
     } else {
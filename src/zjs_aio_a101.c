@@ -176,6 +176,8 @@ static jerry_value_t aio_pin_read(const jerry_value_t function_obj,
                            "readAsync");
 #endif
         zjs_callback_id id = zjs_add_callback_once(argv[0], this, NULL, NULL);
+        // service with other hardware events rather than behind timers
+        zjs_set_callback_lane(id, ZJS_CB_LANE_HW);
         zjs_signal_callback(id, &result, sizeof(result));
         return ZJS_UNDEFINED;
     } else {
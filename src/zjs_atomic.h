@@ -0,0 +1,38 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_atomic_h__
+#define __zjs_atomic_h__
+
+// Atomic operations on 32-bit words, safe to use from ISRs and other threads
+
+#ifdef ZJS_LINUX_BUILD
+#include "zjs_linux_port.h"
+typedef u32_t zjs_atomic_t;
+
+#define ZJS_ATOMIC_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ZJS_ATOMIC_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ZJS_ATOMIC_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+// these return the value from before the operation
+#define ZJS_ATOMIC_INC(p)       __atomic_fetch_add((p), 1, __ATOMIC_ACQ_REL)
+#define ZJS_ATOMIC_DEC(p)       __atomic_fetch_sub((p), 1, __ATOMIC_ACQ_REL)
+#define ZJS_ATOMIC_OR(p, v)     __atomic_fetch_or((p), (v), __ATOMIC_ACQ_REL)
+#define ZJS_ATOMIC_AND(p, v)    __atomic_fetch_and((p), (v), __ATOMIC_ACQ_REL)
+#else
+#include <atomic.h>
+#include <zephyr.h>
+typedef atomic_t zjs_atomic_t;
+
+#define ZJS_ATOMIC_LOAD(p)      ((u32_t)atomic_get((atomic_t *)(p)))
+#define ZJS_ATOMIC_STORE(p, v)  atomic_set((atomic_t *)(p), (atomic_val_t)(v))
+#define ZJS_ATOMIC_CAS(p, o, n) \
+    atomic_cas((atomic_t *)(p), (atomic_val_t)(o), (atomic_val_t)(n))
+// these return the value from before the operation
+#define ZJS_ATOMIC_INC(p)       ((u32_t)atomic_inc((atomic_t *)(p)))
+#define ZJS_ATOMIC_DEC(p)       ((u32_t)atomic_dec((atomic_t *)(p)))
+#define ZJS_ATOMIC_OR(p, v) \
+    ((u32_t)atomic_or((atomic_t *)(p), (atomic_val_t)(v)))
+#define ZJS_ATOMIC_AND(p, v) \
+    ((u32_t)atomic_and((atomic_t *)(p), (atomic_val_t)(v)))
+#endif
+
+#endif  // __zjs_atomic_h__
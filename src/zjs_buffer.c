@@ -13,22 +13,121 @@
 #include "zjs_common.h"
 #include "zjs_util.h"
 
+// most free blocks kept for reuse in each size class
+#ifndef ZJS_BUFFER_POOL_MAX
+#ifdef ZJS_LINUX_BUILD
+#define ZJS_BUFFER_POOL_MAX 64
+#else
+#define ZJS_BUFFER_POOL_MAX 4
+#endif
+#endif
+
+// buffers keep their data in the same block as their zjs_buffer_t; blocks
+//   for buffers up to the largest size class are rounded up to a class size
+//   and kept on a free list when freed, since packet handlers churn through
+//   many small buffers
+static const u16_t class_sizes[] = { 16, 32, 64, 128 };
+#define CLASS_COUNT (sizeof(class_sizes) / sizeof(u16_t))
+
+typedef struct buffer_class {
+    zjs_buffer_t *free;  // free blocks, linked through owner
+    u32_t free_count;
+    u32_t hits;          // allocations served from the free list
+    u32_t misses;        // allocations that had to malloc
+} buffer_class_t;
+
+static buffer_class_t classes[CLASS_COUNT];
+// allocations too large for any size class
+static u32_t unpooled = 0;
+
 static jerry_value_t zjs_buffer_prototype;
+// true when JerryScript has typed arrays, so buffers are Uint8Arrays
+static bool use_typedarray = false;
+
+static zjs_buffer_t *alloc_block(u32_t size)
+{
+    // effects: returns a buffer item with room for size bytes of data after
+    //            it, or NULL if out of memory
+    s8_t pool = -1;
+    u32_t capacity = size;
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        if (size <= class_sizes[i]) {
+            pool = i;
+            capacity = class_sizes[i];
+            break;
+        }
+    }
+
+    zjs_buffer_t *item = NULL;
+    if (pool < 0) {
+        unpooled++;
+    } else if (classes[pool].free) {
+        item = classes[pool].free;
+        classes[pool].free = item->owner;
+        classes[pool].free_count--;
+        classes[pool].hits++;
+    } else {
+        classes[pool].misses++;
+    }
+    if (!item) {
+        item = zjs_malloc(sizeof(zjs_buffer_t) + capacity);
+        if (!item) {
+            return NULL;
+        }
+    }
+    item->buffer = (u8_t *)(item + 1);
+    item->bufsize = size;
+    item->owner = item;
+    item->refs = 1;
+    item->pool = pool;
+    return item;
+}
+
+static void free_block(zjs_buffer_t *item)
+{
+    // effects: returns item's block to its size class, or frees it
+    buffer_class_t *cls = item->pool < 0 ? NULL : &classes[item->pool];
+    if (cls && cls->free_count < ZJS_BUFFER_POOL_MAX) {
+        item->owner = cls->free;
+        cls->free = item;
+        cls->free_count++;
+    } else {
+        zjs_free(item);
+    }
+}
 
 static void zjs_buffer_callback_free(void *handle)
 {
     // requires: handle is the native pointer we registered with
     //             jerry_set_object_native_handle
-    //  effects: frees the buffer item
+    //  effects: frees the buffer item, and its memory once no views of it
+    //             remain
     zjs_buffer_t *item = (zjs_buffer_t *)handle;
-    zjs_free(item->buffer);
-    zjs_free(item);
+    zjs_buffer_t *owner = item->owner;
+    if (owner != item) {
+        zjs_free(item);
+    }
+    if (--owner->refs == 0) {
+        free_block(owner);
+    }
 }
 
 static const jerry_object_native_info_t buffer_type_info = {
     .free_cb = zjs_buffer_callback_free
 };
 
+static void zjs_buffer_release_memory(void *ptr)
+{
+    // requires: ptr is the data of a block from alloc_block, given to an
+    //             external ArrayBuffer in create_array_buffer
+    //  effects: drops the ArrayBuffer's reference to the block, freeing it
+    //             once no buffers use it
+    zjs_buffer_t *owner = (zjs_buffer_t *)ptr - 1;
+    if (--owner->refs == 0) {
+        free_block(owner);
+    }
+}
+
 bool zjs_value_is_buffer(const jerry_value_t value)
 {
     if (jerry_value_is_object(value) && zjs_buffer_find(value)) {
@@ -54,53 +153,134 @@ zjs_buffer_t *zjs_buffer_find(const jerry_value_t obj)
     return NULL;
 }
 
-static ZJS_DECL_FUNC_ARGS(zjs_buffer_read_bytes, int bytes, bool big_endian)
+// kinds of numbers a buffer can hold
+#define KIND_UINT  0
+#define KIND_INT   1
+#define KIND_FLOAT 2
+
+static inline u64_t load_bytes(const u8_t *src, int bytes, bool big_endian)
+{
+    // returns: bytes from src as an unsigned integer in the given byte order
+    u64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value <<= 8;
+        value |= src[big_endian ? i : bytes - 1 - i];
+    }
+    return value;
+}
+
+static inline void store_bytes(u8_t *dst, int bytes, bool big_endian,
+                               u64_t value)
+{
+    for (int i = 0; i < bytes; i++) {
+        dst[big_endian ? bytes - 1 - i : i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+static inline double decode_value(u64_t raw, int bytes, int kind)
+{
+    // returns: raw, the low bytes of which hold a number of the given kind,
+    //            as a double
+    if (kind == KIND_FLOAT) {
+        if (bytes == 4) {
+            u32_t bits = raw;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        double d;
+        memcpy(&d, &raw, sizeof(d));
+        return d;
+    }
+    if (kind == KIND_INT && bytes < 8 && raw >> (bytes * 8 - 1)) {
+        // sign extend
+        return (double)(s64_t)(raw | (~(u64_t)0 << (bytes * 8)));
+    }
+    return (double)raw;
+}
+
+static inline u64_t encode_value(double value, int bytes, int kind)
+{
+    // returns: value as a number of the given kind, in the low bytes
+    if (kind == KIND_FLOAT) {
+        if (bytes == 4) {
+            float f = value;
+            u32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+        u64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    // technically negatives aren't supported for unsigned writes but this
+    //   makes them behave better
+    return value < 0 ? (u64_t)(s64_t)value : (u64_t)value;
+}
+
+static inline u8_t to_uint8(double value)
+{
+    // returns: value truncated modulo 256, as JS ToUint8 does; NaN,
+    //   infinities and magnitudes of 2^63 or more, all multiples of 256 if
+    //   finite, give 0
+    if (!(value > -9223372036854775808.0 && value < 9223372036854775808.0)) {
+        return 0;
+    }
+    return (u8_t)(s64_t)value;
+}
+
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_read_value, int bytes, int kind,
+                          bool big_endian)
 {
     // requires: this is a JS buffer object created with zjs_buffer_create,
     //             argv[0] should be an offset into the buffer, but will treat
     //             offset as 0 if not given, as node.js seems to
-    //           bytes is the number of bytes to read (expects 1, 2, or 4)
+    //           bytes is the number of bytes to read (1-8), or 0 to take it
+    //             from argv[1] as in readIntLE
+    //           kind is one of the KIND_* values above
     //           big_endian true reads the bytes in big endian order, false in
     //             little endian order
     //  effects: reads bytes from the buffer associated with this JS object, if
     //             found, at the given offset, if within the bounds of the
     //             buffer; otherwise returns an error
 
-    // args: offset
-    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_NUMBER);
+    // args: offset[, byteLength]
+    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_NUMBER, Z_OPTIONAL Z_NUMBER);
 
     u32_t offset = 0;
     if (argc >= 1)
         offset = (u32_t)jerry_get_number_value(argv[0]);
 
+    if (!bytes) {
+        bytes = argc >= 2 ? (int)jerry_get_number_value(argv[1]) : 0;
+        if (bytes < 1 || bytes > 6) {
+            return RANGE_ERROR("byteLength must be 1 to 6");
+        }
+    }
+
     zjs_buffer_t *buf = zjs_buffer_find(this);
     if (!buf)
         return zjs_error("buffer not found on read");
 
-    if (offset + bytes > buf->bufsize)
+    // compare against the room left so a large offset can't wrap past it
+    if (bytes > buf->bufsize || offset > buf->bufsize - bytes)
         return zjs_error("read attempted beyond buffer");
 
-    int dir = big_endian ? 1 : -1;
-    if (!big_endian)
-        offset += bytes - 1;  // start on the big end
-
-    u32_t value = 0;
-    for (int i = 0; i < bytes; i++) {
-        value <<= 8;
-        value |= buf->buffer[offset];
-        offset += dir;
-    }
-
-    return jerry_create_number(value);
+    u64_t raw = load_bytes(buf->buffer + offset, bytes, big_endian);
+    return jerry_create_number(decode_value(raw, bytes, kind));
 }
 
-static ZJS_DECL_FUNC_ARGS(zjs_buffer_write_bytes, int bytes, bool big_endian)
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_write_value, int bytes, int kind,
+                          bool big_endian)
 {
     // requires: this is a JS buffer object created with zjs_buffer_create,
     //             argv[0] must be the value to be written, argv[1] should be
     //             an offset into the buffer, but will treat offset as 0 if not
     //             given, as node.js seems to
-    //           bytes is the number of bytes to write (expects 1, 2, or 4)
+    //           bytes is the number of bytes to write (1-8), or 0 to take it
+    //             from argv[2] as in writeIntLE
+    //           kind is one of the KIND_* values above
     //           big_endian true writes the bytes in big endian order, false in
     //             little endian order
     //  effects: writes bytes into the buffer associated with this JS object, if
@@ -108,107 +288,467 @@ static ZJS_DECL_FUNC_ARGS(zjs_buffer_write_bytes, int bytes, bool big_endian)
     //             buffer and returns the offset just beyond what was written;
     //             otherwise returns an error
 
-    // args: value[, offset]
-    ZJS_VALIDATE_ARGS(Z_NUMBER, Z_OPTIONAL Z_NUMBER);
+    // args: value[, offset[, byteLength]]
+    ZJS_VALIDATE_ARGS(Z_NUMBER, Z_OPTIONAL Z_NUMBER, Z_OPTIONAL Z_NUMBER);
 
-    // technically negatives aren't supported but this makes them behave better
-    double dval = jerry_get_number_value(argv[0]);
-    u32_t value = (u32_t)(dval < 0 ? (s32_t)dval : dval);
+    u64_t value = encode_value(jerry_get_number_value(argv[0]), bytes, kind);
 
     u32_t offset = 0;
     if (argc > 1) {
         offset = (u32_t)jerry_get_number_value(argv[1]);
     }
 
+    if (!bytes) {
+        bytes = argc > 2 ? (int)jerry_get_number_value(argv[2]) : 0;
+        if (bytes < 1 || bytes > 6) {
+            return RANGE_ERROR("byteLength must be 1 to 6");
+        }
+    }
+
     zjs_buffer_t *buf = zjs_buffer_find(this);
     if (!buf) {
         return zjs_error("buffer not found on write");
     }
 
-    u32_t beyond = offset + bytes;
-    if (beyond > buf->bufsize) {
-        DBG_PRINT("bufsize %d, write attempted from %d to %d\n",
-                  buf->bufsize, offset, beyond);
+    if (bytes > buf->bufsize || offset > buf->bufsize - bytes) {
+        DBG_PRINT("bufsize %d, write attempted from %u of %d bytes\n",
+                  buf->bufsize, offset, bytes);
         return zjs_error("write attempted beyond buffer");
     }
+    u32_t beyond = offset + bytes;
 
-    int dir = big_endian ? -1 : 1;
-    if (big_endian)
-        offset += bytes - 1;  // start on the little end
-
-    for (int i = 0; i < bytes; i++) {
-        buf->buffer[offset] = value & 0xff;
-        value >>= 8;
-        offset += dir;
-    }
-
+    store_bytes(buf->buffer + offset, bytes, big_endian, value);
     return jerry_create_number(beyond);
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_read_uint8)
-{
-    return zjs_buffer_read_bytes(function_obj, this, argv, argc, 1, true);
-}
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_BIG_ENDIAN true
+#else
+#define HOST_BIG_ENDIAN false
+#endif
 
-static ZJS_DECL_FUNC(zjs_buffer_read_uint16_be)
+static void free_typed_array_data(void *ptr)
 {
-    return zjs_buffer_read_bytes(function_obj, this, argv, argc, 2, true);
+    // requires: ptr is the data given to an external ArrayBuffer in
+    //             read_typed_array
+    zjs_free(ptr);
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_read_uint16_le)
+static jerry_value_t read_typed_array(const u8_t *src, u32_t count,
+                                      int bytes, int kind, bool big_endian)
 {
-    return zjs_buffer_read_bytes(function_obj, this, argv, argc, 2, false);
+    // requires: typed arrays are enabled; src holds count values of bytes
+    //             each, in the given byte order
+    //  effects: returns a typed array of the matching type, e.g. an
+    //             Int16Array, with its memory filled from src in one pass
+    jerry_typedarray_type_t type;
+    if (kind == KIND_FLOAT) {
+        type = bytes == 4 ? JERRY_TYPEDARRAY_FLOAT32 : JERRY_TYPEDARRAY_FLOAT64;
+    } else if (bytes == 1) {
+        type = kind == KIND_INT ? JERRY_TYPEDARRAY_INT8
+                                : JERRY_TYPEDARRAY_UINT8;
+    } else if (bytes == 2) {
+        type = kind == KIND_INT ? JERRY_TYPEDARRAY_INT16
+                                : JERRY_TYPEDARRAY_UINT16;
+    } else {
+        type = kind == KIND_INT ? JERRY_TYPEDARRAY_INT32
+                                : JERRY_TYPEDARRAY_UINT32;
+    }
+    if (!count) {
+        return jerry_create_typedarray(type, 0);
+    }
+
+    u32_t size = count * bytes;
+    u8_t *data = zjs_malloc(size);
+    if (!data) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+    if (bytes == 1 || big_endian == HOST_BIG_ENDIAN) {
+        // already in the order typed arrays use
+        memcpy(data, src, size);
+    } else {
+        for (u32_t i = 0; i < size; i += bytes) {
+            for (int j = 0; j < bytes; j++) {
+                data[i + j] = src[i + bytes - 1 - j];
+            }
+        }
+    }
+
+    // the typed array takes over data rather than copying it again
+    ZVAL array_buf =
+        jerry_create_arraybuffer_external(size, data, free_typed_array_data);
+    if (jerry_value_is_error(array_buf)) {
+        zjs_free(data);
+        return jerry_acquire_value(array_buf);
+    }
+    return jerry_create_typedarray_for_arraybuffer(type, array_buf);
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_read_uint32_be)
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_read_array, int bytes, int kind)
 {
-    return zjs_buffer_read_bytes(function_obj, this, argv, argc, 4, true);
+    // requires: this is a JS buffer object
+    //  effects: decodes count values of the given size and kind starting at
+    //             offset, in one call rather than one per value; count
+    //             defaults to as many as fit
+
+    // args: offset[, count[, littleEndian]]
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_NUMBER,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED,
+                               Z_OPTIONAL Z_BOOL);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found on read");
+    }
+
+    double offset = jerry_get_number_value(argv[0]);
+    // written so that NaN fails too
+    if (!(offset >= 0 && offset <= buf->bufsize)) {
+        return RANGE_ERROR("offset out of range");
+    }
+    u32_t start = (u32_t)offset;
+    u32_t count = (buf->bufsize - start) / bytes;
+    if (optcount >= 1 && !jerry_value_is_undefined(argv[1])) {
+        double value = jerry_get_number_value(argv[1]);
+        if (!(value >= 0 && value <= count)) {
+            return zjs_error("read attempted beyond buffer");
+        }
+        count = (u32_t)value;
+    }
+    bool big_endian = !(optcount >= 2 && jerry_get_boolean_value(argv[2]));
+
+    const u8_t *src = buf->buffer + start;
+    if (use_typedarray) {
+        jerry_value_t typed = read_typed_array(src, count, bytes, kind,
+                                               big_endian);
+        // engines built with 32-bit numbers have no Float64Array, so doubles
+        //   come back in a plain Array there
+        if (!jerry_value_is_error(typed) || kind != KIND_FLOAT || bytes != 8) {
+            return typed;
+        }
+        jerry_release_value(typed);
+    }
+
+    jerry_value_t array = jerry_create_array(count);
+    for (u32_t i = 0; i < count; i++, src += bytes) {
+        u64_t raw = load_bytes(src, bytes, big_endian);
+        ZVAL num = jerry_create_number(decode_value(raw, bytes, kind));
+        ZVAL rval = jerry_set_property_by_index(array, i, num);
+    }
+    return array;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_read_uint32_le)
+#define BUFFER_READ_FUNC(name, bytes, kind, big_endian)                      \
+    static ZJS_DECL_FUNC(name)                                               \
+    {                                                                        \
+        return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_read_value, bytes, kind,       \
+                                   big_endian);                              \
+    }
+
+#define BUFFER_WRITE_FUNC(name, bytes, kind, big_endian)                     \
+    static ZJS_DECL_FUNC(name)                                               \
+    {                                                                        \
+        return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_write_value, bytes, kind,      \
+                                   big_endian);                              \
+    }
+
+#define BUFFER_READ_ARRAY_FUNC(name, bytes, kind)                            \
+    static ZJS_DECL_FUNC(name)                                               \
+    {                                                                        \
+        return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_read_array, bytes, kind);      \
+    }
+
+BUFFER_READ_FUNC(zjs_buffer_read_uint8, 1, KIND_UINT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_uint16_be, 2, KIND_UINT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_uint16_le, 2, KIND_UINT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_uint32_be, 4, KIND_UINT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_uint32_le, 4, KIND_UINT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_int8, 1, KIND_INT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_int16_be, 2, KIND_INT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_int16_le, 2, KIND_INT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_int32_be, 4, KIND_INT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_int32_le, 4, KIND_INT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_float_be, 4, KIND_FLOAT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_float_le, 4, KIND_FLOAT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_double_be, 8, KIND_FLOAT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_double_le, 8, KIND_FLOAT, false)
+// byte length given as an argument
+BUFFER_READ_FUNC(zjs_buffer_read_uint_be, 0, KIND_UINT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_uint_le, 0, KIND_UINT, false)
+BUFFER_READ_FUNC(zjs_buffer_read_int_be, 0, KIND_INT, true)
+BUFFER_READ_FUNC(zjs_buffer_read_int_le, 0, KIND_INT, false)
+
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint8, 1, KIND_UINT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint16_be, 2, KIND_UINT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint16_le, 2, KIND_UINT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint32_be, 4, KIND_UINT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint32_le, 4, KIND_UINT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int8, 1, KIND_INT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int16_be, 2, KIND_INT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int16_le, 2, KIND_INT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int32_be, 4, KIND_INT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int32_le, 4, KIND_INT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_float_be, 4, KIND_FLOAT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_float_le, 4, KIND_FLOAT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_double_be, 8, KIND_FLOAT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_double_le, 8, KIND_FLOAT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint_be, 0, KIND_UINT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_uint_le, 0, KIND_UINT, false)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int_be, 0, KIND_INT, true)
+BUFFER_WRITE_FUNC(zjs_buffer_write_int_le, 0, KIND_INT, false)
+
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_uint8_array, 1, KIND_UINT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_int8_array, 1, KIND_INT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_uint16_array, 2, KIND_UINT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_int16_array, 2, KIND_INT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_uint32_array, 4, KIND_UINT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_int32_array, 4, KIND_INT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_float_array, 4, KIND_FLOAT)
+BUFFER_READ_ARRAY_FUNC(zjs_buffer_read_double_array, 8, KIND_FLOAT)
+
+typedef enum buffer_encoding {
+    ENC_UTF8,
+    ENC_ASCII,
+    ENC_LATIN1,
+    ENC_HEX,
+    ENC_BASE64,
+    ENC_BASE64URL
+} buffer_encoding_t;
+
+typedef struct encoding_name {
+    const char *name;
+    buffer_encoding_t encoding;
+} encoding_name_t;
+
+static const encoding_name_t encoding_names[] = {
+    { "utf8", ENC_UTF8 },     { "utf-8", ENC_UTF8 },
+    { "ascii", ENC_ASCII },   { "latin1", ENC_LATIN1 },
+    { "binary", ENC_LATIN1 }, { "hex", ENC_HEX },
+    { "base64", ENC_BASE64 }, { "base64url", ENC_BASE64URL },
+    { NULL, ENC_UTF8 }
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64url_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// value of each base64 character, with both alphabets accepted as in Node,
+//   or 0xff for anything else
+#define XX 0xff
+static const u8_t decode_table[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, 62, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+    XX, 0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, 63,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+#undef XX
+
+static bool parse_encoding(jerry_value_t value, buffer_encoding_t *encoding)
 {
-    return zjs_buffer_read_bytes(function_obj, this, argv, argc, 4, false);
+    // requires: value is a string
+    //  effects: sets *encoding to the encoding named by value, returns false
+    //             if there's no such encoding
+    const int MAX_ENCODING_LEN = 16;
+    jerry_size_t size = MAX_ENCODING_LEN;
+    char name[size];
+    zjs_copy_jstring(value, name, &size);
+    if (!size) {
+        return false;
+    }
+    for (int i = 0; encoding_names[i].name; i++) {
+        if (strequal(name, encoding_names[i].name)) {
+            *encoding = encoding_names[i].encoding;
+            return true;
+        }
+    }
+    return false;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_write_uint8)
+static inline int hex_value(u8_t c)
 {
-    return zjs_buffer_write_bytes(function_obj, this, argv, argc, 1, true);
+    // returns: value of hex digit c, or -1
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;  // lower case
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_write_uint16_be)
+static u32_t encode_hex(const u8_t *src, u32_t len, char *out)
 {
-    return zjs_buffer_write_bytes(function_obj, this, argv, argc, 2, true);
+    // requires: out has room for 2 * len chars
+    for (u32_t i = 0; i < len; i++) {
+        out[2 * i] = hex_digits[src[i] >> 4];
+        out[2 * i + 1] = hex_digits[src[i] & 0xf];
+    }
+    return 2 * len;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_write_uint16_le)
+static u32_t encode_base64(const u8_t *src, u32_t len, char *out, bool url)
 {
-    return zjs_buffer_write_bytes(function_obj, this, argv, argc, 2, false);
+    // requires: out has room for (len + 2) / 3 * 4 chars
+    //  effects: encodes src, padded with '=' unless url is true
+    const char *chars = url ? base64url_chars : base64_chars;
+    char *start = out;
+    u32_t i = 0;
+    // three bytes make four chars
+    for (; i + 3 <= len; i += 3) {
+        u32_t word = (u32_t)src[i] << 16 | (u32_t)src[i + 1] << 8 | src[i + 2];
+        *out++ = chars[word >> 18];
+        *out++ = chars[(word >> 12) & 0x3f];
+        *out++ = chars[(word >> 6) & 0x3f];
+        *out++ = chars[word & 0x3f];
+    }
+    if (i < len) {
+        u32_t word = (u32_t)src[i] << 16;
+        if (i + 1 < len) {
+            word |= (u32_t)src[i + 1] << 8;
+        }
+        *out++ = chars[word >> 18];
+        *out++ = chars[(word >> 12) & 0x3f];
+        if (i + 1 < len) {
+            *out++ = chars[(word >> 6) & 0x3f];
+        } else if (!url) {
+            *out++ = '=';
+        }
+        if (!url) {
+            *out++ = '=';
+        }
+    }
+    return out - start;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_write_uint32_be)
+static u32_t encode_latin1(const u8_t *src, u32_t len, char *out)
 {
-    return zjs_buffer_write_bytes(function_obj, this, argv, argc, 4, true);
+    // requires: out has room for 2 * len chars
+    //  effects: writes each byte as a UTF-8 code point
+    char *start = out;
+    for (u32_t i = 0; i < len; i++) {
+        if (src[i] < 0x80) {
+            *out++ = src[i];
+        } else {
+            *out++ = 0xc0 | (src[i] >> 6);
+            *out++ = 0x80 | (src[i] & 0x3f);
+        }
+    }
+    return out - start;
 }
 
-static ZJS_DECL_FUNC(zjs_buffer_write_uint32_le)
+static u32_t decode_string(u8_t *str, u32_t len, buffer_encoding_t encoding)
 {
-    return zjs_buffer_write_bytes(function_obj, this, argv, argc, 4, false);
+    // requires: str holds len bytes of UTF-8
+    //  effects: decodes str in place, which works since no encoding decodes
+    //             to more bytes than its text; returns the decoded length
+    u8_t *out = str;
+    if (encoding == ENC_HEX) {
+        // stop at the first pair that isn't hex, as Node does
+        for (u32_t i = 0; i + 1 < len; i += 2) {
+            int high = hex_value(str[i]);
+            int low = hex_value(str[i + 1]);
+            if (high < 0 || low < 0) {
+                break;
+            }
+            *out++ = high << 4 | low;
+        }
+    } else if (encoding == ENC_BASE64 || encoding == ENC_BASE64URL) {
+        // skip whitespace and other junk, and stop at padding
+        u32_t word = 0;
+        int bits = 0;
+        for (u32_t i = 0; i < len && str[i] != '='; i++) {
+            u8_t value = decode_table[str[i]];
+            if (value == 0xff) {
+                continue;
+            }
+            word = word << 6 | value;
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                *out++ = word >> bits;
+            }
+        }
+    } else if (encoding == ENC_LATIN1 || encoding == ENC_ASCII) {
+        // keep the low byte of each code point
+        for (u32_t i = 0; i < len; i++) {
+            u8_t c = str[i];
+            if (c >= 0xc0 && c < 0xe0 && i + 1 < len) {
+                c = c << 6 | (str[++i] & 0x3f);
+            } else if (c >= 0xe0 && i + 2 < len) {
+                c = str[i + 1] << 6 | (str[i + 2] & 0x3f);
+                i += 2;
+            }
+            *out++ = c;
+        }
+    } else {
+        return len;
+    }
+    return out - str;
 }
 
-char zjs_int_to_hex(int value)
+static jerry_value_t encode_buffer(const u8_t *src, u32_t len,
+                                   buffer_encoding_t encoding)
 {
-    // requires: value is between 0 and 15
-    //  effects: returns value as a lowercase hex digit 0-9a-f
-    if (value < 10)
-        return '0' + value;
-    return 'a' + value - 10;
+    // effects: returns a string with src in the given encoding
+    if (encoding == ENC_UTF8) {
+        return jerry_create_string_sz_from_utf8((jerry_char_t *)src, len);
+    }
+
+    // worst case output length, on the heap since it may be large
+    u32_t size = encoding == ENC_BASE64 || encoding == ENC_BASE64URL ?
+                 (len + 2) / 3 * 4 : 2 * len;
+    char *out = zjs_malloc(size ? size : 1);
+    if (!out) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+
+    u32_t outlen = 0;
+    switch (encoding) {
+    case ENC_ASCII:
+        for (outlen = 0; outlen < len; ++outlen) {
+            // strip off high bit if present
+            out[outlen] = src[outlen] & 0x7f;
+            if (!out[outlen]) {
+                break;
+            }
+        }
+        break;
+    case ENC_LATIN1:
+        outlen = encode_latin1(src, len, out);
+        break;
+    case ENC_HEX:
+        outlen = encode_hex(src, len, out);
+        break;
+    default:
+        outlen = encode_base64(src, len, out, encoding == ENC_BASE64URL);
+        break;
+    }
+
+    jerry_value_t jstr =
+        jerry_create_string_sz_from_utf8((jerry_char_t *)out, outlen);
+    zjs_free(out);
+    return jstr;
 }
 
 static ZJS_DECL_FUNC(zjs_buffer_to_string)
 {
     // requires: this must be a JS buffer object, if an argument is present it
-    //             must be the string 'utf8' (default), 'ascii' or 'hex', as
-    //             those are the only supported encodings for now
+    //             must name a supported encoding; utf8 is the default
     //  effects: if the buffer object is found, converts its contents to the
     //             given encoding
 
@@ -223,56 +763,11 @@ static ZJS_DECL_FUNC(zjs_buffer_to_string)
         return zjs_error("not a buffer");
     }
 
-    const int MAX_ENCODING_LEN = 16;
-    jerry_size_t size = MAX_ENCODING_LEN;
-    char enc[size];
-    const char *encoding = "utf8";
-    if (optcount) {
-        zjs_copy_jstring(argv[0], enc, &size);
-        if (!size) {
-            return zjs_error("encoding argument too long");
-        }
-        encoding = enc;
-    }
-
-    if (strequal(encoding, "utf8")) {
-        return jerry_create_string_sz_from_utf8((jerry_char_t *)buf->buffer,
-                                                buf->bufsize);
-    } else if (strequal(encoding, "ascii")) {
-        char *str = zjs_malloc(buf->bufsize);
-        if (!str) {
-            return zjs_error("out of memory");
-        }
-
-        int len;
-        for (len = 0; len < buf->bufsize; ++len) {
-            // strip off high bit if present
-            str[len] = buf->buffer[len] & 0x7f;
-            if (!str[len]) {
-                break;
-            }
-        }
-
-        jerry_value_t jstr;
-        jstr = jerry_create_string_sz_from_utf8((jerry_char_t *)str, len);
-        zjs_free(str);
-        return jstr;
-    } else if (strequal(encoding, "hex")) {
-        if (buf && buf->bufsize > 0) {
-            char hexbuf[buf->bufsize * 2 + 1];
-            for (int i = 0; i < buf->bufsize; i++) {
-                int high = (0xf0 & buf->buffer[i]) >> 4;
-                int low = 0xf & buf->buffer[i];
-                hexbuf[2 * i] = zjs_int_to_hex(high);
-                hexbuf[2 * i + 1] = zjs_int_to_hex(low);
-            }
-            hexbuf[buf->bufsize * 2] = '\0';
-            return jerry_create_string((jerry_char_t *)hexbuf);
-        }
-    } else {
+    buffer_encoding_t encoding = ENC_UTF8;
+    if (optcount && !parse_encoding(argv[0], &encoding)) {
         return zjs_error("unsupported encoding type");
     }
-    return zjs_error("buffer is empty");
+    return encode_buffer(buf->buffer, buf->bufsize, encoding);
 }
 
 static ZJS_DECL_FUNC(zjs_buffer_copy)
@@ -327,13 +822,301 @@ static ZJS_DECL_FUNC(zjs_buffer_copy)
     return jerry_create_number(len);
 }
 
+static ZJS_DECL_FUNC(zjs_buffer_slice)
+{
+    // requires: this must be a JS buffer object
+    //  effects: returns a new buffer that shares memory with this one, from
+    //             start up to end; negative offsets count back from the end,
+    //             as in Node
+
+    // args: [start[, end]]
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_OPTIONAL Z_NUMBER Z_UNDEFINED,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found");
+    }
+
+    double len = buf->bufsize;
+    double range[2] = { 0, len };
+    for (int i = 0; i < optcount; i++) {
+        if (jerry_value_is_undefined(argv[i])) {
+            continue;
+        }
+        double value = jerry_get_number_value(argv[i]);
+        if (value < 0) {
+            value += len;
+        }
+        range[i] = value < 0 ? 0 : (value > len ? len : value);
+    }
+    u32_t start = (u32_t)range[0];
+    u32_t end = (u32_t)range[1];
+    return zjs_buffer_create_view(this, start, end > start ? end - start : 0,
+                                  NULL);
+}
+
+// needles at least this long are searched for with Boyer-Moore-Horspool;
+//   shorter ones by scanning for their first byte with memchr
+#define BMH_MIN_NEEDLE 8
+
+static s32_t find_forward(const u8_t *hay, u32_t hay_len, const u8_t *needle,
+                          u32_t needle_len)
+{
+    // returns: offset of the first match of needle in hay, or -1
+    if (needle_len > hay_len) {
+        return -1;
+    }
+    if (needle_len < BMH_MIN_NEEDLE) {
+        const u8_t *p = hay;
+        const u8_t *last = hay + hay_len - needle_len;
+        while (p <= last) {
+            p = memchr(p, needle[0], last - p + 1);
+            if (!p) {
+                return -1;
+            }
+            if (!memcmp(p + 1, needle + 1, needle_len - 1)) {
+                return p - hay;
+            }
+            p++;
+        }
+        return -1;
+    }
+
+    // how far the window can move when its last byte is c; capped so the
+    //   table stays small on the stack, which only means shorter skips
+    u8_t skip[256];
+    u32_t max_skip = needle_len < 255 ? needle_len : 255;
+    memset(skip, max_skip, sizeof(skip));
+    for (u32_t i = needle_len - max_skip; i < needle_len - 1; i++) {
+        skip[needle[i]] = needle_len - 1 - i;
+    }
+    u8_t last_byte = needle[needle_len - 1];
+    for (u32_t pos = 0; pos <= hay_len - needle_len;) {
+        u8_t c = hay[pos + needle_len - 1];
+        if (c == last_byte && !memcmp(hay + pos, needle, needle_len - 1)) {
+            return pos;
+        }
+        pos += skip[c];
+    }
+    return -1;
+}
+
+static s32_t find_backward(const u8_t *hay, u32_t start, const u8_t *needle,
+                           u32_t needle_len)
+{
+    // returns: offset of the last match of needle in hay that begins at or
+    //            before start, or -1
+    for (s32_t pos = start; pos >= 0; pos--) {
+        if (hay[pos] == needle[0] &&
+            !memcmp(hay + pos + 1, needle + 1, needle_len - 1)) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+#define SEARCH_INDEX    0
+#define SEARCH_LAST     1
+#define SEARCH_INCLUDES 2
+
+static ZJS_DECL_FUNC_ARGS(zjs_buffer_search, int mode)
+{
+    // requires: this must be a JS buffer object
+    //  effects: finds value in the buffer, searching from byteOffset, which
+    //             counts back from the end if negative; returns the offset
+    //             found or -1, or for includes, true or false
+
+    // args: value[, byteOffset[, encoding]]
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_NUMBER Z_STRING Z_BUFFER,
+                               Z_OPTIONAL Z_NUMBER Z_UNDEFINED,
+                               Z_OPTIONAL Z_STRING);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found");
+    }
+
+    buffer_encoding_t encoding = ENC_UTF8;
+    if (optcount > 1 && !parse_encoding(argv[2], &encoding)) {
+        return zjs_error("unsupported encoding type");
+    }
+
+    u8_t byte;
+    const u8_t *needle;
+    u32_t needle_len;
+    char *str = NULL;
+    if (jerry_value_is_number(argv[0])) {
+        byte = to_uint8(jerry_get_number_value(argv[0]));
+        needle = &byte;
+        needle_len = 1;
+    } else if (jerry_value_is_string(argv[0])) {
+        jerry_size_t size = 0;
+        str = zjs_alloc_from_jstring(argv[0], &size);
+        if (!str) {
+            return zjs_error("out of memory");
+        }
+        needle = (u8_t *)str;
+        needle_len = decode_string((u8_t *)str, size, encoding);
+    } else {
+        zjs_buffer_t *other = zjs_buffer_find(argv[0]);
+        needle = other->buffer;
+        needle_len = other->bufsize;
+    }
+
+    s64_t len = buf->bufsize;
+    s64_t offset = mode == SEARCH_LAST ? len : 0;
+    if (optcount && !jerry_value_is_undefined(argv[1])) {
+        double value = jerry_get_number_value(argv[1]);
+        offset = value < 0 ? (s64_t)value + len : (s64_t)value;
+    }
+
+    s32_t found = -1;
+    if (mode == SEARCH_LAST) {
+        if (offset > len - needle_len) {
+            offset = len - needle_len;
+        }
+        if (offset >= 0) {
+            found = needle_len ? find_backward(buf->buffer, offset, needle,
+                                               needle_len)
+                               : offset;
+        }
+    } else {
+        if (offset < 0) {
+            offset = 0;
+        }
+        if (!needle_len) {
+            found = offset < len ? offset : len;
+        } else if (offset < len) {
+            found = find_forward(buf->buffer + offset, len - offset, needle,
+                                 needle_len);
+            if (found >= 0) {
+                found += offset;
+            }
+        }
+    }
+    zjs_free(str);
+
+    if (mode == SEARCH_INCLUDES) {
+        return jerry_create_boolean(found >= 0);
+    }
+    return jerry_create_number(found);
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_index_of)
+{
+    return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_search, SEARCH_INDEX);
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_last_index_of)
+{
+    return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_search, SEARCH_LAST);
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_includes)
+{
+    return ZJS_CHAIN_FUNC_ARGS(zjs_buffer_search, SEARCH_INCLUDES);
+}
+
+static int compare_buffers(zjs_buffer_t *a, zjs_buffer_t *b)
+{
+    // returns: -1, 0 or 1 as a sorts before, the same as, or after b
+    u32_t len = a->bufsize < b->bufsize ? a->bufsize : b->bufsize;
+    int rval = memcmp(a->buffer, b->buffer, len);
+    if (!rval) {
+        rval = (a->bufsize > b->bufsize) - (a->bufsize < b->bufsize);
+    }
+    return rval < 0 ? -1 : (rval > 0 ? 1 : 0);
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_equals)
+{
+    // args: other buffer
+    ZJS_VALIDATE_ARGS(Z_BUFFER);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found");
+    }
+    zjs_buffer_t *other = zjs_buffer_find(argv[0]);
+    return jerry_create_boolean(buf->bufsize == other->bufsize &&
+                                !memcmp(buf->buffer, other->buffer,
+                                        buf->bufsize));
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_compare)
+{
+    // args: target buffer
+    ZJS_VALIDATE_ARGS(Z_BUFFER);
+
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf) {
+        return zjs_error("buffer not found");
+    }
+    return jerry_create_number(compare_buffers(buf,
+                                               zjs_buffer_find(argv[0])));
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_static_compare)
+{
+    // args: buffer, buffer
+    ZJS_VALIDATE_ARGS(Z_BUFFER, Z_BUFFER);
+
+    return jerry_create_number(compare_buffers(zjs_buffer_find(argv[0]),
+                                               zjs_buffer_find(argv[1])));
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_concat)
+{
+    // requires: list is an array of buffers
+    //  effects: returns a new buffer holding the contents of each buffer in
+    //             list in turn; with totalLength, the result is truncated or
+    //             zero-filled to that length
+
+    // args: list[, totalLength]
+    ZJS_VALIDATE_ARGS(Z_ARRAY, Z_OPTIONAL Z_NUMBER);
+
+    u32_t count = jerry_get_array_length(argv[0]);
+    u32_t total = 0;
+    for (u32_t i = 0; i < count; i++) {
+        ZVAL item = jerry_get_property_by_index(argv[0], i);
+        zjs_buffer_t *part = zjs_buffer_find(item);
+        if (!part) {
+            return TYPE_ERROR("list must only contain buffers");
+        }
+        total += part->bufsize;
+    }
+    if (argc > 1) {
+        double value = jerry_get_number_value(argv[1]);
+        total = value < 0 ? 0 : (u32_t)value;
+    }
+
+    zjs_buffer_t *buf;
+    jerry_value_t new_buf = zjs_buffer_create(total, &buf);
+    if (!buf) {
+        return new_buf;
+    }
+    u32_t offset = 0;
+    for (u32_t i = 0; i < count && offset < total; i++) {
+        ZVAL item = jerry_get_property_by_index(argv[0], i);
+        zjs_buffer_t *part = zjs_buffer_find(item);
+        u32_t len = part->bufsize;
+        if (len > total - offset) {
+            len = total - offset;
+        }
+        memcpy(buf->buffer + offset, part->buffer, len);
+        offset += len;
+    }
+    memset(buf->buffer + offset, 0, total - offset);
+    return new_buf;
+}
+
 static ZJS_DECL_FUNC(zjs_buffer_write_string)
 {
     // requires: string - what will be written to buf
     //           offset - where to start writing (Default: 0)
     //           length - how many bytes to write (Default: buf.length -offset)
-    //           encoding - the character encoding of string. Currently only
-    //             supports the default of utf8
+    //           encoding - the character encoding of string (Default: utf8)
     //  effects: writes string to buf at offset according to the character
     //             encoding in encoding.
 
@@ -346,21 +1129,9 @@ static ZJS_DECL_FUNC(zjs_buffer_write_string)
         return zjs_error("buffer not found");
     }
 
-    // Check if the encoding string is anything other than utf8
-    if (argc > 3) {
-        char *encoding = zjs_alloc_from_jstring(argv[3], NULL);
-        if (!encoding) {
-            return zjs_error("out of memory");
-        }
-
-        // ask for one more char than needed to make sure not just prefix match
-        const char *utf8_encoding = "utf8";
-        int utf8_len = strlen(utf8_encoding);
-        int rval = strncmp(encoding, utf8_encoding, utf8_len + 1);
-        zjs_free(encoding);
-        if (rval != 0) {
-            return NOTSUPPORTED_ERROR("only utf8 encoding supported");
-        }
+    buffer_encoding_t encoding = ENC_UTF8;
+    if (argc > 3 && !parse_encoding(argv[3], &encoding)) {
+        return NOTSUPPORTED_ERROR("unsupported encoding type");
     }
 
     jerry_size_t size = 0;
@@ -368,6 +1139,7 @@ static ZJS_DECL_FUNC(zjs_buffer_write_string)
     if (!str) {
         return zjs_error("out of memory");
     }
+    size = decode_string((u8_t *)str, size, encoding);
 
     u32_t offset = 0;
     if (argc > 1)
@@ -494,12 +1266,65 @@ static ZJS_DECL_FUNC(zjs_buffer_fill)
     return jerry_acquire_value(this);
 }
 
+static jerry_value_t create_array_buffer(zjs_buffer_t *owner)
+{
+    // requires: owner came from alloc_block
+    //  effects: returns an ArrayBuffer that uses owner's memory in place and
+    //             holds a reference to it
+    if (owner->bufsize == 0) {
+        // JerryScript doesn't call the free callback for empty buffers
+        return jerry_create_arraybuffer(0);
+    }
+    owner->refs++;
+    jerry_value_t array_buf =
+        jerry_create_arraybuffer_external(owner->bufsize, owner->buffer,
+                                          zjs_buffer_release_memory);
+    if (jerry_value_is_error(array_buf)) {
+        owner->refs--;
+    }
+    return array_buf;
+}
+
+static jerry_value_t create_buffer_object(zjs_buffer_t *buf_item,
+                                          jerry_value_t array_buf,
+                                          u32_t offset)
+{
+    // requires: array_buf is an ArrayBuffer holding buf_item's memory at
+    //             offset, or undefined when typed arrays are disabled
+    //  effects: returns a new JS Buffer object for buf_item, which it frees
+    //             when it is collected; on error, frees buf_item and returns
+    //             the error
+    jerry_value_t buf_obj;
+    if (jerry_value_is_undefined(array_buf)) {
+        buf_obj = zjs_create_object();
+    } else {
+        if (jerry_value_is_error(array_buf)) {
+            buf_obj = jerry_acquire_value(array_buf);
+        } else {
+            buf_obj = jerry_create_typedarray_for_arraybuffer_sz(
+                JERRY_TYPEDARRAY_UINT8, array_buf, offset, buf_item->bufsize);
+        }
+        if (jerry_value_is_error(buf_obj)) {
+            zjs_buffer_callback_free(buf_item);
+            return buf_obj;
+        }
+    }
+    jerry_set_prototype(buf_obj, zjs_buffer_prototype);
+
+    // watch for the object getting garbage collected, and clean up
+    jerry_set_object_native_pointer(buf_obj, buf_item, &buffer_type_info);
+    return buf_obj;
+}
+
 jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf)
 {
     // requires: size is size of desired buffer, in bytes
-    //  effects: allocates a JS Buffer object, an underlying C buffer, and a
-    //             list item to track it; if any of these fail, return an error;
-    //             otherwise return the JS object
+    //  effects: allocates a JS Buffer object and a list item to track it,
+    //             with the C buffer inline after the item; if either fails,
+    //             return an error; otherwise return the JS object
+    if (ret_buf) {
+        *ret_buf = NULL;
+    }
 
     // follow Node's Buffer.kMaxLength limits though we don't expose that
     u32_t maxLength = (1UL << 31) - 1;
@@ -513,44 +1338,196 @@ jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf)
                                   0);
     }
 
-    void *buf = zjs_malloc(size);
+    zjs_buffer_t *buf_item = alloc_block(size);
+    if (!buf_item) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+
+    ZVAL array_buf = use_typedarray ? create_array_buffer(buf_item)
+                                    : jerry_create_undefined();
+    jerry_value_t buf_obj = create_buffer_object(buf_item, array_buf, 0);
+    if (ret_buf && !jerry_value_is_error(buf_obj)) {
+        *ret_buf = buf_item;
+    }
+    return buf_obj;
+}
+
+jerry_value_t zjs_buffer_create_view(jerry_value_t parent, u32_t offset,
+                                     u32_t size, zjs_buffer_t **ret_buf)
+{
+    // requires: parent is a JS Buffer object; offset + size is within it
+    //  effects: allocates a JS Buffer object and a list item that points into
+    //             parent's memory, and holds a reference to its owner
+    zjs_buffer_t *parent_buf = zjs_buffer_find(parent);
+    ZJS_ASSERT(parent_buf && offset + size <= parent_buf->bufsize,
+               "view out of range");
+    if (ret_buf) {
+        *ret_buf = NULL;
+    }
     zjs_buffer_t *buf_item = (zjs_buffer_t *)zjs_malloc(sizeof(zjs_buffer_t));
+    if (!buf_item) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+
+    // a view of a view refers straight to the owner, so chains don't build up
+    buf_item->buffer = parent_buf->buffer + offset;
+    buf_item->bufsize = size;
+    buf_item->owner = parent_buf->owner;
+    buf_item->refs = 0;
+    buf_item->pool = -1;
+    buf_item->owner->refs++;
+
+    // with typed arrays, the view shares its parent's ArrayBuffer
+    jerry_length_t start = 0, length;
+    ZVAL array_buf = use_typedarray
+                         ? jerry_get_typedarray_buffer(parent, &start, &length)
+                         : jerry_create_undefined();
+    jerry_value_t buf_obj =
+        create_buffer_object(buf_item, array_buf, start + offset);
+    if (ret_buf && !jerry_value_is_error(buf_obj)) {
+        *ret_buf = buf_item;
+    }
+    return buf_obj;
+}
 
-    if (!buf || !buf_item) {
-        zjs_free(buf);
-        zjs_free(buf_item);
-        if (ret_buf) {
-            *ret_buf = NULL;
+static jerry_value_t wrap_array_buffer(jerry_value_t array_buf,
+                                       const jerry_value_t argv[],
+                                       const jerry_length_t argc)
+{
+    // requires: array_buf is an ArrayBuffer; argv holds the constructor's
+    //             optional byteOffset and length after it
+    //  effects: returns a new JS Buffer object that uses the ArrayBuffer's
+    //             memory in place, as in Node
+    u32_t total = jerry_get_arraybuffer_byte_length(array_buf);
+    double range[2] = { 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        if (argc <= i + 1 || jerry_value_is_undefined(argv[i + 1])) {
+            range[i] = i ? total - range[0] : 0;
+            continue;
         }
+        if (!jerry_value_is_number(argv[i + 1])) {
+            return zjs_error_context("expected byteOffset and length", 0, 0);
+        }
+        range[i] = jerry_get_number_value(argv[i + 1]);
+    }
+    if (range[0] < 0 || range[0] > total || range[1] < 0 ||
+        range[1] > total - range[0]) {
+        return zjs_standard_error(RangeError, "out of bounds", 0, 0);
+    }
+    u32_t offset = (u32_t)range[0];
+    u32_t size = (u32_t)range[1];
+
+    u8_t *data = jerry_get_arraybuffer_pointer(array_buf);
+    if (!data && total) {
+        return zjs_error_context("ArrayBuffer has no memory", 0, 0);
+    }
+    zjs_buffer_t *buf_item = (zjs_buffer_t *)zjs_malloc(sizeof(zjs_buffer_t));
+    if (!buf_item) {
         return zjs_error_context("out of memory", 0, 0);
     }
 
-    jerry_value_t buf_obj = zjs_create_object();
-    buf_item->buffer = buf;
+    // the memory belongs to the ArrayBuffer, which the new Uint8Array keeps
+    //   alive, so only the item itself gets freed
+    buf_item->buffer = data + offset;
     buf_item->bufsize = size;
+    buf_item->owner = buf_item;
+    buf_item->refs = 1;
+    buf_item->pool = -1;
+    return create_buffer_object(buf_item, array_buf, offset);
+}
 
-    jerry_set_prototype(buf_obj, zjs_buffer_prototype);
-    zjs_obj_add_readonly_number(buf_obj, "length", size);
+static void copy_elements(u8_t *dst, jerry_value_t array, u32_t len)
+{
+    // requires: array has len elements, dst has room for len bytes
+    //  effects: stores each element of array in dst as a byte
+    for (u32_t i = 0; i < len; i++) {
+        ZVAL item = jerry_get_property_by_index(array, i);
+        if (jerry_value_is_number(item)) {
+            dst[i] = (u8_t)jerry_get_number_value(item);
+        } else {
+            ERR_PRINT("non-numeric value in array, treating as 0\n");
+            dst[i] = 0;
+        }
+    }
+}
 
-    // watch for the object getting garbage collected, and clean up
-    jerry_set_object_native_pointer(buf_obj, buf_item, &buffer_type_info);
-    if (ret_buf) {
-        *ret_buf = buf_item;
+static jerry_value_t copy_typed_array(jerry_value_t array)
+{
+    // requires: array is a TypedArray
+    //  effects: returns a new JS Buffer object holding each element of array
+    //             as a byte
+    u32_t len = jerry_get_typedarray_length(array);
+    zjs_buffer_t *buf;
+    jerry_value_t new_buf = zjs_buffer_create(len, &buf);
+    if (!buf) {
+        return new_buf;
     }
-    return buf_obj;
+
+    jerry_typedarray_type_t type = jerry_get_typedarray_type(array);
+    if (type == JERRY_TYPEDARRAY_UINT8 || type == JERRY_TYPEDARRAY_INT8 ||
+        type == JERRY_TYPEDARRAY_UINT8CLAMPED) {
+        // elements are already bytes, so copy them in one go
+        jerry_length_t start, length;
+        ZVAL array_buf = jerry_get_typedarray_buffer(array, &start, &length);
+        u8_t *data = jerry_get_arraybuffer_pointer(array_buf);
+        if (data) {
+            memcpy(buf->buffer, data + start, len);
+            return new_buf;
+        }
+    }
+    copy_elements(buf->buffer, array, len);
+    return new_buf;
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_get_length)
+{
+    // a getter on the prototype, so buffers don't each carry the property
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    return jerry_create_number(buf ? buf->bufsize : 0);
+}
+
+static ZJS_DECL_FUNC(zjs_buffer_get_pool_stats)
+{
+    // returns: object with total hits, misses and unpooled allocations, and
+    //            the same for each size class along with its free blocks
+    u32_t hits = 0, misses = 0;
+    jerry_value_t stats = zjs_create_object();
+    ZVAL list = jerry_create_array(CLASS_COUNT);
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        ZVAL cls = zjs_create_object();
+        zjs_obj_add_number(cls, "size", class_sizes[i]);
+        zjs_obj_add_number(cls, "hits", classes[i].hits);
+        zjs_obj_add_number(cls, "misses", classes[i].misses);
+        zjs_obj_add_number(cls, "free", classes[i].free_count);
+        ZVAL rval = jerry_set_property_by_index(list, i, cls);
+        hits += classes[i].hits;
+        misses += classes[i].misses;
+    }
+    zjs_obj_add_number(stats, "hits", hits);
+    zjs_obj_add_number(stats, "misses", misses);
+    zjs_obj_add_number(stats, "unpooled", unpooled);
+    zjs_obj_add_number(stats, "hitRate",
+                       hits + misses ? (double)hits / (hits + misses) : 0);
+    zjs_set_property(stats, "classes", list);
+    return stats;
 }
 
 // Buffer constructor
 static ZJS_DECL_FUNC(zjs_buffer)
 {
-    // requires: single argument can be a numeric size in bytes, an array of
-    //             uint8s, or a string
+    // requires: first argument can be a numeric size in bytes, an array of
+    //             uint8s, a Buffer or TypedArray to copy, an ArrayBuffer to
+    //             share, optionally followed by a byte offset and length, or
+    //             a string, optionally followed by the string's encoding
     //  effects: constructs a new JS Buffer object, and an associated buffer
     //             tied to it through a zjs_buffer_t struct stored in a global
     //             list
 
-    // args: initial size or initialization data
-    ZJS_VALIDATE_ARGS(Z_NUMBER Z_ARRAY Z_STRING);
+    // args: initial size or initialization data[, encoding or byteOffset[,
+    //         length]]
+    ZJS_VALIDATE_ARGS(Z_NUMBER Z_ARRAY Z_STRING Z_OBJECT,
+                      Z_OPTIONAL Z_STRING Z_NUMBER Z_UNDEFINED,
+                      Z_OPTIONAL Z_NUMBER Z_UNDEFINED);
 
     if (jerry_value_is_number(argv[0])) {
         double dnum = jerry_get_number_value(argv[0]);
@@ -574,25 +1551,22 @@ static ZJS_DECL_FUNC(zjs_buffer)
         zjs_buffer_t *buf;
         jerry_value_t new_buf = zjs_buffer_create(len, &buf);
         if (buf) {
-            for (int i = 0; i < len; i++) {
-                ZVAL item = jerry_get_property_by_index(array, i);
-                if (jerry_value_is_number(item)) {
-                    buf->buffer[i] = (u8_t)jerry_get_number_value(item);
-                } else {
-                    ERR_PRINT("non-numeric value in array, treating as 0\n");
-                    buf->buffer[i] = 0;
-                }
-            }
+            copy_elements(buf->buffer, array, len);
         }
         return new_buf;
-    } else {
-        // FIXME: this should take an encoding too
+    } else if (jerry_value_is_string(argv[0])) {
         // treat string argument as initializer
+        buffer_encoding_t encoding = ENC_UTF8;
+        if (argc > 1 && !parse_encoding(argv[1], &encoding)) {
+            return zjs_error("unsupported encoding type");
+        }
+
         jerry_size_t size = 0;
         char *str = zjs_alloc_from_jstring(argv[0], &size);
         if (!str) {
             return zjs_error("could not allocate string");
         }
+        size = decode_string((u8_t *)str, size, encoding);
 
         zjs_buffer_t *buf;
         jerry_value_t new_buf = zjs_buffer_create(size, &buf);
@@ -603,12 +1577,33 @@ static ZJS_DECL_FUNC(zjs_buffer)
         zjs_free(str);
         return new_buf;
     }
+
+    // with typed arrays disabled, Buffers are the only objects we can copy
+    zjs_buffer_t *src = zjs_buffer_find(argv[0]);
+    if (src && !use_typedarray) {
+        zjs_buffer_t *buf;
+        jerry_value_t new_buf = zjs_buffer_create(src->bufsize, &buf);
+        if (buf) {
+            memcpy(buf->buffer, src->buffer, src->bufsize);
+        }
+        return new_buf;
+    } else if (use_typedarray && jerry_value_is_typedarray(argv[0])) {
+        return copy_typed_array(argv[0]);
+    } else if (use_typedarray && jerry_value_is_arraybuffer(argv[0])) {
+        return wrap_array_buffer(argv[0], argv, argc);
+    }
+    return TYPE_ERROR("expected size, array, buffer or string");
 }
 
 void zjs_buffer_init()
 {
     ZVAL global_obj = jerry_get_global_object();
-    zjs_obj_add_function(global_obj, "Buffer", zjs_buffer);
+    ZVAL buffer_func = jerry_create_external_function(zjs_buffer);
+    zjs_obj_add_function(buffer_func, "getPoolStats",
+                         zjs_buffer_get_pool_stats);
+    zjs_obj_add_function(buffer_func, "concat", zjs_buffer_concat);
+    zjs_obj_add_function(buffer_func, "compare", zjs_buffer_static_compare);
+    zjs_set_property(global_obj, "Buffer", buffer_func);
 
     zjs_native_func_t array[] = {
         { zjs_buffer_read_uint8, "readUInt8" },
@@ -621,18 +1616,86 @@ void zjs_buffer_init()
         { zjs_buffer_write_uint32_be, "writeUInt32BE" },
         { zjs_buffer_read_uint32_le, "readUInt32LE" },
         { zjs_buffer_write_uint32_le, "writeUInt32LE" },
+        { zjs_buffer_read_int8, "readInt8" },
+        { zjs_buffer_write_int8, "writeInt8" },
+        { zjs_buffer_read_int16_be, "readInt16BE" },
+        { zjs_buffer_write_int16_be, "writeInt16BE" },
+        { zjs_buffer_read_int16_le, "readInt16LE" },
+        { zjs_buffer_write_int16_le, "writeInt16LE" },
+        { zjs_buffer_read_int32_be, "readInt32BE" },
+        { zjs_buffer_write_int32_be, "writeInt32BE" },
+        { zjs_buffer_read_int32_le, "readInt32LE" },
+        { zjs_buffer_write_int32_le, "writeInt32LE" },
+        { zjs_buffer_read_float_be, "readFloatBE" },
+        { zjs_buffer_write_float_be, "writeFloatBE" },
+        { zjs_buffer_read_float_le, "readFloatLE" },
+        { zjs_buffer_write_float_le, "writeFloatLE" },
+        { zjs_buffer_read_double_be, "readDoubleBE" },
+        { zjs_buffer_write_double_be, "writeDoubleBE" },
+        { zjs_buffer_read_double_le, "readDoubleLE" },
+        { zjs_buffer_write_double_le, "writeDoubleLE" },
+        { zjs_buffer_read_uint_be, "readUIntBE" },
+        { zjs_buffer_write_uint_be, "writeUIntBE" },
+        { zjs_buffer_read_uint_le, "readUIntLE" },
+        { zjs_buffer_write_uint_le, "writeUIntLE" },
+        { zjs_buffer_read_int_be, "readIntBE" },
+        { zjs_buffer_write_int_be, "writeIntBE" },
+        { zjs_buffer_read_int_le, "readIntLE" },
+        { zjs_buffer_write_int_le, "writeIntLE" },
+        { zjs_buffer_read_uint8_array, "readUInt8Array" },
+        { zjs_buffer_read_int8_array, "readInt8Array" },
+        { zjs_buffer_read_uint16_array, "readUInt16Array" },
+        { zjs_buffer_read_int16_array, "readInt16Array" },
+        { zjs_buffer_read_uint32_array, "readUInt32Array" },
+        { zjs_buffer_read_int32_array, "readInt32Array" },
+        { zjs_buffer_read_float_array, "readFloatArray" },
+        { zjs_buffer_read_double_array, "readDoubleArray" },
         { zjs_buffer_copy, "copy" },
         { zjs_buffer_fill, "fill" },
+        { zjs_buffer_slice, "slice" },
+        { zjs_buffer_slice, "subarray" },
+        { zjs_buffer_index_of, "indexOf" },
+        { zjs_buffer_last_index_of, "lastIndexOf" },
+        { zjs_buffer_includes, "includes" },
+        { zjs_buffer_equals, "equals" },
+        { zjs_buffer_compare, "compare" },
         { zjs_buffer_to_string, "toString" },
         { zjs_buffer_write_string, "write" },
         { NULL, NULL }
     };
     zjs_buffer_prototype = zjs_create_object();
     zjs_obj_add_functions(zjs_buffer_prototype, array);
+
+    // when JerryScript has typed arrays, buffers are Uint8Arrays over an
+    //   ArrayBuffer that uses their memory in place, so they inherit its
+    //   methods where they don't have their own
+    use_typedarray = jerry_is_feature_enabled(JERRY_FEATURE_TYPEDARRAY);
+    if (use_typedarray) {
+        ZVAL uint8_array = zjs_get_property(global_obj, "Uint8Array");
+        ZVAL uint8_proto = zjs_get_property(uint8_array, "prototype");
+        jerry_set_prototype(zjs_buffer_prototype, uint8_proto);
+    }
+
+    ZVAL length_name = jerry_create_string((const jerry_char_t *)"length");
+    jerry_property_descriptor_t pd;
+    jerry_init_property_descriptor_fields(&pd);
+    pd.is_get_defined = true;
+    pd.getter = jerry_create_external_function(zjs_buffer_get_length);
+    ZVAL rval = jerry_define_own_property(zjs_buffer_prototype, length_name,
+                                          &pd);
+    jerry_free_property_descriptor_fields(&pd);
 }
 
 void zjs_buffer_cleanup()
 {
     jerry_release_value(zjs_buffer_prototype);
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        while (classes[i].free) {
+            zjs_buffer_t *item = classes[i].free;
+            classes[i].free = item->owner;
+            zjs_free(item);
+        }
+        classes[i].free_count = 0;
+    }
 }
 #endif  // BUILD_MODULE_BUFFER
@@ -1,4 +1,4 @@
-// Copyright (c) 2016-2017, Intel Corporation.
+// Copyright (c) 2016-2018, Intel Corporation.
 
 #ifndef __zjs_buffer_h__
 #define __zjs_buffer_h__
@@ -18,6 +18,13 @@ void zjs_buffer_cleanup();
 typedef struct zjs_buffer {
     u8_t *buffer;
     u32_t bufsize;
+    // the buffer whose memory this one uses: itself, or for a view, the
+    //   buffer it was sliced from
+    struct zjs_buffer *owner;
+    // number of buffers using an owner's memory, including the owner
+    u32_t refs;
+    // size class an owner's block came from, or -1 if it wasn't pooled
+    s8_t pool;
 } zjs_buffer_t;
 
 /**
@@ -49,4 +56,22 @@ zjs_buffer_t *zjs_buffer_find(const jerry_value_t obj);
  */
 jerry_value_t zjs_buffer_create(u32_t size, zjs_buffer_t **ret_buf);
 
+/**
+ * Create a Buffer object that shares part of another buffer's memory
+ *
+ * Writes through either buffer are seen by both. The memory stays alive until
+ * the original buffer and all views of it have been collected. When typed
+ * arrays are enabled, the view shares its parent's ArrayBuffer.
+ *
+ * @param parent   JS Buffer object to take a view of
+ * @param offset   Offset of the view's first byte in parent
+ * @param size     View size in bytes; offset + size must be within parent
+ * @param ret_buf  Output pointer to receive new buffer handle, or NULL
+ *
+ * @return  New JS Buffer or Error object, and sets *ret_buf to C handle or
+ *            NULL, if given
+ */
+jerry_value_t zjs_buffer_create_view(jerry_value_t parent, u32_t offset,
+                                     u32_t size, zjs_buffer_t **ret_buf);
+
 #endif  // __zjs_buffer_h__
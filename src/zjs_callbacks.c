@@ -15,59 +15,128 @@
 
 #ifndef ZJS_LINUX_BUILD
 // Zephyr includes
-#include <ring_buffer.h>
 #include <zephyr.h>
 
 // ZJS includes
 #include "zjs_zephyr_port.h"
 #else
+#include <pthread.h>
+#include <sched.h>
 #include "zjs_linux_port.h"
 #endif
 
+#include "zjs_atomic.h"
 #include "zjs_callbacks.h"
+#include "zjs_hrtime.h"
+#include "zjs_mpsc_queue.h"
+#include "zjs_msgblock.h"
 #include "zjs_util.h"
 
 // JerryScript includes
 #include "jerryscript.h"
 
-// this could be defined with config options in the future
+// initial size of each callback queue lane in bytes, must be a power of two;
+//   set it for Zephyr boards with ZJS_FLAGS="-DZJS_CALLBACK_BUF_SIZE=..."
 #ifndef ZJS_CALLBACK_BUF_SIZE
+#ifdef ZJS_LINUX_BUILD
 #define ZJS_CALLBACK_BUF_SIZE   1024
+#else
+#define ZJS_CALLBACK_BUF_SIZE   256
+#endif
+#endif
+// on Linux a full lane doubles in size, up to this many bytes
+#ifdef ZJS_LINUX_BUILD
+#ifndef ZJS_CALLBACK_BUF_MAX
+#define ZJS_CALLBACK_BUF_MAX    (64 * 1024)
 #endif
-// max number of callbacks that can be serviced before continuing execution. If
-// this value is reached, any additional callbacks will be serviced on the next
-// time around the main loop.
-#ifndef ZJS_MAX_CB_LOOP_ITERATION
-#define ZJS_MAX_CB_LOOP_ITERATION   12
+#define LANE_MAX_GROWTHS        8
+#else
+#define LANE_MAX_GROWTHS        0
+#endif
+// longest a producer thread waits for room with ZJS_CB_OVERFLOW_BLOCK
+#ifndef ZJS_CALLBACK_BLOCK_US
+#define ZJS_CALLBACK_BLOCK_US   1000000
+#endif
+// default time in microseconds to spend servicing callbacks before continuing
+// execution. Once it runs out, any additional callbacks will be serviced on the
+// next time around the main loop. Can be changed with zjs_set_callback_budget.
+#ifndef ZJS_CALLBACK_BUDGET_US
+#define ZJS_CALLBACK_BUDGET_US      5000
 #endif
+// zjs_defer_work() payloads larger than this go through a message block
+//   instead of being copied into the queue
+#ifndef ZJS_DEFER_INLINE_MAX
+#define ZJS_DEFER_INLINE_MAX        64
+#endif
+
+// callback records are allocated a slab at a time and reused, never freed
+#define CB_SLAB_SIZE           16
+#define INITIAL_SLAB_LIMIT     2
 
-#define INITIAL_CALLBACK_SIZE  16
-#define CB_CHUNK_SIZE          16
-#define CB_LIST_MULTIPLIER     4
+// a callback ID holds the slot index in the low bits and the slot's generation
+//   above it, so a stale signal to an ID whose slot was reused is rejected
+#define CB_INDEX_MASK          ((1 << ZJS_CALLBACK_INDEX_BITS) - 1)
+#define CB_MAX_SLOTS           (1 << ZJS_CALLBACK_INDEX_BITS)
+#define CB_GEN_MASK            0xffff
+#define CB_MAKE_ID(index, gen) \
+    ((zjs_callback_id)(((u32_t)(gen) << ZJS_CALLBACK_INDEX_BITS) | (index)))
+
+// a signal in a lane carries the slot index as its message type and the low
+//   bits of the generation as its value, so a signal left behind when its
+//   slot is reused is ignored; commands set the top bit of the value instead
+#define CB_MSG_TYPE(id)        ((u16_t)((id) & CB_INDEX_MASK))
+#define CB_MSG_GEN(id) \
+    ((u8_t)(((id) >> ZJS_CALLBACK_INDEX_BITS) & 0x7f))
+#define CB_IS_COMMAND(value)   ((value) & 0x80)
 
 // flag bit value for JS callback
 #define CALLBACK_TYPE_JS    0
 // flag bit value for C callback
 #define CALLBACK_TYPE_C     1
 
-// Bits in flags for once, type (C or JS), and JS type (single or list)
+// Bits in flags for once, type (C or JS), removed, queue lane, and shared
 #define ONCE_BIT       0
 #define TYPE_BIT       1
 #define CB_REMOVED_BIT 2
+#define LANE_BIT       3
+#define SHARED_BIT     4
+#define COALESCE_BIT   5
 // Macros to set the bits in flags
 #define SET_ONCE(f, b)     f |= (b << ONCE_BIT)
 #define SET_TYPE(f, b)     f |= (b << TYPE_BIT)
 #define SET_CB_REMOVED(f)  f |= (1 << CB_REMOVED_BIT)
+#define SET_LANE(f, b)     f = (f & ~(1 << LANE_BIT)) | (b << LANE_BIT)
+#define SET_SHARED(f)      f |= (1 << SHARED_BIT)
+#define SET_COALESCE(f)    f |= (1 << COALESCE_BIT)
 // Macros to get the bits in flags
 #define GET_ONCE(f)        (f & (1 << ONCE_BIT)) >> ONCE_BIT
 #define GET_TYPE(f)        (f & (1 << TYPE_BIT)) >> TYPE_BIT
 #define GET_CB_REMOVED(f)  (f & (1 << CB_REMOVED_BIT)) >> CB_REMOVED_BIT
+#define GET_LANE(f)        (f & (1 << LANE_BIT)) >> LANE_BIT
+#define GET_SHARED(f)      ((f & (1 << SHARED_BIT)) >> SHARED_BIT)
+#define GET_COALESCE(f)    ((f & (1 << COALESCE_BIT)) >> COALESCE_BIT)
+
+// most bytes of args kept for a latest-value-wins callback
+#define CB_LATEST_MAX  64
 
-// ring buffer values for flushing pending callbacks
+// queue values for flushing pending callbacks
 #define CB_FLUSH_ONE 0xfe
 #define CB_FLUSH_ALL 0xff
 
-#define MAX_CALLER_CREATOR_LEN 128
+#ifdef ZJS_TRACE_CALLBACKS
+// log2 buckets in microseconds: 0, 1, 2-3, 4-7, ... with everything from
+//   2^(TRACE_BUCKETS - 2) up in the last one
+#define TRACE_BUCKETS 16
+
+typedef struct cb_trace {
+    u32_t count;
+    u32_t queue_max;                // most time from signal to dispatch, us
+    u32_t exec_max;                 // longest run, us
+    u32_t queue_hist[TRACE_BUCKETS];
+    u32_t exec_hist[TRACE_BUCKETS];
+} cb_trace_t;
+#endif
+
 typedef struct zjs_callback {
     void *handle;
     zjs_post_callback_func post;
@@ -77,51 +146,60 @@ typedef struct zjs_callback {
         zjs_c_callback_func function;  // C callback
     };
     zjs_callback_id id;
-    u8_t flags;  // holds once and type bits
-    u8_t max_funcs;
-    u8_t num_funcs;
-#ifdef INSTRUMENT_CALLBACKS
-    char creator[MAX_CALLER_CREATOR_LEN];  // file that created this callback
-    char caller[MAX_CALLER_CREATOR_LEN];   // file that signalled this callback
+    zjs_atomic_t pending;  // signals queued and not yet dispatched
+    u32_t *latest;         // latest args of a coalescing callback, or NULL
+    u8_t latest_max32;     // size of latest in 32-bit words
+    u8_t latest_size32;    // words of latest in use
+    s16_t next_free;  // next slot in the free list, or -1
+    u8_t flags;       // holds once and type bits
+    u16_t gen;        // bumped each time the slot is freed
+    bool allocated;
+#ifdef ZJS_TRACE_CALLBACKS
+    const char *creator;  // function that created this callback, or NULL
+    cb_trace_t trace;
 #endif
 } zjs_callback_t;
 
+// lock-free queues of signaled callbacks, one per lane, filled from any thread
+//   or ISR and drained by the main thread in zjs_service_callbacks(); all
+//   signals and flush commands for a callback go through its own lane, so
+//   they stay in order
+static u32_t lane_buffers[ZJS_CB_LANE_COUNT][ZJS_CALLBACK_BUF_SIZE /
+                                             sizeof(u32_t)];
+// each lane's queues, oldest first; when a lane grows its pending messages
+//   move to a new, bigger queue, but the old ones are still drained in case a
+//   producer on another thread was part way through a put at the time
+static zjs_mpsc_queue_t lane_queues[ZJS_CB_LANE_COUNT][LANE_MAX_GROWTHS + 1];
+static u8_t lane_growths[ZJS_CB_LANE_COUNT];
+// the queue each lane puts new messages in
+static zjs_mpsc_queue_t *lanes[ZJS_CB_LANE_COUNT];
+static u8_t queue_initialized = 0;
+
+static u32_t service_budget_us = ZJS_CALLBACK_BUDGET_US;
+
+static u8_t overflow_policy = ZJS_CB_OVERFLOW_DROP_NEWEST;
+static zjs_callback_queue_stats_t queue_stats;
+static zjs_callback_overflow_handler overflow_handler = NULL;
+// lost or delayed signals as of the last overflow report
+static u32_t overflow_reported = 0;
+
 #ifdef ZJS_LINUX_BUILD
-static u8_t args_buffer[ZJS_CALLBACK_BUF_SIZE];
-static struct zjs_port_ring_buf ring_buffer;
+static pthread_t main_thread;
+#define on_main_thread() pthread_equal(pthread_self(), main_thread)
+#define producer_wait() sched_yield()
 #else
-SYS_RING_BUF_DECLARE_POW2(ring_buffer, 6);
+static k_tid_t main_thread;
+#define on_main_thread() (!k_is_in_isr() && k_current_get() == main_thread)
+#define producer_wait() k_sleep(1)
 #endif
-static u8_t ring_buf_initialized = 1;
 
 #ifdef ZJS_LINUX_BUILD
 #define k_is_preempt_thread() 0
-#define RB_LOCK() do {} while (0)
-#define RB_UNLOCK() do {} while (0)
+#define k_is_in_isr() 0
 #define CB_LOCK() do {} while (0)
 #define CB_UNLOCK() do {} while (0)
 #else  // !ZJS_LINUX_BUILD
-// mutex to ensure only one thread can access ring buffer at a time
-static struct k_mutex ring_mutex;
-
-#define RB_LOCK()                                \
-{                                                \
-    LPRINT("Ringbuf lock...");                   \
-    if (k_mutex_lock(&ring_mutex, K_FOREVER)) {  \
-        ERR_PRINT("Ringbuf lock error.\n");      \
-    } else {                                     \
-        LPRINT("Ringbuf locked.");               \
-    }                                            \
-}
-
-#define RB_UNLOCK()               \
-{                                 \
-    LPRINT("Ringbuf unlock...");  \
-    k_mutex_unlock(&ring_mutex);  \
-    LPRINT("Ringbuf unlocked.");  \
-}
-
-// mutex to ensure only one thread can access cb_map at a time
+// mutex to ensure only one thread can access the callback slots at a time
 static struct k_mutex cb_mutex;
 
 #define CB_LOCK()                              \
@@ -142,61 +220,175 @@ static struct k_mutex cb_mutex;
 }
 #endif  // ZJS_LINUX_BUILD
 
-static zjs_callback_id cb_limit = INITIAL_CALLBACK_SIZE;
-static zjs_callback_id cb_size = 0;
-static zjs_callback_t **cb_map = NULL;
+typedef struct callback_slab {
+    zjs_callback_t cbs[CB_SLAB_SIZE];
+    // one bit per slot, set while a coalescing callback has a signal waiting
+    //   in its lane, so further signals only need to find it set
+    zjs_atomic_t signal_bits;
+} callback_slab_t;
+
+// slab pointers, doubled in size as needed
+static callback_slab_t **cb_slabs = NULL;
+static u16_t slab_count = 0;
+static u16_t slab_limit = 0;
+// number of callback slots in all slabs
+static u16_t cb_size = 0;
+// FIFO list of free slots, so a freed slot's generation moves on slowly
+static s16_t free_head = -1;
+static s16_t free_tail = -1;
+
+#define CB_SLOT(index) \
+    (&cb_slabs[(index) / CB_SLAB_SIZE]->cbs[(index) % CB_SLAB_SIZE])
 
 static zjs_callback_id defer_id = -1;
+static zjs_callback_id defer_block_id = -1;
+
+#define SIGNAL_WORD(index) (&cb_slabs[(index) / CB_SLAB_SIZE]->signal_bits)
+#define SIGNAL_MASK(index) (1 << ((index) % CB_SLAB_SIZE))
+
+// guards latest args against a producer and the main thread using them at
+//   once; an ISR could preempt the holder, so on Zephyr it locks out IRQs
+#ifdef ZJS_LINUX_BUILD
+static zjs_atomic_t latest_lock = 0;
+#define LATEST_LOCK(key)                               \
+    do {                                               \
+        (void)key;                                     \
+        while (!ZJS_ATOMIC_CAS(&latest_lock, 0, 1)) {  \
+            sched_yield();                             \
+        }                                              \
+    } while (0)
+#define LATEST_UNLOCK(key) ZJS_ATOMIC_STORE(&latest_lock, 0)
+#else
+#define LATEST_LOCK(key) key = irq_lock()
+#define LATEST_UNLOCK(key) irq_unlock(key)
+#endif
+
+static bool lane_put(u8_t lane, u16_t type, u8_t value, const u32_t *data,
+                     u8_t size32);
 
 static int zjs_ringbuf_error_count = 0;
 static int zjs_ringbuf_error_max = 0;
 static int zjs_ringbuf_last_error = 0;
 
-#ifdef INSTRUMENT_CALLBACKS
-static void set_info_string(char *str, const char *file, const char *func)
+#ifdef ZJS_TRACE_CALLBACKS
+// totals for all callbacks, including ones since removed
+static cb_trace_t trace_all;
+static u32_t trace_high_water[ZJS_CB_LANE_COUNT];
+#endif
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static u32_t service_clock_us(void)
 {
-    const char *i = file + strlen(file);
-    while (i != file) {
-        if (*i == '/') {
-            i++;
-            break;
+    // wraps every 71 minutes, but the difference of two readings is right as
+    //   long as they're less than that apart
+    return (u32_t)(zjs_hrtime_ns() / 1000);
+}
+
+static zjs_callback_t *get_callback(zjs_callback_id id)
+{
+    // returns: the callback for id, or NULL if id is invalid or its slot has
+    //            been freed or reused since
+    if (id < 0) {
+        return NULL;
+    }
+    u16_t index = id & CB_INDEX_MASK;
+    if (index >= cb_size) {
+        return NULL;
+    }
+    zjs_callback_t *cb = CB_SLOT(index);
+    return (cb->allocated && cb->id == id) ? cb : NULL;
+}
+
+static zjs_callback_id msg_callback_id(u16_t type, u8_t value)
+{
+    // returns: the ID of the callback a lane message is for, or -1 if it's a
+    //            signal whose slot has been freed or reused since
+    if (type >= cb_size) {
+        return -1;
+    }
+    zjs_callback_t *cb = CB_SLOT(type);
+    if (!cb->allocated ||
+        (!CB_IS_COMMAND(value) && CB_MSG_GEN(cb->id) != value)) {
+        return -1;
+    }
+    return cb->id;
+}
+
+static void push_free_slot(u16_t index)
+{
+    // requires: CB_LOCK held
+    zjs_callback_t *cb = CB_SLOT(index);
+    cb->allocated = false;
+    cb->next_free = -1;
+    if (free_tail >= 0) {
+        CB_SLOT(free_tail)->next_free = index;
+    } else {
+        free_head = index;
+    }
+    free_tail = index;
+}
+
+static bool add_slab(void)
+{
+    // requires: CB_LOCK held
+    if (cb_size + CB_SLAB_SIZE > CB_MAX_SLOTS) {
+        ERR_PRINT("too many callbacks\n");
+        return false;
+    }
+    if (slab_count >= slab_limit) {
+        u16_t limit = slab_limit ? slab_limit * 2 : INITIAL_SLAB_LIMIT;
+        callback_slab_t **slabs =
+            zjs_malloc(sizeof(callback_slab_t *) * limit);
+        if (!slabs) {
+            DBG_PRINT("error allocating space for callback slabs\n");
+            return false;
+        }
+        if (cb_slabs) {
+            memcpy(slabs, cb_slabs, sizeof(callback_slab_t *) * slab_count);
+            zjs_free(cb_slabs);
         }
-        i--;
+        cb_slabs = slabs;
+        slab_limit = limit;
     }
-    snprintf(str, MAX_CALLER_CREATOR_LEN, "%s:%s()", i, func);
+    callback_slab_t *slab = zjs_malloc(sizeof(callback_slab_t));
+    if (!slab) {
+        DBG_PRINT("error allocating callback slab\n");
+        return false;
+    }
+    memset(slab, 0, sizeof(callback_slab_t));
+    cb_slabs[slab_count++] = slab;
+    DBG_PRINT("adding callback slab, %d slots\n", cb_size + CB_SLAB_SIZE);
+
+    u16_t base = cb_size;
+    cb_size += CB_SLAB_SIZE;
+    for (int i = 0; i < CB_SLAB_SIZE; i++) {
+        push_free_slot(base + i);
+    }
+    return true;
 }
-#endif
 
-static zjs_callback_id new_id(void)
+static zjs_callback_t *new_callback(void)
 {
-    zjs_callback_id id = 0;
-    // NOTE: We could wait until after we check for a NULL callback slot in
-    //   the map before we increase allocation; or else store a count that
-    //   can be less than cb_size when callbacks are removed.
+    // effects: takes a cleared callback record from the free list, with its
+    //            ID set
     CB_LOCK();
-    if (cb_size >= cb_limit) {
-        cb_limit += CB_CHUNK_SIZE;
-        size_t size = sizeof(zjs_callback_t *) * cb_limit;
-        zjs_callback_t **new_map = zjs_malloc(size);
-        if (!new_map) {
-            DBG_PRINT("error allocating space for new callback map\n");
-            return -1;
-        }
-        DBG_PRINT("callback list size too small, increasing by %d\n",
-                  CB_CHUNK_SIZE);
-        memset(new_map, 0, size);
-        memcpy(new_map, cb_map, sizeof(zjs_callback_t *) * cb_size);
-        zjs_free(cb_map);
-        cb_map = new_map;
-    }
-    while (cb_map[id] != NULL) {
-        id++;
-    }
-    if (id >= cb_size) {
-        cb_size = id + 1;
+    if (free_head < 0 && !add_slab()) {
+        CB_UNLOCK();
+        return NULL;
     }
+    u16_t index = free_head;
+    zjs_callback_t *cb = CB_SLOT(index);
+    free_head = cb->next_free;
+    if (free_head < 0) {
+        free_tail = -1;
+    }
+    u16_t gen = cb->gen;
+    memset(cb, 0, sizeof(zjs_callback_t));
+    cb->gen = gen;
+    cb->id = CB_MAKE_ID(index, gen);
+    cb->allocated = true;
     CB_UNLOCK();
-    return id;
+    return cb;
 }
 
 typedef struct deferred_work {
@@ -226,29 +418,62 @@ static void deferred_work_callback(void *handle, const void *args)
     DBG_PRINT("deferred work callback was NULL\n");
 }
 
+typedef struct deferred_block {
+    zjs_deferred_work callback;
+    zjs_msgblock_t *block;
+} deferred_block_t;
+
+static void deferred_block_callback(void *handle, const void *args)
+{
+    const deferred_block_t *deferred = (const deferred_block_t *)args;
+    zjs_msgblock_t *block = deferred->block;
+    if (deferred->callback) {
+        deferred->callback(zjs_msgblock_data(block), zjs_msgblock_size(block));
+    } else {
+        DBG_PRINT("deferred block callback was NULL\n");
+    }
+    // the callback takes its own reference if it needs the block longer
+    zjs_msgblock_unref(block);
+}
+
 void zjs_init_callbacks(void)
 {
 #ifndef ZJS_LINUX_BUILD
-    k_mutex_init(&ring_mutex);
     k_mutex_init(&cb_mutex);
 #endif
 
-    if (!cb_map) {
-        size_t size = sizeof(zjs_callback_t *) * INITIAL_CALLBACK_SIZE;
-        cb_map = (zjs_callback_t **)zjs_malloc(size);
-        if (!cb_map) {
-            DBG_PRINT("error allocating space for CB map\n");
-            return;
-        }
-        memset(cb_map, 0, size);
+    if (!cb_slabs) {
+        CB_LOCK();
+        add_slab();
+        CB_UNLOCK();
     }
 #ifdef ZJS_LINUX_BUILD
-    zjs_port_ring_buf_init(&ring_buffer, ZJS_CALLBACK_BUF_SIZE,
-                           (u32_t *)args_buffer);
+    main_thread = pthread_self();
+#else
+    main_thread = k_current_get();
 #endif
-    ring_buf_initialized = 1;
+    for (int i = 0; i < ZJS_CB_LANE_COUNT; i++) {
+        // free buffers from earlier growth
+        for (int j = 1; j <= lane_growths[i]; j++) {
+            zjs_free(lane_queues[i][j].buf);
+        }
+        lane_growths[i] = 0;
+        lanes[i] = &lane_queues[i][0];
+        zjs_mpsc_init(lanes[i], lane_buffers[i], SIZE32_OF(lane_buffers[i]));
+    }
+    memset(&queue_stats, 0, sizeof(queue_stats));
+    for (int i = 0; i < slab_count; i++) {
+        cb_slabs[i]->signal_bits = 0;
+    }
+    overflow_reported = 0;
+    queue_initialized = 1;
+    zjs_msgblock_init();
 
+    // these carry unrelated work in each signal, so never coalesce them
     defer_id = zjs_add_c_callback(NULL, deferred_work_callback);
+    zjs_set_callback_shared(defer_id);
+    defer_block_id = zjs_add_c_callback(NULL, deferred_block_callback);
+    zjs_set_callback_shared(defer_block_id);
     return;
 }
 
@@ -257,9 +482,10 @@ bool zjs_edit_js_func(zjs_callback_id id, jerry_value_t func)
     // requires: only run from main thread
     CB_LOCK();
     bool rval = false;
-    if (id >= 0 && cb_map[id]) {
-        jerry_release_value(cb_map[id]->js_func);
-        cb_map[id]->js_func = jerry_acquire_value(func);
+    zjs_callback_t *cb = get_callback(id);
+    if (cb) {
+        jerry_release_value(cb->js_func);
+        cb->js_func = jerry_acquire_value(func);
         rval = true;
     }
     CB_UNLOCK();
@@ -271,40 +497,33 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
                                   void *handle,
                                   zjs_post_callback_func post,
                                   u8_t once
-#ifdef INSTRUMENT_CALLBACKS
+#ifdef ZJS_TRACE_CALLBACKS
                                   ,
-                                  const char *file,
-                                  const char *func)
+                                  const char *creator)
 #else
                                   )
 #endif
 {
-    zjs_callback_t *new_cb = zjs_malloc(sizeof(zjs_callback_t));
+    zjs_callback_t *new_cb = new_callback();
     if (!new_cb) {
         DBG_PRINT("error allocating space for new callback\n");
         return -1;
     }
-    memset(new_cb, 0, sizeof(zjs_callback_t));
 
+    CB_LOCK();
     SET_ONCE(new_cb->flags, (once) ? 1 : 0);
     SET_TYPE(new_cb->flags, CALLBACK_TYPE_JS);
-    new_cb->id = new_id();
     new_cb->js_func = jerry_acquire_value(js_func);
     new_cb->this = jerry_acquire_value(this);
+    SET_LANE(new_cb->flags, ZJS_CB_LANE_JS);
     new_cb->post = post;
     new_cb->handle = handle;
-    new_cb->max_funcs = 1;
-    new_cb->num_funcs = 1;
-
-    CB_LOCK();
-    // Add callback to list
-    cb_map[new_cb->id] = new_cb;
 
     DBG_PRINT("adding new callback id %d, js_func=%p, once=%u\n", new_cb->id,
               (void *)(uintptr_t)new_cb->js_func, once);
 
-#ifdef INSTRUMENT_CALLBACKS
-    set_info_string(cb_map[new_cb->id]->creator, file, func);
+#ifdef ZJS_TRACE_CALLBACKS
+    new_cb->creator = creator;
 #endif
     CB_UNLOCK();
     return new_cb->id;
@@ -312,11 +531,17 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
 
 static void zjs_free_callback(zjs_callback_id id)
 {
-    // effects: frees callback associated with id if it's marked as removed
+    // effects: frees callback associated with id if it's marked as removed,
+    //            returning its slot to the free list under a new generation
     CB_LOCK();
-    if (id >= 0 && cb_map[id] && GET_CB_REMOVED(cb_map[id]->flags)) {
-        zjs_free(cb_map[id]);
-        cb_map[id] = NULL;
+    zjs_callback_t *cb = get_callback(id);
+    if (cb && GET_CB_REMOVED(cb->flags)) {
+        u16_t index = id & CB_INDEX_MASK;
+        ZJS_ATOMIC_AND(SIGNAL_WORD(index), ~SIGNAL_MASK(index));
+        zjs_free(cb->latest);
+        cb->latest = NULL;
+        cb->gen = (cb->gen + 1) & CB_GEN_MASK;
+        push_free_slot(id & CB_INDEX_MASK);
     }
     CB_UNLOCK();
 }
@@ -327,25 +552,23 @@ static void zjs_remove_callback_priv(zjs_callback_id id, bool skip_flush)
     //            assumes the callback will be "flushed" elsewhere, that is
     //            freed and the id reclaimed; otherwise, tries to do it here
     CB_LOCK();
-    if (id >= 0 && cb_map[id]) {
+    zjs_callback_t *cb = get_callback(id);
+    if (cb) {
         // Don't free a callback after its been freed
-        if (GET_CB_REMOVED(cb_map[id]->flags)) {
+        if (GET_CB_REMOVED(cb->flags)) {
             CB_UNLOCK();
             return;
         }
 
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
-            jerry_release_value(cb_map[id]->js_func);
-            jerry_release_value(cb_map[id]->this);
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+            jerry_release_value(cb->js_func);
+            jerry_release_value(cb->this);
         }
-        SET_CB_REMOVED(cb_map[id]->flags);
+        SET_CB_REMOVED(cb->flags);
         CB_UNLOCK();
         if (!skip_flush) {
-            RB_LOCK();
-            int ret = zjs_port_ring_buf_put(&ring_buffer, (u16_t)id,
-                                            CB_FLUSH_ONE, NULL, 0);
-            RB_UNLOCK();
-            if (ret) {
+            if (!lane_put(GET_LANE(cb->flags), CB_MSG_TYPE(id),
+                          CB_FLUSH_ONE, NULL, 0)) {
                 // couldn't add flush command, so just free now
                 DBG_PRINT("no room for flush callback %d command\n", id);
                 zjs_free_callback(id);
@@ -365,51 +588,277 @@ void zjs_remove_callback(zjs_callback_id id)
 void zjs_remove_all_callbacks()
 {
     // try posting a command to flush all removed callbacks
-    RB_LOCK();
-    int ret = zjs_port_ring_buf_put(&ring_buffer, 0, CB_FLUSH_ALL, NULL, 0);
-    RB_UNLOCK();
-    bool skip_flush = ret ? false : true;
+    // flush after everything pending in the JS lane; stale hardware lane
+    //   signals are rejected by their callback ID generation
+    bool skip_flush = lane_put(ZJS_CB_LANE_JS, 0, CB_FLUSH_ALL, NULL, 0);
     for (int i = 0; i < cb_size; i++) {
         CB_LOCK();
-        if (cb_map[i]) {
-            zjs_remove_callback_priv(i, skip_flush);
+        zjs_callback_t *cb = CB_SLOT(i);
+        if (cb->allocated) {
+            zjs_remove_callback_priv(cb->id, skip_flush);
         }
         CB_UNLOCK();
     }
 }
 
-// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
-void signal_callback_priv(zjs_callback_id id,
-                          const void *args,
-                          u32_t size
-#ifdef INSTRUMENT_CALLBACKS
-                          ,
-                          const char *file,
-                          const char *func)
+static bool grow_lane(u8_t lane)
+{
+    // requires: main thread
+    //  effects: moves the lane's pending messages to a queue twice the size
+    //  returns: true if the lane grew
+#ifdef ZJS_LINUX_BUILD
+    u8_t growths = lane_growths[lane];
+    zjs_mpsc_queue_t *old = lanes[lane];
+    u32_t size32 = (old->mask + 1) * 2;
+    if (growths >= LANE_MAX_GROWTHS ||
+        size32 * sizeof(u32_t) > ZJS_CALLBACK_BUF_MAX) {
+        return false;
+    }
+    u32_t *buf = zjs_malloc(size32 * sizeof(u32_t));
+    if (!buf) {
+        return false;
+    }
+    zjs_mpsc_queue_t *q = &lane_queues[lane][growths + 1];
+    zjs_mpsc_init(q, buf, size32);
+    zjs_mpsc_msg_t msg;
+    while (zjs_mpsc_peek(old, &msg) == 0) {
+        zjs_mpsc_put(q, msg.type, msg.value, msg.data, msg.size32);
+        zjs_mpsc_consume(old, &msg);
+    }
+    lane_growths[lane] = growths + 1;
+    __atomic_store_n(&lanes[lane], q, __ATOMIC_RELEASE);
+    queue_stats.grown++;
+    DBG_PRINT("callback lane %u grew to %u bytes\n", lane,
+              size32 * (u32_t)sizeof(u32_t));
+    return true;
 #else
-                          )
+    return false;
 #endif
+}
+
+static bool lane_put(u8_t lane, u16_t type, u8_t value, const u32_t *data,
+                     u8_t size32)
+{
+    // effects: puts a message in a lane, growing the lane if it's full and
+    //            this is the main thread
+    //  returns: true on success
+    while (zjs_mpsc_put(lanes[lane], type, value, data, size32)) {
+        if (!on_main_thread() || !grow_lane(lane)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static int put_signal(u8_t lane, zjs_callback_id id, const u32_t *data,
+                      u8_t size32)
+{
+    // returns: 0 on success, -EMSGSIZE if the lane is full
+    return zjs_mpsc_put(lanes[lane], CB_MSG_TYPE(id), CB_MSG_GEN(id), data,
+                        size32);
+}
+
+static void release_signal(zjs_callback_id id, const u32_t *data,
+                           u8_t size32)
+{
+    // effects: releases what a signal holds when it's thrown away unserviced
+#ifdef ZJS_TRACE_CALLBACKS
+    // skip the signal time
+    data++;
+    size32--;
+#endif
+    zjs_callback_t *cb = get_callback(id);
+    if (!cb) {
+        return;
+    }
+    ZJS_ATOMIC_DEC(&cb->pending);
+    if (GET_COALESCE(cb->flags)) {
+        // let the next signal queue again
+        u16_t index = id & CB_INDEX_MASK;
+        ZJS_ATOMIC_AND(SIGNAL_WORD(index), ~SIGNAL_MASK(index));
+        return;
+    }
+    if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+        for (int i = 0; i < size32; i++) {
+            jerry_release_value((jerry_value_t)data[i]);
+        }
+    } else if (id == defer_block_id) {
+        deferred_block_t defer;
+        memcpy(&defer, data, sizeof(defer));
+        zjs_msgblock_unref(defer.block);
+    }
+}
+
+static bool discard_oldest(u8_t lane)
+{
+    // requires: main thread, since it consumes from the lane
+    //  effects: throws away the oldest signal in the lane to make room
+    //  returns: true if a signal was discarded
+    zjs_mpsc_queue_t *q = lanes[lane];
+    zjs_mpsc_msg_t msg;
+    if (zjs_mpsc_peek(q, &msg) || CB_IS_COMMAND(msg.value)) {
+        // empty, or a flush command, which must not be lost
+        return false;
+    }
+    release_signal(msg_callback_id(msg.type, msg.value), msg.data,
+                   msg.size32);
+    zjs_mpsc_consume(q, &msg);
+    queue_stats.dropped++;
+    return true;
+}
+
+static int put_overflow(zjs_callback_id id, u8_t lane, const u32_t *data,
+                        u8_t size32, int in_thread)
+{
+    // requires: the lane was just found full
+    //  effects: makes room or gives up according to the overflow policy
+    //  returns: 0 if the signal was queued, 1 if it was coalesced with one
+    //             already pending, or a negative error if it was dropped
+    if (on_main_thread() && grow_lane(lane) &&
+        !put_signal(lane, id, data, size32)) {
+        return 0;
+    }
+
+    zjs_callback_t *cb = get_callback(id);
+    switch (overflow_policy) {
+    case ZJS_CB_OVERFLOW_COALESCE:
+        // the callback will run anyway; only the new args are lost (pending
+        //   already counts this signal)
+        if (cb && !GET_SHARED(cb->flags) &&
+            ZJS_ATOMIC_LOAD(&cb->pending) > 1) {
+            queue_stats.coalesced++;
+            return 1;
+        }
+        break;
+
+    case ZJS_CB_OVERFLOW_DROP_OLDEST:
+        // only the consumer can remove messages, so from other threads and
+        //   ISRs this falls back to dropping the newest
+        if (on_main_thread()) {
+            while (discard_oldest(lane)) {
+                if (!put_signal(lane, id, data, size32)) {
+                    return 0;
+                }
+            }
+        }
+        break;
+
+    case ZJS_CB_OVERFLOW_BLOCK:
+        // the main thread would wait forever on itself, and ISRs can't wait
+        if (!on_main_thread() && !k_is_in_isr()) {
+            queue_stats.blocked++;
+            u32_t start = service_clock_us();
+            while (service_clock_us() - start < ZJS_CALLBACK_BLOCK_US) {
+                // let the main thread take callbacks while we wait
+                if (in_thread) CB_UNLOCK();
+                zjs_loop_unblock();
+                producer_wait();
+                if (in_thread) CB_LOCK();
+                if (!get_callback(id)) {
+                    return -EINVAL;
+                }
+                if (!put_signal(lane, id, data, size32)) {
+                    return 0;
+                }
+            }
+        }
+        break;
+    }
+    queue_stats.dropped++;
+    return -EMSGSIZE;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static int mark_signaled(zjs_callback_t *cb, const void *args, u32_t size)
+{
+    // requires: cb is a coalescing callback
+    //  effects: sets cb's pending bit and, for latest-value-wins, replaces
+    //             its latest args
+    //  returns: 1 if a signal was already waiting, so this one is merged into
+    //             it, 0 if the caller must queue one, or -EMSGSIZE if args are
+    //             too big
+    u16_t index = cb->id & CB_INDEX_MASK;
+    u32_t mask = SIGNAL_MASK(index);
+    u32_t old;
+    if (cb->latest) {
+        u8_t size32 = (size + 3) / 4;
+        if (size32 > cb->latest_max32) {
+            return -EMSGSIZE;
+        }
+        unsigned int key = 0;
+        LATEST_LOCK(key);
+        if (size) {
+            // zero the tail of a partial last word
+            cb->latest[size32 - 1] = 0;
+            memcpy(cb->latest, args, size);
+        }
+        cb->latest_size32 = size32;
+        old = ZJS_ATOMIC_OR(SIGNAL_WORD(index), mask);
+        LATEST_UNLOCK(key);
+    } else {
+        old = ZJS_ATOMIC_OR(SIGNAL_WORD(index), mask);
+    }
+    return (old & mask) ? 1 : 0;
+}
+
+static u8_t take_latest(zjs_callback_t *cb, u32_t *data)
+{
+    // requires: main thread, cb is a coalescing callback being dispatched,
+    //             data has room for cb->latest_max32 words
+    //  effects: clears cb's pending bit, so later signals queue again, and
+    //             copies out its latest args
+    //  returns: number of words copied
+    u16_t index = cb->id & CB_INDEX_MASK;
+    u32_t mask = SIGNAL_MASK(index);
+    if (!cb->latest) {
+        ZJS_ATOMIC_AND(SIGNAL_WORD(index), ~mask);
+        return 0;
+    }
+    unsigned int key = 0;
+    LATEST_LOCK(key);
+    ZJS_ATOMIC_AND(SIGNAL_WORD(index), ~mask);
+    u8_t size32 = cb->latest_size32;
+    memcpy(data, cb->latest, size32 * sizeof(u32_t));
+    LATEST_UNLOCK(key);
+    return size32;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+int signal_callback_priv(zjs_callback_id id,
+                         const void *args,
+                         u32_t size)
 {
 #ifdef DEBUG_CALLBACKS
-    DBG_PRINT("pushing item to ring buffer. id=%d, args=%p, size=%u\n", id,
-              args, size);
+    DBG_PRINT("pushing item to callback queue. id=%d, args=%p, size=%u\n",
+              id, args, size);
 #endif
     int in_thread = k_is_preempt_thread();  // versus ISR or co-op thread
-#ifndef ZJS_LINUX_BUILD
-    int key = 0;
-#endif
     if (in_thread) CB_LOCK();
-    if (id < 0 || id >= cb_size || !cb_map[id]) {
+    zjs_callback_t *cb = get_callback(id);
+    if (!cb) {
         DBG_PRINT("callback ID %d does not exist\n", id);
         if (in_thread) CB_UNLOCK();
-        return;
+        return -EINVAL;
     }
-    if (GET_CB_REMOVED(cb_map[id]->flags)) {
+    if (GET_CB_REMOVED(cb->flags)) {
         DBG_PRINT("callback already removed\n");
         if (in_thread) CB_UNLOCK();
-        return;
+        return -EINVAL;
+    }
+    bool coalesce = GET_COALESCE(cb->flags);
+    if (coalesce) {
+        int ret = mark_signaled(cb, args, size);
+        if (ret) {
+            // merged into the signal already waiting, or args too big
+            if (in_thread) CB_UNLOCK();
+            return ret == 1 ? 0 : ret;
+        }
+        // the first signal since the last dispatch only marks its place in
+        //   the lane; args are picked up from the latest args at dispatch
+        size = 0;
     }
-    if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+    if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
         // for JS, acquire values and release them after servicing callback
         int argc = size / sizeof(jerry_value_t);
         jerry_value_t *values = (jerry_value_t *)args;
@@ -417,34 +866,49 @@ void signal_callback_priv(zjs_callback_id id,
             jerry_acquire_value(values[i]);
         }
     }
-#ifdef INSTRUMENT_CALLBACKS
-    set_info_string(cb_map[id]->caller, file, func);
+    u8_t lane = GET_LANE(cb->flags);
+    const u32_t *data = (const u32_t *)args;
+    u8_t size32 = (size + 3) / 4;
+#ifdef ZJS_TRACE_CALLBACKS
+    // put the signal time ahead of the args, so dispatch can find the delay
+    u32_t traced[1 + size32];
+    traced[0] = service_clock_us();
+    if (size) {
+        // zero the tail of a partial last word
+        traced[size32] = 0;
+        memcpy(&traced[1], args, size);
+    }
+    data = traced;
+    size32++;
 #endif
-#ifndef ZJS_LINUX_BUILD
-    if (in_thread) {
-        RB_LOCK();
-        key = irq_lock();
-    }
-#endif
-    int ret = zjs_port_ring_buf_put(&ring_buffer,
-                                    (u16_t)id,
-                                    0,  // we use value for CB_FLUSH_ONE/ALL
-                                    (u32_t *)args,
-                                    (u8_t)((size + 3) / 4));
-    // Need to unlock here or callback may be blocked when it gets called.
-    // NOTE: this is a temporary fix, we should implement a lock ID system
-    // rather than locking everything, as we are only trying to prevent a
-    // callback
-    // from being edited and called at the same time.
-#ifndef ZJS_LINUX_BUILD
-    if (in_thread) {
-        irq_unlock(key);
-        RB_UNLOCK();
+    // count it first, so dispatch never sees the count go below zero
+    ZJS_ATOMIC_INC(&cb->pending);
+    // the queue is lock-free, so this is safe from ISRs and other threads
+    int ret = put_signal(lane, id, data, size32);
+    if (ret == -EMSGSIZE) {
+        ret = put_overflow(id, lane, data, size32, in_thread);
     }
     zjs_loop_unblock();
+#ifdef ZJS_TRACE_CALLBACKS
+    if (ret == 0) {
+        // racy with other producers, but close enough for a statistic
+        u32_t depth = zjs_mpsc_count(lanes[lane]);
+        if (depth > trace_high_water[lane]) {
+            trace_high_water[lane] = depth;
+        }
+    }
 #endif
     if (ret != 0) {
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+        if (ret != -EINVAL) {
+            // the callback still exists
+            ZJS_ATOMIC_DEC(&cb->pending);
+            if (coalesce && ret < 0) {
+                // let the next signal try again
+                u16_t index = id & CB_INDEX_MASK;
+                ZJS_ATOMIC_AND(SIGNAL_WORD(index), ~SIGNAL_MASK(index));
+            }
+        }
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
             // for JS, acquire values and release them after servicing callback
             int argc = size / sizeof(jerry_value_t);
             jerry_value_t *values = (jerry_value_t *)args;
@@ -453,31 +917,34 @@ void signal_callback_priv(zjs_callback_id id,
             }
         }
 
-        zjs_ringbuf_error_count++;
-        zjs_ringbuf_last_error = ret;
+        if (ret == 1) {
+            // coalesced, which is not an error
+            ret = 0;
+        } else {
+            zjs_ringbuf_error_count++;
+            zjs_ringbuf_last_error = ret;
+        }
     }
     if (in_thread) CB_UNLOCK();
+    return ret;
 }
 
 zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback)
 {
-    zjs_callback_t *new_cb = zjs_malloc(sizeof(zjs_callback_t));
+    zjs_callback_t *new_cb = new_callback();
     if (!new_cb) {
         DBG_PRINT("error allocating space for new callback\n");
         return -1;
     }
-    memset(new_cb, 0, sizeof(zjs_callback_t));
 
+    CB_LOCK();
     SET_ONCE(new_cb->flags, 0);
     SET_TYPE(new_cb->flags, CALLBACK_TYPE_C);
-    CB_LOCK();
-    new_cb->id = new_id();
+    // C callbacks bridge drivers, ISRs and other threads to the main thread
+    SET_LANE(new_cb->flags, ZJS_CB_LANE_HW);
     new_cb->function = callback;
     new_cb->handle = handle;
 
-    // Add callback to list
-    cb_map[new_cb->id] = new_cb;
-
     DBG_PRINT("adding new C callback id %d\n", new_cb->id);
     CB_UNLOCK();
     return new_cb->id;
@@ -488,14 +955,15 @@ void print_callbacks(void)
 {
     int i;
     for (i = 0; i < cb_size; i++) {
-        if (cb_map[i]) {
-            if (GET_TYPE(cb_map[i]->flags) == CALLBACK_TYPE_JS) {
-                ZJS_PRINT("[%u] JS Callback:\n\tType: ", i);
-                if (jerry_value_is_function(cb_map[i]->js_func)) {
+        zjs_callback_t *cb = CB_SLOT(i);
+        if (cb->allocated) {
+            if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
+                ZJS_PRINT("[%u] JS Callback (id %d):\n\tType: ", i, cb->id);
+                if (jerry_value_is_function(cb->js_func)) {
                     ZJS_PRINT("Single Function\n");
                     ZJS_PRINT("\tjs_func: %p\n",
-                              (void *)(uintptr_t)cb_map[i]->js_func);
-                    ZJS_PRINT("\tonce: %u\n", GET_ONCE(cb_map[i]->flags));
+                              (void *)(uintptr_t)cb->js_func);
+                    ZJS_PRINT("\tonce: %u\n", GET_ONCE(cb->flags));
                 } else {
                     ZJS_PRINT("js_func is not a function\n");
                 }
@@ -512,42 +980,338 @@ void print_callbacks(void)
 void zjs_call_callback(zjs_callback_id id, const void *data, u32_t sz)
 {
     CB_LOCK();
-    if (id == -1 || id >= cb_size || !cb_map[id]) {
+    zjs_callback_t *cb = get_callback(id);
+    if (!cb) {
         ERR_PRINT("callback %d does not exist\n", id);
-    } else if (GET_CB_REMOVED(cb_map[id]->flags)) {
+    } else if (GET_CB_REMOVED(cb->flags)) {
         DBG_PRINT("callback %d has already been removed\n", id);
     } else {
-        if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) {
+        // NOTE: slab records never move, so cb stays valid across the call
+        if (GET_TYPE(cb->flags) == CALLBACK_TYPE_JS) {
             jerry_value_t *values = (jerry_value_t *)data;
             ZVAL_MUTABLE rval;
-            if (!jerry_value_is_undefined(cb_map[id]->js_func)) {
-                rval = jerry_call_function(cb_map[id]->js_func,
-                                           cb_map[id]->this, values, sz);
+            if (!jerry_value_is_undefined(cb->js_func)) {
+                rval = jerry_call_function(cb->js_func, cb->this, values, sz);
                 if (jerry_value_is_error(rval)) {
-#ifdef INSTRUMENT_CALLBACKS
-                    DBG_PRINT("callback %d had error; creator: %s, "
-                              "caller: %s\n",
-                              id, cb_map[id]->creator, cb_map[id]->caller);
+#ifdef ZJS_TRACE_CALLBACKS
+                    DBG_PRINT("callback %d had error; creator: %s()\n", id,
+                              cb->creator ? cb->creator : "?");
 #endif
-                    zjs_print_error_message(rval, cb_map[id]->js_func);
+                    zjs_print_error_message(rval, cb->js_func);
                 }
             }
 
-            // ensure the callback wasn't deleted by the previous calls
-            if (cb_map[id]) {
-                if (cb_map[id]->post) {
-                    cb_map[id]->post(cb_map[id]->handle, rval);
+            // ensure the callback wasn't freed by the previous calls
+            if (get_callback(id)) {
+                if (cb->post) {
+                    cb->post(cb->handle, rval);
                 }
-                if (GET_ONCE(cb_map[id]->flags)) {
+                if (GET_ONCE(cb->flags)) {
                     zjs_remove_callback_priv(id, false);
                 }
             }
-        } else if (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_C &&
-                   cb_map[id]->function) {
-            cb_map[id]->function(cb_map[id]->handle, data);
+        } else if (GET_TYPE(cb->flags) == CALLBACK_TYPE_C && cb->function) {
+            cb->function(cb->handle, data);
+        }
+    }
+    CB_UNLOCK();
+}
+
+void zjs_set_callback_lane(zjs_callback_id id, u8_t lane)
+{
+    // requires: only run from main thread, before the callback is signaled
+    CB_LOCK();
+    zjs_callback_t *cb = get_callback(id);
+    if (cb && lane < ZJS_CB_LANE_COUNT) {
+        SET_LANE(cb->flags, lane);
+    }
+    CB_UNLOCK();
+}
+
+void zjs_set_callback_budget(u32_t us)
+{
+    service_budget_us = us;
+}
+
+u32_t zjs_get_callback_budget(void)
+{
+    return service_budget_us;
+}
+
+u32_t zjs_get_callback_lane_depth(u8_t lane)
+{
+    if (!queue_initialized || lane >= ZJS_CB_LANE_COUNT) {
+        return 0;
+    }
+    u32_t depth = 0;
+    for (int i = 0; i <= lane_growths[lane]; i++) {
+        depth += zjs_mpsc_count(&lane_queues[lane][i]);
+    }
+    return depth;
+}
+
+bool zjs_callbacks_pending(void)
+{
+    return zjs_get_callback_lane_depth(ZJS_CB_LANE_HW) ||
+           zjs_get_callback_lane_depth(ZJS_CB_LANE_JS);
+}
+
+void zjs_set_callback_shared(zjs_callback_id id)
+{
+    CB_LOCK();
+    zjs_callback_t *cb = get_callback(id);
+    if (cb) {
+        SET_SHARED(cb->flags);
+    }
+    CB_UNLOCK();
+}
+
+bool zjs_set_callback_coalesce(zjs_callback_id id, u32_t size)
+{
+    // requires: only run from main thread, before the callback is signaled
+    u8_t size32 = (size + 3) / 4;
+    if (size > CB_LATEST_MAX) {
+        return false;
+    }
+    CB_LOCK();
+    zjs_callback_t *cb = get_callback(id);
+    // JS args would need releasing when replaced, possibly in an ISR
+    if (!cb || GET_SHARED(cb->flags) ||
+        (size && GET_TYPE(cb->flags) == CALLBACK_TYPE_JS)) {
+        CB_UNLOCK();
+        return false;
+    }
+    u32_t *latest = NULL;
+    if (size32) {
+        latest = zjs_malloc(size32 * sizeof(u32_t));
+        if (!latest) {
+            CB_UNLOCK();
+            return false;
         }
     }
+    zjs_free(cb->latest);
+    cb->latest = latest;
+    cb->latest_max32 = size32;
+    cb->latest_size32 = 0;
+    SET_COALESCE(cb->flags);
     CB_UNLOCK();
+    return true;
+}
+
+void zjs_set_callback_overflow_policy(u8_t policy)
+{
+    if (policy <= ZJS_CB_OVERFLOW_BLOCK) {
+        overflow_policy = policy;
+    }
+}
+
+u8_t zjs_get_callback_overflow_policy(void)
+{
+    return overflow_policy;
+}
+
+void zjs_get_callback_queue_stats(zjs_callback_queue_stats_t *stats)
+{
+    *stats = queue_stats;
+    for (int i = 0; i < ZJS_CB_LANE_COUNT; i++) {
+        stats->size[i] = queue_initialized ?
+            (lanes[i]->mask + 1) * sizeof(u32_t) : 0;
+    }
+}
+
+void zjs_set_callback_overflow_handler(zjs_callback_overflow_handler handler)
+{
+    overflow_handler = handler;
+}
+
+#ifdef ZJS_TRACE_CALLBACKS
+static inline int trace_bucket(u32_t us)
+{
+    int bucket = us ? 32 - __builtin_clz(us) : 0;
+    return bucket < TRACE_BUCKETS ? bucket : TRACE_BUCKETS - 1;
+}
+
+static void trace_add(cb_trace_t *trace, u32_t queue_us, u32_t exec_us)
+{
+    trace->count++;
+    trace->queue_hist[trace_bucket(queue_us)]++;
+    trace->exec_hist[trace_bucket(exec_us)]++;
+    if (queue_us > trace->queue_max) {
+        trace->queue_max = queue_us;
+    }
+    if (exec_us > trace->exec_max) {
+        trace->exec_max = exec_us;
+    }
+}
+
+static void trace_dispatch(zjs_callback_id id, u32_t queue_us, u32_t exec_us)
+{
+    trace_add(&trace_all, queue_us, exec_us);
+    // a once callback is removed by now, but still allocated until flushed
+    zjs_callback_t *cb = get_callback(id);
+    if (cb) {
+        trace_add(&cb->trace, queue_us, exec_us);
+    }
+}
+
+static u32_t trace_percentile(const u32_t *hist, u32_t count, u32_t max,
+                              u32_t percentile)
+{
+    // returns: upper bound of the bucket holding the percentile, in us
+    u32_t rank = (count * percentile + 99) / 100;
+    u32_t seen = 0;
+    for (int i = 0; i < TRACE_BUCKETS - 1; i++) {
+        seen += hist[i];
+        if (seen >= rank) {
+            u32_t high = (1 << i) - 1;
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
+
+static void trace_print(const char *id, const char *creator,
+                        const cb_trace_t *trace)
+{
+    ZJS_PRINT("%6s %-24s %8u %6u %6u %6u %6u %6u %6u\n", id, creator,
+              trace->count,
+              trace_percentile(trace->queue_hist, trace->count,
+                               trace->queue_max, 50),
+              trace_percentile(trace->queue_hist, trace->count,
+                               trace->queue_max, 99),
+              trace->queue_max,
+              trace_percentile(trace->exec_hist, trace->count,
+                               trace->exec_max, 50),
+              trace_percentile(trace->exec_hist, trace->count,
+                               trace->exec_max, 99),
+              trace->exec_max);
+}
+
+void zjs_dump_callback_trace(void)
+{
+    ZJS_PRINT("Callback trace:\n");
+    ZJS_PRINT("  queue high water: hw %u, js %u; dropped signals: %u\n",
+              trace_high_water[ZJS_CB_LANE_HW],
+              trace_high_water[ZJS_CB_LANE_JS], queue_stats.dropped);
+    ZJS_PRINT("%6s %-24s %8s %6s %6s %6s %6s %6s %6s\n", "id", "creator",
+              "count", "q-p50", "q-p99", "q-max", "x-p50", "x-p99", "x-max");
+    trace_print("all", "", &trace_all);
+    char id[8];
+    for (int i = 0; i < cb_size; i++) {
+        zjs_callback_t *cb = CB_SLOT(i);
+        if (cb->allocated && cb->trace.count) {
+            snprintf(id, sizeof(id), "%d", cb->id);
+            trace_print(id, cb->creator ? cb->creator : "(native)", &cb->trace);
+        }
+    }
+    ZJS_PRINT("  times in microseconds; q = signal to dispatch, x = run\n");
+}
+#endif  // ZJS_TRACE_CALLBACKS
+
+static bool service_one(u8_t lane)
+{
+    // effects: services the next message in lane, if any
+    //  returns: true if a message was serviced
+    zjs_mpsc_msg_t msg;
+    zjs_mpsc_queue_t *q = NULL;
+    // queues the lane grew out of come first, as their messages are older
+    for (int i = 0; i <= lane_growths[lane]; i++) {
+        if (zjs_mpsc_peek(&lane_queues[lane][i], &msg) == 0) {
+            q = &lane_queues[lane][i];
+            break;
+        }
+    }
+    if (!q) {
+        // no more items in the lane
+        return false;
+    }
+
+    // copy the message out and release its space right away, so producers can
+    //   reuse it while the callback runs
+    zjs_callback_id id = msg_callback_id(msg.type, msg.value);
+    u8_t value = CB_IS_COMMAND(msg.value) ? msg.value : 0;
+    u8_t size = msg.size32;
+    // value is 0 for a signal rather than a flush command
+    zjs_callback_t *cb = value ? NULL : get_callback(id);
+    bool coalesced = cb && GET_COALESCE(cb->flags);
+    // a coalesced signal's args follow anything in the message
+    u32_t data[size + (coalesced ? cb->latest_max32 : 0)];
+    if (size) {
+        memcpy(data, msg.data, size * sizeof(u32_t));
+    }
+    zjs_mpsc_consume(q, &msg);
+
+    if (cb) {
+        ZJS_ATOMIC_DEC(&cb->pending);
+        if (coalesced) {
+            size += take_latest(cb, &data[size]);
+        }
+    }
+
+#ifdef ZJS_TRACE_CALLBACKS
+    // every signal has its signal time ahead of any args; flush commands have
+    //   no payload at all
+    bool traced = size > 0;
+    u32_t signaled = 0;
+    if (traced) {
+        signaled = data[0];
+        memmove(data, &data[1], --size * sizeof(u32_t));
+    }
+    u32_t dispatched = service_clock_us();
+#endif
+
+    if (size) {
+        // item in queue with size > 0, has args
+#ifdef DEBUG_CALLBACKS
+        DBG_PRINT("calling callback with args. id=%u, args=%p, sz=%u\n", id,
+                  data, size);
+#endif
+        bool is_js = cb && GET_TYPE(cb->flags) == CALLBACK_TYPE_JS;
+        zjs_call_callback(id, data, size);
+        if (is_js) {
+            for (int i = 0; i < size; i++)
+                jerry_release_value((jerry_value_t)data[i]);
+        }
+    } else {
+        // check for flush commands
+        switch (value) {
+        case CB_FLUSH_ONE:
+            DBG_PRINT("flushed callback %d, freeing\n", id);
+            zjs_free_callback(id);
+            break;
+
+        case CB_FLUSH_ALL:
+            DBG_PRINT("flushed all callbacks, freeing\n");
+            for (int i = 0; i < cb_size; i++) {
+                zjs_callback_t *cb = CB_SLOT(i);
+                if (cb->allocated)
+                    zjs_free_callback(cb->id);
+            }
+            break;
+
+        default:
+            // item in queue with size == 0, no args
+#ifdef DEBUG_CALLBACKS
+            DBG_PRINT("calling callback with no args, id=%u\n", id);
+#endif
+            zjs_call_callback(id, NULL, 0);
+        }
+    }
+#ifdef ZJS_TRACE_CALLBACKS
+    if (traced) {
+        trace_dispatch(id, dispatched - signaled,
+                       service_clock_us() - dispatched);
+    }
+#endif
+#ifdef ZJS_PRINT_CALLBACK_STATS
+    zjs_callback_t *stats_cb = get_callback(id);
+    if (stats_cb) {
+        ZJS_PRINT("[cb stats] Callback[%u]: type=%s, lane=%s, arg_sz=%u\n", id,
+                  (GET_TYPE(stats_cb->flags) == CALLBACK_TYPE_JS) ? "JS" : "C",
+                  (lane == ZJS_CB_LANE_HW) ? "hw" : "js", size);
+    }
+#endif
+    return true;
 }
 
 u8_t zjs_service_callbacks(void)
@@ -559,105 +1323,84 @@ u8_t zjs_service_callbacks(void)
         zjs_ringbuf_error_count = 0;
     }
 
-    u8_t serviced = 0;
-    if (ring_buf_initialized) {
-#ifdef ZJS_PRINT_CALLBACK_STATS
-        u8_t header_printed = 0;
-        u32_t num_callbacks = 0;
-#endif
-        u16_t count = 0;
-        while (count++ < ZJS_MAX_CB_LOOP_ITERATION) {
-            int ret;
-            u16_t id;
-            u8_t value;
-            u8_t size = 0;
-            // set size = 0 to check if there is an item in the ring buffer
-            RB_LOCK();
-            ret = zjs_port_ring_buf_get(&ring_buffer, &id, &value, NULL, &size);
-            RB_UNLOCK();
-            if (ret == -EMSGSIZE || ret == 0) {
-                serviced = 1;
-                // item in ring buffer with size > 0, has args
-                // pull from ring buffer
-                u8_t sz = size;
-                u32_t data[sz];
-                if (ret == -EMSGSIZE) {
-                    RB_LOCK();
-                    ret = zjs_port_ring_buf_get(&ring_buffer, &id, &value, data,
-                                                &sz);
-                    RB_UNLOCK();
-                    if (ret != 0) {
-                        ERR_PRINT("pulling from ring buffer: ret = %u\n", ret);
-                        break;
-                    }
-#ifdef DEBUG_CALLBACKS
-                    DBG_PRINT("calling callback with args. id=%u, args=%p, "
-                              "sz=%u, ret=%i\n", id, data, sz, ret);
-#endif
-                    bool is_js = GET_TYPE(cb_map[id]->flags) ==
-                        CALLBACK_TYPE_JS;
-                    zjs_call_callback(id, data, sz);
-                    if (is_js) {
-                        for (int i = 0; i < sz; i++)
-                            jerry_release_value((jerry_value_t)data[i]);
-                    }
-                } else if (ret == 0) {
-                    // check for flush commands
-                    switch (value) {
-                    case CB_FLUSH_ONE:
-                        DBG_PRINT("flushed callback %d, freeing\n", id);
-                        zjs_free_callback(id);
-                        break;
-
-                    case CB_FLUSH_ALL:
-                        DBG_PRINT("flushed all callbacks, freeing\n");
-                        for (int i = 0; i < cb_size; i++)
-                            zjs_free_callback(i);
-                        break;
-
-                    default:
-                        // item in ring buffer with size == 0, no args
-#ifdef DEBUG_CALLBACKS
-                        DBG_PRINT("calling callback with no args, "
-                                  "original vals id=%u, size=%u, ret=%i\n",
-                                  id, size, ret);
-#endif
-                        zjs_call_callback(id, NULL, 0);
-                    }
-                }
+    if (!queue_initialized) {
+        return 0;
+    }
+
+    // report signals lost or delayed since the last pass
+    u32_t overflows = queue_stats.dropped + queue_stats.coalesced +
+                      queue_stats.blocked;
+    if (overflows != overflow_reported) {
+        overflow_reported = overflows;
+        if (overflow_handler) {
+            overflow_handler();
+        }
+    }
+
 #ifdef ZJS_PRINT_CALLBACK_STATS
-                if (!header_printed) {
-                    ZJS_PRINT("\n--------- Callback Stats ------------\n");
-                    header_printed = 1;
-                }
-                if (cb_map[id]) {
-                    ZJS_PRINT("[cb stats] Callback[%u]: type=%s, arg_sz=%u\n", id,
-                              (GET_TYPE(cb_map[id]->flags) == CALLBACK_TYPE_JS) ? "JS" : "C",
-                              size);
-                }
-                num_callbacks++;
+    if (zjs_get_callback_lane_depth(ZJS_CB_LANE_HW) ||
+        zjs_get_callback_lane_depth(ZJS_CB_LANE_JS)) {
+        ZJS_PRINT("\n--------- Callback Stats ------------\n");
+    }
 #endif
-            } else {
-                // no more items in ring buffer
+    // hardware signals go first and may use the whole budget, but each lane
+    //   gets at least one item per pass so neither can starve the other
+    u32_t num_callbacks = 0;
+    u32_t start = service_clock_us();
+    for (int i = 0; i < ZJS_CB_LANE_COUNT; i++) {
+        u8_t lane = (i == 0) ? ZJS_CB_LANE_HW : ZJS_CB_LANE_JS;
+        bool first = true;
+        while (first || service_clock_us() - start < service_budget_us) {
+            if (!service_one(lane)) {
                 break;
             }
+            num_callbacks++;
+            first = false;
         }
+    }
 #ifdef ZJS_PRINT_CALLBACK_STATS
-        if (num_callbacks) {
-            ZJS_PRINT("[cb stats] Number of Callbacks (this service): %u\n",
-                      num_callbacks);
-            ZJS_PRINT("[cb stats] Max Callbacks Per Service: %u\n",
-                      ZJS_MAX_CB_LOOP_ITERATION);
-            ZJS_PRINT("------------- End ----------------\n");
-        }
+    if (num_callbacks) {
+        ZJS_PRINT("[cb stats] Number of Callbacks (this service): %u\n",
+                  num_callbacks);
+        ZJS_PRINT("[cb stats] Time Spent: %u us (budget %u us)\n",
+                  service_clock_us() - start, service_budget_us);
+        ZJS_PRINT("------------- End ----------------\n");
+    }
 #endif
+    return num_callbacks ? 1 : 0;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+bool zjs_on_main_thread()
+{
+    return on_main_thread();
+}
+
+void zjs_defer_block(zjs_deferred_work callback, zjs_msgblock_t *block)
+{
+    DBG_PRINT("deferring block: %u bytes\n", zjs_msgblock_size(block));
+    deferred_block_t defer;
+    defer.callback = callback;
+    defer.block = block;
+    if (zjs_signal_callback(defer_block_id, &defer, sizeof(defer))) {
+        // never reaches the main thread, so release the block here
+        zjs_msgblock_unref(block);
     }
-    return serviced;
 }
 
 void zjs_defer_work(zjs_deferred_work callback, const void *buffer, u32_t bytes)
 {
     DBG_PRINT("deferring work: %d bytes\n", bytes);
+    if (bytes > ZJS_DEFER_INLINE_MAX) {
+        // keep large payloads off the stack and out of the queue
+        zjs_msgblock_t *block = zjs_msgblock_alloc(bytes);
+        if (block) {
+            memcpy(zjs_msgblock_data(block), buffer, bytes);
+            zjs_defer_block(callback, block);
+            return;
+        }
+        DBG_PRINT("no message block free, copying into queue\n");
+    }
     int len = sizeof(deferred_work_t) + bytes;
     char buf[len];
     deferred_work_t *defer = (deferred_work_t *)buf;
@@ -7,12 +7,41 @@
 
 // ZJS includes
 #include "zjs_common.h"
+#include "zjs_msgblock.h"
 
-#ifdef DEBUG_BUILD
-//#define INSTRUMENT_CALLBACKS
-#endif
+typedef s32_t zjs_callback_id;
+
+// callback IDs hold a slot index in these low bits and a 16-bit generation
+//   count above it, so IDs of removed callbacks are never reused right away;
+//   this also limits how many callbacks can exist at once
+#define ZJS_CALLBACK_INDEX_BITS 15
+
+// the slot index of a callback ID, slots themselves are recycled
+#define zjs_callback_index(id) ((id) & ((1 << ZJS_CALLBACK_INDEX_BITS) - 1))
+
+// signaled callbacks wait in one of these lanes; the hardware lane is serviced
+//   first each pass, and each lane gets at least one callback per pass
+#define ZJS_CB_LANE_HW    0  // default for C callbacks (drivers, ISRs)
+#define ZJS_CB_LANE_JS    1  // default for JS callbacks
+#define ZJS_CB_LANE_COUNT 2
+
+// what to do with a signal when its lane is full; on Linux a full lane first
+//   grows, up to a limit, before the policy applies
+#define ZJS_CB_OVERFLOW_DROP_NEWEST 0  // drop the new signal (default)
+#define ZJS_CB_OVERFLOW_DROP_OLDEST 1  // drop the oldest signal in the lane
+#define ZJS_CB_OVERFLOW_COALESCE    2  // drop the new signal if the same
+                                       //   callback already has one pending
+#define ZJS_CB_OVERFLOW_BLOCK       3  // make the producer thread wait
 
-typedef s16_t zjs_callback_id;
+typedef struct zjs_callback_queue_stats {
+    u32_t size[ZJS_CB_LANE_COUNT];  // current size of each lane in bytes
+    u32_t dropped;    // signals lost, newest or oldest depending on policy
+    u32_t coalesced;  // signals merged into one already pending
+    u32_t blocked;    // times a producer thread waited for room
+    u32_t grown;      // times a lane grew
+} zjs_callback_queue_stats_t;
+
+typedef void (*zjs_callback_overflow_handler)(void);
 
 /*
  * Function that will be called AFTER the JS function is called.
@@ -61,26 +90,19 @@ void zjs_remove_callback(zjs_callback_id id);
  */
 void zjs_remove_all_callbacks(void);
 
-void signal_callback_priv(zjs_callback_id id,
-                          const void *args,
-                          u32_t size
-#ifdef INSTRUMENT_CALLBACKS
-                          ,
-                          const char *file,
-                          const char *func);
-#else
-                          );
-#endif
+int signal_callback_priv(zjs_callback_id id,
+                         const void *args,
+                         u32_t size);
 
-#ifndef INSTRUMENT_CALLBACKS
 /*
  * Signal the system to make a callback. The callback will not be called
  * immediately, but rather once the system has time to service the callback
  * module; this allows the system to fairly share CPU time as well as prevent
  * large recursion loops. Signaling a callback will cause the callback to be
- * called only once, and will NOT remove the callback from the list. You can
- * signal callbacks multiple times, but if the callback has not been serviced
- * between signaling, it will only get called once.
+ * called only once, and will NOT remove the callback from the list. Each signal
+ * normally leads to its own call, but for a callback set up with
+ * zjs_set_callback_coalesce(), signals before the callback has been serviced
+ * collapse into one call.
  *
  * For a JS callback, the arguments are of type jerry_value_t and they will be
  * acquired by the callback module and released when the callback fires. So the
@@ -93,27 +115,25 @@ void signal_callback_priv(zjs_callback_id id,
  * @param id            ID returned from zjs_add_callback
  * @param args          Arguments given to the JS/C callback
  * @param size          Size of arguments (in bytes)
+ *
+ * @return              0 on success, -EINVAL if the callback doesn't exist, or
+ *                        -EMSGSIZE if the queue is full
  */
 #define zjs_signal_callback(id, args, size) signal_callback_priv(id, args, size)
-#else
-#define zjs_signal_callback(id, args, size) \
-    signal_callback_priv(id, args, size, __FILE__, __func__)
-#endif
 
 zjs_callback_id add_callback_priv(jerry_value_t js_func,
                                   jerry_value_t this,
                                   void *handle,
                                   zjs_post_callback_func post,
                                   u8_t once
-#ifdef INSTRUMENT_CALLBACKS
+#ifdef ZJS_TRACE_CALLBACKS
                                   ,
-                                  const char *file,
-                                  const char *func);
+                                  const char *creator);
 #else
                                   );
 #endif
 
-#ifndef INSTRUMENT_CALLBACKS
+#ifndef ZJS_TRACE_CALLBACKS
 /*
 * Add/register a callback function
 *
@@ -141,10 +161,11 @@ zjs_callback_id add_callback_priv(jerry_value_t js_func,
 #define zjs_add_callback_once(func, this, handle, post) \
     add_callback_priv(func, this, handle, post, 1);
 #else
+// when tracing, remember the function that created each callback for the dump
 #define zjs_add_callback(func, this, handle, post) \
-    add_callback_priv(func, this, handle, post, 0, __FILE__, __func__)
+    add_callback_priv(func, this, handle, post, 0, __func__)
 #define zjs_add_callback_once(func, this, handle, post) \
-    add_callback_priv(func, this, handle, post, 1, __FILE__, __func__);
+    add_callback_priv(func, this, handle, post, 1, __func__);
 #endif
 
 /*
@@ -171,14 +192,116 @@ zjs_callback_id zjs_add_c_callback(void *handle, zjs_c_callback_func callback);
 void zjs_call_callback(zjs_callback_id id, const void *data, u32_t sz);
 
 /*
- * Service the callback module. Any callback's that have been signaled will
- * be serviced and the signal flag will be unset.
+ * Service the callback module. Signaled callbacks are serviced, hardware lane
+ * first, until the time budget for this pass runs out; the rest wait for the
+ * next pass.
  *
  * @return              1 if any callbacks were processed
  *                      0 if no callbacks were processed
  */
 u8_t zjs_service_callbacks(void);
 
+/*
+ * Move a callback to a different lane, e.g. a JS callback signaled from an ISR
+ * that should be serviced with other hardware events
+ *
+ * @param id            ID of callback
+ * @param lane          ZJS_CB_LANE_HW or ZJS_CB_LANE_JS
+ */
+void zjs_set_callback_lane(zjs_callback_id id, u8_t lane);
+
+/*
+ * Set the time budget for each zjs_service_callbacks() pass
+ *
+ * @param us            Budget in microseconds; 0 services one callback per
+ *                        lane per pass
+ */
+void zjs_set_callback_budget(u32_t us);
+
+/*
+ * Get the time budget for each zjs_service_callbacks() pass, in microseconds
+ */
+u32_t zjs_get_callback_budget(void);
+
+/*
+ * Get the number of signaled callbacks waiting in a lane
+ *
+ * @param lane          ZJS_CB_LANE_HW or ZJS_CB_LANE_JS
+ */
+u32_t zjs_get_callback_lane_depth(u8_t lane);
+
+/*
+ * Check whether signaled callbacks are still waiting, e.g. because the last
+ * zjs_service_callbacks() pass ran out of budget; the main loop must not sleep
+ * then, since the wakeup for those signals has already been used up
+ */
+bool zjs_callbacks_pending(void);
+
+#ifdef ZJS_TRACE_CALLBACKS
+/*
+ * Print callback trace statistics: per-lane queue high-water marks, dropped
+ * signals, and signal-to-dispatch delay and execution time for each callback
+ */
+void zjs_dump_callback_trace(void);
+#endif
+
+/*
+ * Mark a callback as carrying unrelated work in each signal, e.g. deferred
+ * work or events, so its signals are never coalesced
+ *
+ * @param id            ID of callback
+ */
+void zjs_set_callback_shared(zjs_callback_id id);
+
+/*
+ * Make signals to a callback collapse into one call while one is waiting, so
+ * a noisy source such as a GPIO interrupt can't flood the queue; a repeated
+ * signal costs one atomic operation and the callback runs once
+ *
+ * With size 0 the callback is called with no args, and any signaled args are
+ * ignored. Otherwise the latest signal's args win: each signal replaces the
+ * args saved for the call, and signals with more than size bytes of args
+ * fail with -EMSGSIZE. Only C callbacks can keep args this way, and callbacks
+ * marked with zjs_set_callback_shared() can't coalesce at all.
+ *
+ * @param id            ID of callback
+ * @param size          Most bytes of args to keep, up to 64, or 0 for none
+ *
+ * @return              true on success
+ */
+bool zjs_set_callback_coalesce(zjs_callback_id id, u32_t size);
+
+/*
+ * Set what happens to a signal when its lane is full
+ *
+ * Dropping the oldest signal only works when signaling from the main thread,
+ * and blocking only from other threads; otherwise the new signal is dropped.
+ *
+ * @param policy        One of the ZJS_CB_OVERFLOW_* values
+ */
+void zjs_set_callback_overflow_policy(u8_t policy);
+
+/*
+ * Get the current ZJS_CB_OVERFLOW_* policy
+ */
+u8_t zjs_get_callback_overflow_policy(void);
+
+/*
+ * Get callback queue sizes and overflow counts since init
+ *
+ * @param stats         Filled in with the current statistics
+ */
+void zjs_get_callback_queue_stats(zjs_callback_queue_stats_t *stats);
+
+/*
+ * Set a function to call from the main thread after signals have been dropped,
+ * coalesced or blocked because a lane was full; it's called at most once per
+ * zjs_service_callbacks() pass
+ *
+ * @param handler       Function to call, or NULL for none
+ */
+void zjs_set_callback_overflow_handler(zjs_callback_overflow_handler handler);
+
 typedef void (*zjs_deferred_work)(const void *buffer, u32_t length);
 
 /**
@@ -190,9 +313,11 @@ typedef void (*zjs_deferred_work)(const void *buffer, u32_t length);
  * the callback will be called with a copy of the supplied buffer and the same
  * length provided.
  *
- * NOTE: A buffer a little bigger than 'bytes' will be allocated on the stack
- * in this function, so bytes should be reasonably small to not cause a stack
- * overflow.
+ * NOTE: Larger buffers are copied into a message block when one is free, but
+ * otherwise a buffer a little bigger than 'bytes' will be allocated on the
+ * stack in this function, so bytes should be reasonably small to not cause a
+ * stack overflow. To hand off large data without copying, use
+ * zjs_defer_block().
  *
  * @param callback      Function to be called from main thread to process work
  * @param buffer        Data needed to call function
@@ -201,4 +326,30 @@ typedef void (*zjs_deferred_work)(const void *buffer, u32_t length);
 void zjs_defer_work(zjs_deferred_work callback, const void *buffer,
                     u32_t bytes);
 
+/**
+ * Defers work on a message block to a callback run on the main thread
+ *
+ * Only the block handle goes through the callback queue, so the payload is
+ * never copied. The caller's reference passes to the callback module, which
+ * releases it after the callback returns; the callback can keep the block
+ * longer with zjs_msgblock_ref(zjs_msgblock_from_data(buffer)). If the queue
+ * is full the block is released right away and the work is dropped.
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param callback      Called with the block's payload and size
+ * @param block         Block from zjs_msgblock_alloc(), filled in
+ */
+void zjs_defer_block(zjs_deferred_work callback, zjs_msgblock_t *block);
+
+/**
+ * Test whether the caller is the main thread, where JerryScript can be used
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @return              False from interrupts, other threads, or before
+ *                        zjs_init_callbacks()
+ */
+bool zjs_on_main_thread();
+
 #endif /* SRC_ZJS_CALLBACKS_H_ */
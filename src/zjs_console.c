@@ -5,6 +5,7 @@
 // ZJS includes
 #include "zjs_common.h"
 #include "zjs_error.h"
+#include "zjs_hrtime.h"
 #include "zjs_util.h"
 #ifdef ZJS_LINUX_BUILD
 #include "zjs_linux_port.h"
@@ -180,9 +181,7 @@ static ZJS_DECL_FUNC(console_time)
     // args: label
     ZJS_VALIDATE_ARGS(Z_STRING);
 
-    u32_t start = zjs_port_timer_get_uptime();
-
-    ZVAL num = jerry_create_number(start);
+    ZVAL num = jerry_create_number(zjs_hrtime_ns());
     jerry_set_property(gbl_time_obj, argv[0], num);
     return ZJS_UNDEFINED;
 }
@@ -199,8 +198,9 @@ static ZJS_DECL_FUNC(console_time_end)
         return TYPE_ERROR("unexpected value");
     }
 
-    u32_t start = (u32_t)jerry_get_number_value(num);
-    unsigned int milli = zjs_port_timer_get_uptime() - start;
+    u64_t ns = zjs_hrtime_ns() - (u64_t)jerry_get_number_value(num);
+    u32_t milli = ns / 1000000;
+    u32_t micro = ns / 1000 % 1000;
 
     char *label = zjs_alloc_from_jstring(argv[0], NULL);
     const char *const_label = "unknown";
@@ -209,7 +209,7 @@ static ZJS_DECL_FUNC(console_time_end)
     }
 
     // this print is part of the expected behavior for the user, don't remove
-    ZJS_PRINT("%s: %ums\n", const_label, milli);
+    ZJS_PRINT("%s: %u.%03ums\n", const_label, milli, micro);
     zjs_free(label);
     return ZJS_UNDEFINED;
 }
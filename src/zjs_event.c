@@ -14,31 +14,476 @@
 static jerry_value_t zjs_event_emitter_prototype = 0;
 zjs_callback_id emit_id = -1;
 
+// event names are interned as atoms, small integers that stand in for the
+//   name, so finding an event is a table lookup rather than a string compare
+//   and deferred emits carry two bytes instead of the name; names that C
+//   modules emit are in a static table that any thread can look up, and
+//   other names are added from the main thread as listeners are added and
+//   freed when no emitter has an event by that name any more
+typedef u16_t atom_t;
+#define ATOM_NONE 0
+
+static const char *const static_atoms[] = {
+    NULL,  // ATOM_NONE
+    "data", "close", "error", "message", "end", "open", "connect",
+    "connection", "disconnect", "listening", "timeout", "change", "update",
+    "read", "accept", "ping", "pong", "netup", "netdown", "overflow",
+    "stateChange", "rssiUpdate", "advertisingStart", "devicefound",
+    "resourcefound", "platformfound", "retrieve", "delete"
+};
+#define STATIC_ATOM_COUNT (sizeof(static_atoms) / sizeof(char *))
+
+// open addressed index of static atoms, filled in once before any emitter
+//   exists and read-only after that
+#define STATIC_INDEX_SIZE 64
+static u8_t static_index[STATIC_INDEX_SIZE];
+
+// names added at runtime get atoms from STATIC_ATOM_COUNT up, counted by the
+//   events that use them, and are reused once free; index entries are u16_t
+//   positions plus one, so at most MAX_DYNAMIC_ATOMS names can be live at
+//   once; only touched from the main thread
+#define MAX_DYNAMIC_ATOMS 32768
+typedef struct dynamic_atom {
+    char *name;  // NULL if free
+    u32_t refs;  // events on any emitter with this name; if free, the next
+                 //   free atom's position plus one, or 0
+} dynamic_atom_t;
+
+static dynamic_atom_t *dynamic_atoms = NULL;
+static u16_t dynamic_count = 0;  // atoms handed out, including free ones
+static u16_t dynamic_free = 0;   // first free atom's position plus one, or 0
+static u16_t dynamic_size = 0;
+static u16_t *dynamic_index = NULL;  // twice dynamic_size slots
+
 typedef struct listener {
     jerry_value_t func;
-    struct listener *next;
+    bool once;  // remove before the first call
 } listener_t;
 
-// allocate sizeof(event_t) + len(name)
+// listener arrays are copied on write: an emit holds a reference to the array
+//   it is walking, so listeners added or removed meanwhile go into a new copy
+//   and every emit calls a consistent snapshot
+typedef struct listener_list {
+    u16_t refs;   // one for the event, plus one per emit in progress
+    u16_t count;
+    u16_t size;
+    u16_t once;   // number of one-shot listeners
+    listener_t items[];
+} listener_list_t;
+
 typedef struct event {
-    struct event *next;
-    listener_t *listeners;
-    int namelen;
-    char name[1];
+    atom_t atom;
+    listener_list_t *list;  // NULL when there are no listeners
 } event_t;
 
+// flags for add_listener_flags
+#define LISTENER_ONCE    1
+#define LISTENER_PREPEND 2
+
 typedef struct emitter {
     int max_listeners;
+    // events in the order they were added, followed in the same block by an
+    //   open addressed index of twice size slots, each the position of an
+    //   event plus one, or 0 if empty
     event_t *events;
+    u16_t count;
+    u16_t size;
     void *user_handle;
     zjs_event_free user_free;
 } emitter_t;
 
-static void free_listener(void *ptr)
+// like atoms, each emitter's index holds u16_t positions plus one
+#define MAX_EVENTS 32768
+
+#define EVENT_INDEX(handle) ((u16_t *)((handle)->events + (handle)->size))
+
+static u32_t hash_name(const char *name)
+{
+    // FNV-1a
+    u32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (u8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+static void init_static_atoms()
+{
+    // effects: fills in the static atom index; called from the main thread
+    //            before any emitter exists
+    ZJS_ASSERT(STATIC_ATOM_COUNT * 2 <= STATIC_INDEX_SIZE,
+               "STATIC_INDEX_SIZE too small");
+    memset(static_index, 0, sizeof(static_index));
+    for (int i = 1; i < STATIC_ATOM_COUNT; i++) {
+        u32_t slot = hash_name(static_atoms[i]);
+        while (static_index[slot & (STATIC_INDEX_SIZE - 1)]) {
+            slot++;
+        }
+        static_index[slot & (STATIC_INDEX_SIZE - 1)] = i;
+    }
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+static atom_t find_static_atom(const char *name, u32_t hash)
+{
+    // effects: returns the static atom for name, or ATOM_NONE
+    for (u32_t slot = hash;; slot++) {
+        u8_t atom = static_index[slot & (STATIC_INDEX_SIZE - 1)];
+        if (atom == ATOM_NONE || !strcmp(static_atoms[atom], name)) {
+            return atom;
+        }
+    }
+}
+
+static atom_t find_atom(const char *name)
+{
+    // requires: called from the main thread
+    //  effects: returns the atom for name, or ATOM_NONE if it was never
+    //             interned, in which case no emitter has listeners for it
+    u32_t hash = hash_name(name);
+    atom_t atom = find_static_atom(name, hash);
+    if (atom != ATOM_NONE || !dynamic_size) {
+        return atom;
+    }
+    u32_t mask = dynamic_size * 2 - 1;
+    for (u32_t slot = hash;; slot++) {
+        u16_t i = dynamic_index[slot & mask];
+        if (!i || !strcmp(dynamic_atoms[i - 1].name, name)) {
+            return i ? STATIC_ATOM_COUNT + i - 1 : ATOM_NONE;
+        }
+    }
+}
+
+static void index_dynamic_atoms()
+{
+    // effects: rebuilds the dynamic atom index from the live atoms
+    u32_t mask = dynamic_size * 2 - 1;
+    memset(dynamic_index, 0, dynamic_size * 2 * sizeof(u16_t));
+    for (u16_t i = 0; i < dynamic_count; i++) {
+        if (!dynamic_atoms[i].name) {
+            continue;
+        }
+        u32_t slot = hash_name(dynamic_atoms[i].name);
+        while (dynamic_index[slot & mask]) {
+            slot++;
+        }
+        dynamic_index[slot & mask] = i + 1;
+    }
+}
+
+static void unindex_dynamic_atom(u16_t i)
+{
+    // requires: atom position i is live and in the index
+    //  effects: removes it from the index, moving later entries in its probe
+    //             run back into the gap so no lookup stops short; touches only
+    //             that run, not the whole index
+    u32_t mask = dynamic_size * 2 - 1;
+    u32_t hole = hash_name(dynamic_atoms[i].name) & mask;
+    while (dynamic_index[hole] != i + 1) {
+        hole = (hole + 1) & mask;
+    }
+    for (u32_t slot = (hole + 1) & mask; dynamic_index[slot];
+         slot = (slot + 1) & mask) {
+        u16_t entry = dynamic_index[slot];
+        u32_t home = hash_name(dynamic_atoms[entry - 1].name) & mask;
+        // an entry can fill the hole unless it hashes to a slot after it
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            dynamic_index[hole] = entry;
+            hole = slot;
+        }
+    }
+    dynamic_index[hole] = 0;
+}
+
+static atom_t intern_atom(const char *name)
+{
+    // requires: called from the main thread
+    //  effects: returns the atom for name with a reference taken for the
+    //             caller, adding it if needed; returns ATOM_NONE if out of
+    //             memory or atoms
+    atom_t atom = find_atom(name);
+    if (atom != ATOM_NONE) {
+        if (atom >= STATIC_ATOM_COUNT) {
+            dynamic_atoms[atom - STATIC_ATOM_COUNT].refs++;
+        }
+        return atom;
+    }
+    if (!dynamic_free && dynamic_count == dynamic_size) {
+        // grow the name table and rebuild the index at twice the size
+        u32_t size = dynamic_size ? dynamic_size * 2 : 16;
+        if (size > MAX_DYNAMIC_ATOMS) {
+            return ATOM_NONE;
+        }
+        dynamic_atom_t *atoms = zjs_malloc(size * sizeof(dynamic_atom_t));
+        u16_t *index = zjs_malloc(size * 2 * sizeof(u16_t));
+        if (!atoms || !index) {
+            zjs_free(atoms);
+            zjs_free(index);
+            return ATOM_NONE;
+        }
+        memcpy(atoms, dynamic_atoms, dynamic_count * sizeof(dynamic_atom_t));
+        zjs_free(dynamic_atoms);
+        zjs_free(dynamic_index);
+        dynamic_atoms = atoms;
+        dynamic_index = index;
+        dynamic_size = size;
+        index_dynamic_atoms();
+    }
+
+    char *copy = zjs_malloc(strlen(name) + 1);
+    if (!copy) {
+        return ATOM_NONE;
+    }
+    strcpy(copy, name);
+
+    // reuse a free atom, if any
+    u16_t i = dynamic_count;
+    if (dynamic_free) {
+        i = dynamic_free - 1;
+        dynamic_free = dynamic_atoms[i].refs;
+    } else {
+        dynamic_count++;
+    }
+    dynamic_atoms[i].name = copy;
+    dynamic_atoms[i].refs = 1;
+
+    u32_t mask = dynamic_size * 2 - 1;
+    u32_t slot = hash_name(name);
+    while (dynamic_index[slot & mask]) {
+        slot++;
+    }
+    dynamic_index[slot & mask] = i + 1;
+    return STATIC_ATOM_COUNT + i;
+}
+
+static void release_atom(atom_t atom)
+{
+    // requires: called from the main thread, atom came from intern_atom
+    //  effects: drops a reference to atom, freeing a dynamic atom's name
+    //             after the last one
+    if (atom < STATIC_ATOM_COUNT || !dynamic_atoms) {
+        // jerry_cleanup() frees objects in no set order, so the prototype
+        //   may already have freed the whole table
+        return;
+    }
+    u16_t i = atom - STATIC_ATOM_COUNT;
+    dynamic_atom_t *dynamic = &dynamic_atoms[i];
+    if (--dynamic->refs) {
+        return;
+    }
+    unindex_dynamic_atom(i);
+    zjs_free(dynamic->name);
+    dynamic->name = NULL;
+    dynamic->refs = dynamic_free;
+    dynamic_free = i + 1;
+}
+
+static const char *atom_name(atom_t atom)
+{
+    if (atom < STATIC_ATOM_COUNT) {
+        return atom == ATOM_NONE ? "" : static_atoms[atom];
+    }
+    return dynamic_atoms[atom - STATIC_ATOM_COUNT].name;
+}
+
+static void free_dynamic_atoms()
 {
-    listener_t *listener = (listener_t *)ptr;
-    jerry_release_value(listener->func);
-    zjs_free(listener);
+    for (u16_t i = 0; i < dynamic_count; i++) {
+        zjs_free(dynamic_atoms[i].name);
+    }
+    zjs_free(dynamic_atoms);
+    zjs_free(dynamic_index);
+    dynamic_atoms = NULL;
+    dynamic_index = NULL;
+    dynamic_count = dynamic_free = dynamic_size = 0;
+}
+
+static event_t *find_event(emitter_t *handle, atom_t atom)
+{
+    // effects: returns the emitter's event for atom, or NULL
+    if (!handle->size || atom == ATOM_NONE) {
+        return NULL;
+    }
+    u16_t *index = EVENT_INDEX(handle);
+    u32_t mask = handle->size * 2 - 1;
+    for (u32_t slot = atom;; slot++) {
+        u16_t i = index[slot & mask];
+        if (!i) {
+            return NULL;
+        }
+        if (handle->events[i - 1].atom == atom) {
+            return &handle->events[i - 1];
+        }
+    }
+}
+
+static void index_events(emitter_t *handle)
+{
+    // effects: rebuilds the emitter's event index
+    u16_t *index = EVENT_INDEX(handle);
+    u32_t mask = handle->size * 2 - 1;
+    memset(index, 0, handle->size * 2 * sizeof(u16_t));
+    for (u16_t i = 0; i < handle->count; i++) {
+        u32_t slot = handle->events[i].atom;
+        while (index[slot & mask]) {
+            slot++;
+        }
+        index[slot & mask] = i + 1;
+    }
+}
+
+static event_t *add_event(emitter_t *handle, atom_t atom)
+{
+    // requires: the emitter has no event for atom yet; the caller's
+    //             reference to atom passes to the event
+    //  effects: adds an event with no listeners, returns NULL if out of
+    //             memory or the emitter has MAX_EVENTS events
+    if (handle->count == handle->size) {
+        u32_t size = handle->size ? handle->size * 2 : 4;
+        if (size > MAX_EVENTS) {
+            return NULL;
+        }
+        event_t *events = zjs_malloc(size * sizeof(event_t) +
+                                     size * 2 * sizeof(u16_t));
+        if (!events) {
+            return NULL;
+        }
+        memcpy(events, handle->events, handle->count * sizeof(event_t));
+        zjs_free(handle->events);
+        handle->events = events;
+        handle->size = size;
+        index_events(handle);
+    }
+
+    event_t *event = &handle->events[handle->count++];
+    event->atom = atom;
+    event->list = NULL;
+    u16_t *index = EVENT_INDEX(handle);
+    u32_t mask = handle->size * 2 - 1;
+    u32_t slot = atom;
+    while (index[slot & mask]) {
+        slot++;
+    }
+    index[slot & mask] = handle->count;
+    return event;
+}
+
+static event_t *find_event_by_name(emitter_t *handle, jerry_value_t name)
+{
+    // effects: returns the emitter's event for the JS string name, or NULL
+    jerry_size_t size = ZJS_MAX_EVENT_NAME_SIZE;
+    char event[size];
+    zjs_copy_jstring(name, event, &size);
+    if (!size) {
+        // too long to be one of ours, or empty
+        char *str = zjs_alloc_from_jstring(name, NULL);
+        event_t *found = str ? find_event(handle, find_atom(str)) : NULL;
+        zjs_free(str);
+        return found;
+    }
+    return find_event(handle, find_atom(event));
+}
+
+static void release_list(listener_list_t *list)
+{
+    // effects: drops a reference to list, freeing it and releasing its
+    //            listeners after the last one
+    if (list && --list->refs == 0) {
+        for (u16_t i = 0; i < list->count; i++) {
+            jerry_release_value(list->items[i].func);
+        }
+        zjs_free(list);
+    }
+}
+
+static listener_list_t *writable_list(event_t *event, u16_t room)
+{
+    // effects: returns the event's list, ready to change and with room for
+    //            room more listeners; copies it if an emit is walking it, or
+    //            returns NULL if out of memory
+    listener_list_t *list = event->list;
+    u32_t count = list ? list->count : 0;
+    if (list && list->refs == 1 && list->size >= count + room) {
+        return list;
+    }
+
+    u32_t size = count + room;
+    if (list && list->size >= size) {
+        size = list->size;
+    } else {
+        size = size < 2 ? 2 : size * 2;
+        if (size > 0xffff) {
+            size = 0xffff;
+        }
+        if (count + room > size) {
+            return NULL;
+        }
+    }
+    listener_list_t *copy =
+        zjs_malloc(sizeof(listener_list_t) + size * sizeof(listener_t));
+    if (!copy) {
+        return NULL;
+    }
+    copy->refs = 1;
+    copy->count = count;
+    copy->size = size;
+    copy->once = list ? list->once : 0;
+    if (list) {
+        memcpy(copy->items, list->items, count * sizeof(listener_t));
+        if (list->refs == 1) {
+            // nothing else uses the old array, so its references move over
+            zjs_free(list);
+        } else {
+            for (u16_t i = 0; i < count; i++) {
+                jerry_acquire_value(copy->items[i].func);
+            }
+            list->refs--;
+        }
+    }
+    event->list = copy;
+    return copy;
+}
+
+static void remove_listener_at(listener_list_t *list, u16_t i)
+{
+    // requires: list came from writable_list
+    if (list->items[i].once) {
+        list->once--;
+    }
+    jerry_release_value(list->items[i].func);
+    list->count--;
+    memmove(&list->items[i], &list->items[i + 1],
+            (list->count - i) * sizeof(listener_t));
+}
+
+static void remove_all(event_t *event)
+{
+    release_list(event->list);
+    event->list = NULL;
+}
+
+static void remove_event(emitter_t *handle, event_t *event)
+{
+    // effects: removes event and its listeners from the emitter, releasing
+    //            its atom, so event names that come and go don't pile up
+    remove_all(event);
+    release_atom(event->atom);
+    u16_t i = event - handle->events;
+    handle->count--;
+    memmove(event, event + 1, (handle->count - i) * sizeof(event_t));
+    index_events(handle);
+}
+
+static void remove_all_events(emitter_t *handle)
+{
+    for (u16_t i = 0; i < handle->count; i++) {
+        remove_all(&handle->events[i]);
+        release_atom(handle->events[i].atom);
+    }
+    handle->count = 0;
+    if (handle->size) {
+        index_events(handle);
+    }
 }
 
 static void zjs_event_proto_free_cb(void *native)
@@ -46,6 +491,7 @@ static void zjs_event_proto_free_cb(void *native)
     zjs_event_emitter_prototype = 0;
     zjs_remove_callback(emit_id);
     emit_id = -1;
+    free_dynamic_atoms();
 }
 
 static const jerry_object_native_info_t event_proto_type_info = {
@@ -55,12 +501,8 @@ static const jerry_object_native_info_t event_proto_type_info = {
 static void zjs_emitter_free_cb(void *native)
 {
     emitter_t *handle = (emitter_t *)native;
-    event_t *event = handle->events;
-    while (event) {
-        ZJS_LIST_FREE(listener_t, event->listeners, free_listener);
-        event = event->next;
-    }
-    ZJS_LIST_FREE(event_t, handle->events, zjs_free);
+    remove_all_events(handle);
+    zjs_free(handle->events);
     if (handle->user_free) {
         handle->user_free(handle->user_handle);
     }
@@ -71,45 +513,50 @@ static const jerry_object_native_info_t emitter_type_info = {
     .free_cb = zjs_emitter_free_cb
 };
 
-static int compare_name(event_t *event, const char *name)
-{
-    return strncmp(event->name, name, event->namelen + 1);
-}
-
-jerry_value_t zjs_add_event_listener(jerry_value_t obj, const char *event_name,
-                                     jerry_value_t func)
+static jerry_value_t add_listener_flags(jerry_value_t obj,
+                                        const char *event_name,
+                                        jerry_value_t func, int flags)
 {
-    // requires: event is an event name; func is a valid JS function
+    // requires: event is an event name; func is a valid JS function; flags
+    //             are LISTENER_* flags
     //  returns: an error, or 0 value on success
     ZJS_GET_HANDLE_ALT(obj, emitter_t, handle, emitter_type_info);
 
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       event_name);
-    if (!event) {
-        int len = strlen(event_name);
-        event = (event_t *)zjs_malloc(sizeof(event_t) + len);
+    atom_t atom = intern_atom(event_name);
+    if (atom == ATOM_NONE) {
+        return zjs_error_context("out of memory", 0, 0);
+    }
+    event_t *event = find_event(handle, atom);
+    if (event) {
+        // the event already holds a reference
+        release_atom(atom);
+    } else {
+        event = add_event(handle, atom);
         if (!event) {
+            release_atom(atom);
             return zjs_error_context("out of memory", 0, 0);
         }
-        event->next = NULL;
-        event->listeners = NULL;
-        event->namelen = len;
-        strcpy(event->name, event_name);
-        ZJS_LIST_APPEND(event_t, handle->events, event);
     }
 
-    listener_t *listener = zjs_malloc(sizeof(listener_t));
-    if (!listener) {
-        zjs_free(event);
+    listener_list_t *list = writable_list(event, 1);
+    if (!list) {
         return zjs_error_context("out of memory", 0, 0);
     }
 
+    listener_t *listener = &list->items[list->count];
+    if (flags & LISTENER_PREPEND) {
+        memmove(&list->items[1], &list->items[0],
+                list->count * sizeof(listener_t));
+        listener = &list->items[0];
+    }
     listener->func = jerry_acquire_value(func);
-    listener->next = NULL;
-
-    ZJS_LIST_APPEND(listener_t, event->listeners, listener);
+    listener->once = flags & LISTENER_ONCE ? true : false;
+    list->count++;
+    if (listener->once) {
+        list->once++;
+    }
 
-    if (ZJS_LIST_LENGTH(listener_t, event->listeners) > handle->max_listeners) {
+    if (list->count > handle->max_listeners) {
         // warn of possible leak as per Node docs
         ZJS_PRINT("possible memory leak on event %s\n", event_name);
     }
@@ -123,7 +570,13 @@ jerry_value_t zjs_add_event_listener(jerry_value_t obj, const char *event_name,
     return 0;
 }
 
-static ZJS_DECL_FUNC(add_listener)
+jerry_value_t zjs_add_event_listener(jerry_value_t obj, const char *event_name,
+                                     jerry_value_t func)
+{
+    return add_listener_flags(obj, event_name, func, 0);
+}
+
+static ZJS_DECL_FUNC_ARGS(add_listener_common, int flags)
 {
     // args: event name, callback
     ZJS_VALIDATE_ARGS(Z_STRING, Z_FUNCTION);
@@ -133,7 +586,7 @@ static ZJS_DECL_FUNC(add_listener)
         return zjs_error("out of memory");
     }
 
-    jerry_value_t rval = zjs_add_event_listener(this, name, argv[1]);
+    jerry_value_t rval = add_listener_flags(this, name, argv[1], flags);
     zjs_free(name);
 
     if (jerry_value_is_error(rval)) {
@@ -144,6 +597,80 @@ static ZJS_DECL_FUNC(add_listener)
     return jerry_acquire_value(this);
 }
 
+static ZJS_DECL_FUNC(add_listener)
+{
+    return ZJS_CHAIN_FUNC_ARGS(add_listener_common, 0);
+}
+
+static ZJS_DECL_FUNC(add_once_listener)
+{
+    return ZJS_CHAIN_FUNC_ARGS(add_listener_common, LISTENER_ONCE);
+}
+
+static ZJS_DECL_FUNC(prepend_listener)
+{
+    return ZJS_CHAIN_FUNC_ARGS(add_listener_common, LISTENER_PREPEND);
+}
+
+static ZJS_DECL_FUNC(prepend_once_listener)
+{
+    return ZJS_CHAIN_FUNC_ARGS(add_listener_common,
+                               LISTENER_ONCE | LISTENER_PREPEND);
+}
+
+static bool emit_atom(jerry_value_t obj, atom_t atom,
+                      const jerry_value_t argv[], u32_t argc)
+{
+    // requires: called from the main thread
+    //  effects: calls obj's listeners for atom in order; returns true if
+    //             there were any
+    ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
+    if (!handle) {
+        ERR_PRINT("no handle found\n");
+        return false;
+    }
+
+    event_t *event = find_event(handle, atom);
+    if (!event || !event->list || !event->list->count) {
+        DBG_PRINT("Event '%s' not found or no listeners\n", atom_name(atom));
+        return false;
+    }
+
+    // hold on to the current listeners, so changes made by them don't affect
+    //   this emit
+    listener_list_t *list = event->list;
+    list->refs++;
+
+    // one-shot listeners come off before any listener runs, so they aren't
+    //   called again by a nested emit
+    if (list->once) {
+        listener_list_t *live = writable_list(event, 0);
+        if (live) {
+            for (int i = live->count - 1; i >= 0; i--) {
+                if (live->items[i].once) {
+                    remove_listener_at(live, i);
+                }
+            }
+            if (!live->count) {
+                remove_event(handle, event);
+            }
+        } else {
+            ERR_PRINT("out of memory removing one-shot listeners\n");
+        }
+    }
+
+    // call the listeners in order
+    for (u16_t i = 0; i < list->count; i++) {
+        ZVAL rval = jerry_call_function(list->items[i].func, obj, argv, argc);
+        if (jerry_value_is_error(rval)) {
+            ERR_PRINT("error calling listener\n");
+        }
+    }
+
+    release_list(list);
+    return true;
+}
+
 static ZJS_DECL_FUNC(emit_event)
 {
     // args: event name[, additional pass-through args]
@@ -156,7 +683,9 @@ static ZJS_DECL_FUNC(emit_event)
         return zjs_error("event name is too long");
     }
 
-    bool rval = zjs_emit_event(this, event, argv + 1, argc - 1);
+    // a name that was never interned has no listeners anywhere
+    atom_t atom = find_atom(event);
+    bool rval = atom != ATOM_NONE && emit_atom(this, atom, argv + 1, argc - 1);
 
     // return true if there were listeners called
     return jerry_create_boolean(rval);
@@ -169,26 +698,25 @@ static ZJS_DECL_FUNC(remove_listener)
 
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
-    char *name = zjs_alloc_from_jstring(argv[0], NULL);
-    if (!name) {
-        return zjs_error("out of memory");
-    }
-
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
-    listener_t *listener = NULL;
-    zjs_free(name);
-
-    if (event) {
-        listener = ZJS_LIST_FIND(listener_t, event->listeners, func, argv[1]);
+    // as in Node, remove the most recently added instance of the listener
+    event_t *event = find_event_by_name(handle, argv[0]);
+    int i = event && event->list ? event->list->count - 1 : -1;
+    while (i >= 0 && event->list->items[i].func != argv[1]) {
+        i--;
     }
 
-    if (!listener) {
+    if (i < 0) {
         return zjs_error("no such event listener found");
     }
 
-    ZJS_LIST_REMOVE(listener_t, event->listeners, listener);
-    free_listener(listener);
+    listener_list_t *list = writable_list(event, 0);
+    if (!list) {
+        return zjs_error("out of memory");
+    }
+    remove_listener_at(list, i);
+    if (!list->count) {
+        remove_event(handle, event);
+    }
 
     return jerry_acquire_value(this);
 }
@@ -200,19 +728,12 @@ static ZJS_DECL_FUNC(remove_all_listeners)
 
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
-    char *name = zjs_alloc_from_jstring(argv[0], NULL);
-    if (!name) {
-        return zjs_error("out of memory");
-    }
-
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
-    zjs_free(name);
+    event_t *event = find_event_by_name(handle, argv[0]);
     if (!event) {
         return zjs_error("no event listeners found");
     }
 
-    ZJS_LIST_FREE(listener_t, event->listeners, free_listener);
+    remove_event(handle, event);
 
     return jerry_acquire_value(this);
 }
@@ -222,15 +743,11 @@ static ZJS_DECL_FUNC(get_event_names)
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
     // FIXME: pre-register events
-    int len = ZJS_LIST_LENGTH(event_t, handle->events);
-    jerry_value_t rval = jerry_create_array(len);
-
-    event_t *event = handle->events;
-    int i = 0;
-    while (event) {
-        jerry_set_property_by_index(rval, i++,
-            jerry_create_string((jerry_char_t *)event->name));
-        event = event->next;
+    jerry_value_t rval = jerry_create_array(handle->count);
+    for (u16_t i = 0; i < handle->count; i++) {
+        ZVAL name = jerry_create_string(
+            (jerry_char_t *)atom_name(handle->events[i].atom));
+        ZVAL result = jerry_set_property_by_index(rval, i, name);
     }
 
     return rval;
@@ -263,20 +780,12 @@ static ZJS_DECL_FUNC(get_listener_count)
 
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
-    char *name = zjs_alloc_from_jstring(argv[0], NULL);
-    if (!name) {
-        return zjs_error("out of memory");
-    }
-
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
-    zjs_free(name);
+    event_t *event = find_event_by_name(handle, argv[0]);
     if (!event) {
         return jerry_create_number(0);
     }
 
-    int len = ZJS_LIST_LENGTH(listener_t, event->listeners);
-    return jerry_create_number(len);
+    return jerry_create_number(event->list ? event->list->count : 0);
 }
 
 static ZJS_DECL_FUNC(get_listeners)
@@ -286,26 +795,16 @@ static ZJS_DECL_FUNC(get_listeners)
 
     ZJS_GET_HANDLE(this, emitter_t, handle, emitter_type_info);
 
-    char *name = zjs_alloc_from_jstring(argv[0], NULL);
-    if (!name) {
-        return zjs_error("out of memory");
-    }
-
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       name);
-    zjs_free(name);
+    event_t *event = find_event_by_name(handle, argv[0]);
     if (!event) {
         return jerry_create_array(0);
     }
 
-    int len = ZJS_LIST_LENGTH(event_t, handle->events);
+    listener_list_t *list = event->list;
+    u16_t len = list ? list->count : 0;
     jerry_value_t rval = jerry_create_array(len);
-
-    listener_t *listener = event->listeners;
-    int i = 0;
-    while (listener) {
-        jerry_set_property_by_index(rval, i++, listener->func);
-        listener = listener->next;
+    for (u16_t i = 0; i < len; i++) {
+        ZVAL result = jerry_set_property_by_index(rval, i, list->items[i].func);
     }
 
     return rval;
@@ -315,22 +814,26 @@ typedef struct emit_event {
     jerry_value_t obj;
     zjs_pre_emit pre;
     zjs_post_emit post;
+    atom_t atom;   // event, or ATOM_NONE if the name follows the user data
     u32_t length;  // length of user data
-    char data[0];  // data is user data followed by null-terminated event name
+    char data[0];  // user data, then the null-terminated name if no atom
 } emit_event_t;
 
-static void emit_event_callback(void *handle, const void *args)
+static void emit_with_hooks(jerry_value_t obj, atom_t atom, zjs_pre_emit pre,
+                            zjs_post_emit post, const char *data,
+                            u32_t length)
 {
-    const emit_event_t *emit = (const emit_event_t *)args;
-
-    void *user_handle = zjs_event_get_user_handle(emit->obj);
+    // requires: called from the main thread
+    //  effects: builds the arguments with pre, emits the event if it has an
+    //             atom, and lets post clean up
+    void *user_handle = zjs_event_get_user_handle(obj);
 
     // prepare arguments for the event
     jerry_value_t argv[MAX_EVENT_ARGS];
     jerry_value_t *argp = argv;
     u32_t argc = 0;
-    if (emit->pre) {
-        if (!emit->pre(user_handle, argv, &argc, emit->data, emit->length)) {
+    if (pre) {
+        if (!pre(user_handle, argv, &argc, data, length)) {
             // event cancelled
             DBG_PRINT("event cancelled\n");
             return;
@@ -344,16 +847,34 @@ static void emit_event_callback(void *handle, const void *args)
     }
 
     // emit the event
-    zjs_emit_event(emit->obj, emit->data + emit->length, argp, argc);
+    if (atom != ATOM_NONE) {
+        emit_atom(obj, atom, argp, argc);
+    }
     // TODO: possibly do something different depending on success/failure?
 
     // free args
-    if (emit->post) {
+    if (post) {
         // TODO: figure out what is needed for args here
-        emit->post(user_handle, argv, argc);
+        post(user_handle, argv, argc);
     }
 }
 
+static void emit_event_callback(void *handle, const void *args)
+{
+    const emit_event_t *emit = (const emit_event_t *)args;
+
+    // names outside the static table were looked up here, on the main thread
+    atom_t atom = emit->atom;
+    if (atom == ATOM_NONE) {
+        atom = find_atom(emit->data + emit->length);
+        if (atom == ATOM_NONE) {
+            DBG_PRINT("no listeners for '%s'\n", emit->data + emit->length);
+        }
+    }
+    emit_with_hooks(emit->obj, atom, emit->pre, emit->post, emit->data,
+                    emit->length);
+}
+
 // a zjs_pre_emit callback
 bool zjs_copy_arg(void *unused, jerry_value_t argv[], u32_t *argc,
                   const char *buffer, u32_t bytes)
@@ -383,52 +904,57 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *event,
     //             main thread in the next event loop pass
     DBG_PRINT("queuing event '%s'\n", event);
 
-    int namelen = strlen(event);
-    int len = sizeof(emit_event_t) + namelen + 1 + bytes;
+    // only the static table is safe to read from other threads; any other
+    //   name travels with the event
+    atom_t atom = find_static_atom(event, hash_name(event));
+    int namelen = atom == ATOM_NONE ? strlen(event) + 1 : 0;
+    int len = sizeof(emit_event_t) + bytes + namelen;
     char buf[len];
     emit_event_t *emit = (emit_event_t *)buf;
     emit->obj = obj;
     emit->pre = pre;
     emit->post = post;
+    emit->atom = atom;
     emit->length = bytes;
     if (buffer && bytes) {
         memcpy(emit->data, buffer, bytes);
     }
     // assert: if buffer is null, bytes should be 0, and vice versa
-    strcpy(emit->data + bytes, event);
+    if (namelen) {
+        strcpy(emit->data + bytes, event);
+    }
     zjs_signal_callback(emit_id, buf, len);
 }
 
+void zjs_direct_emit_event_priv(jerry_value_t obj, const char *event,
+                                const void *buffer, int bytes,
+                                zjs_pre_emit pre, zjs_post_emit post)
+{
+    // requires: on the main thread, only called where listeners may run
+    //             before the caller returns
+    //  effects: emits the event now on the main thread, or defers it
+    //             otherwise
+    if (!zjs_on_main_thread()) {
+        zjs_defer_emit_event_priv(obj, event, buffer, bytes, pre, post);
+        return;
+    }
+    DBG_PRINT("emitting event '%s' directly\n", event);
+    emit_with_hooks(obj, find_atom(event), pre, post, (const char *)buffer,
+                    bytes);
+}
+
 bool zjs_emit_event_priv(jerry_value_t obj, const char *event_name,
                          const jerry_value_t argv[], u32_t argc)
 {
     // effects: emits event now, should only be called from main thread
     DBG_PRINT("emitting event '%s'\n", event_name);
 
-    ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
-    if (!handle) {
-        ERR_PRINT("no handle found\n");
-        return false;
-    }
-
-    event_t *event = ZJS_LIST_FIND_CMP(event_t, handle->events, compare_name,
-                                       event_name);
-    if (!event || !event->listeners) {
+    atom_t atom = find_atom(event_name);
+    if (atom == ATOM_NONE) {
         DBG_PRINT("Event '%s' not found or no listeners\n", event_name);
         return false;
     }
-
-    // call the listeners in order
-    listener_t *listener = event->listeners;
-    while (listener) {
-        ZVAL rval = jerry_call_function(listener->func, obj, argv, argc);
-        if (jerry_value_is_error(rval)) {
-            ERR_PRINT("error calling listener\n");
-        }
-        listener = listener->next;
-    }
-
-    return true;
+    return emit_atom(obj, atom, argv, argc);
 }
 
 void zjs_destroy_emitter(jerry_value_t obj)
@@ -436,11 +962,7 @@ void zjs_destroy_emitter(jerry_value_t obj)
     // FIXME: probably better to more fully free in case JS keeps obj around
     ZJS_GET_HANDLE_OR_NULL(obj, emitter_t, handle, emitter_type_info);
     if (handle) {
-        event_t *event = handle->events;
-        while (event) {
-            ZJS_LIST_FREE(listener_t, event->listeners, free_listener);
-            event = event->next;
-        }
+        remove_all_events(handle);
     }
 }
 
@@ -459,6 +981,9 @@ static void zjs_event_init_prototype()
         zjs_native_func_t array[] = {
             { add_listener, "on" },
             { add_listener, "addListener" },
+            { add_once_listener, "once" },
+            { prepend_listener, "prependListener" },
+            { prepend_once_listener, "prependOnceListener" },
             { emit_event, "emit" },
             { remove_listener, "removeListener" },
             { remove_all_listeners, "removeAllListeners" },
@@ -469,12 +994,15 @@ static void zjs_event_init_prototype()
             { set_max_listeners, "setMaxListeners" },
             { NULL, NULL }
         };
+        init_static_atoms();
         zjs_event_emitter_prototype = zjs_create_object();
         zjs_obj_add_functions(zjs_event_emitter_prototype, array);
         jerry_set_object_native_pointer(zjs_event_emitter_prototype, NULL,
                                         &event_proto_type_info);
         jerry_release_value(zjs_event_emitter_prototype);
         emit_id = zjs_add_c_callback(NULL, emit_event_callback);
+        // one callback carries every deferred event, so never coalesce it
+        zjs_set_callback_shared(emit_id);
     }
 }
 
@@ -492,6 +1020,8 @@ void zjs_make_emitter(jerry_value_t obj, jerry_value_t prototype,
     emitter_t *emitter = zjs_malloc(sizeof(emitter_t));
     emitter->max_listeners = DEFAULT_MAX_LISTENERS;
     emitter->events = NULL;
+    emitter->count = 0;
+    emitter->size = 0;
     emitter->user_free = free_cb;
     emitter->user_handle = user_data;
     jerry_set_object_native_pointer(obj, emitter, &emitter_type_info);
@@ -147,6 +147,40 @@ void zjs_defer_emit_event_priv(jerry_value_t obj, const char *name,
                                const void *buffer, int bytes,
                                zjs_pre_emit pre, zjs_post_emit post);
 
+/**
+ * zjs_direct_emit_event: Emit an event right away when on the main thread
+ *
+ * Takes the same arguments as zjs_defer_emit_event(). On the main thread the
+ * 'pre' function, the listeners and the 'post' function are all called before
+ * this returns, skipping the trip through the callback queue; from interrupts
+ * or other threads the event is deferred instead.
+ *
+ * Only use this from code the main loop calls, e.g. deferred work or service
+ * routines. Inside a JS API call, use zjs_defer_emit_event(), since listeners
+ * may not have been added yet and must not run before the call returns.
+ *
+ * @param obj     Object that contains the event to be triggered
+ * @param name    Name of event
+ * @param buffer  Data needed to call event listeners
+ * @param bytes   Size of buffer
+ * @param pre     Arg setup function called before event emitted
+ * @param post    Arg teardown function called after event emitted
+ */
+#if DEBUG_TRACE_EMIT
+#define zjs_direct_emit_event(obj, name, buffer, bytes, pre, post)             \
+    {                                                                          \
+        ZJS_PRINT("[EVENT] %s:%d Emitting '%s'\n", __FILE__, __LINE__, name);  \
+        zjs_direct_emit_event_priv(obj, name, buffer, bytes, pre, post);       \
+    }
+#else
+#define zjs_direct_emit_event zjs_direct_emit_event_priv
+#endif
+
+// NOTE: don't call the priv version directly
+void zjs_direct_emit_event_priv(jerry_value_t obj, const char *name,
+                                const void *buffer, int bytes,
+                                zjs_pre_emit pre, zjs_post_emit post);
+
 /**
  * zjs_emit_event: Call any registered event listeners immediately
  *
@@ -335,6 +335,9 @@ static ZJS_DECL_FUNC(zjs_gpio_open)
 
         // Register a C callback (will be called after the ISR is called)
         handle->callbackId = zjs_add_c_callback(handle, zjs_gpio_c_callback);
+        // a bouncing input fires faster than JS can keep up; only the
+        //   latest value matters, so merge edges into one pending event
+        zjs_set_callback_coalesce(handle->callbackId, sizeof(u32_t) * 2);
         handle->edge_both = (edge == ZJS_EDGE_BOTH) ? 1 : 0;
     }
 
@@ -0,0 +1,67 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// C includes
+#ifdef ZJS_LINUX_BUILD
+#include <time.h>
+#else
+#include <zephyr.h>
+#endif
+
+// ZJS includes
+#include "zjs_hrtime.h"
+
+static u64_t start_ns = 0;
+static double origin_ms = 0;
+
+#ifdef ZJS_LINUX_BUILD
+u64_t zjs_hrtime_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (u64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+#else
+static u32_t base_cycles;
+static s64_t base_uptime;
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+u64_t zjs_hrtime_ns(void)
+{
+    // the cycle counter wraps every few seconds on fast boards; the uptime
+    //   is only good to a tick, but that's plenty to count the wraps
+    u32_t hz = sys_clock_hw_cycles_per_sec;
+    u32_t cycles = k_cycle_get_32() - base_cycles;
+    u64_t estimate = (u64_t)(k_uptime_get() - base_uptime) * hz / 1000;
+    u64_t wraps = 0;
+    if (estimate > cycles) {
+        // round to the nearest wrap
+        wraps = (estimate - cycles + 0x80000000) >> 32;
+    }
+    u64_t total = (wraps << 32) + cycles;
+    // split to keep the multiply from overflowing
+    return total / hz * 1000000000 + total % hz * 1000000000 / hz;
+}
+#endif
+
+void zjs_hrtime_init(void)
+{
+#ifdef ZJS_LINUX_BUILD
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    origin_ms = (double)wall.tv_sec * 1000 + (double)wall.tv_nsec / 1000000;
+#else
+    base_cycles = k_cycle_get_32();
+    base_uptime = k_uptime_get();
+#endif
+    start_ns = zjs_hrtime_ns();
+}
+
+double zjs_hrtime_elapsed_ms(void)
+{
+    return (double)(zjs_hrtime_ns() - start_ns) / 1000000;
+}
+
+double zjs_hrtime_origin(void)
+{
+    return origin_ms;
+}
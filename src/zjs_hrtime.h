@@ -0,0 +1,46 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_hrtime_h__
+#define __zjs_hrtime_h__
+
+// ZJS includes
+#include "zjs_common.h"
+
+/*
+ * Monotonic high resolution clock
+ *
+ * On Linux this reads CLOCK_MONOTONIC_RAW, which NTP never adjusts. On Zephyr
+ * it reads the hardware cycle counter, extended to 64 bits using the system
+ * uptime, so wraps are never missed however rarely it is read.
+ */
+
+/**
+ * Record the time origin; called from zjs_modules_init()
+ */
+void zjs_hrtime_init(void);
+
+/**
+ * Get the time since an arbitrary point in the past
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @return        Time in nanoseconds
+ */
+u64_t zjs_hrtime_ns(void);
+
+/**
+ * Get the time since zjs_hrtime_init()
+ *
+ * @return        Time in milliseconds, with sub-millisecond fractions
+ */
+double zjs_hrtime_elapsed_ms(void);
+
+/**
+ * Get the wall clock time when zjs_hrtime_init() was called
+ *
+ * @return        Milliseconds since the Unix epoch, or 0 on boards with no
+ *                  wall clock
+ */
+double zjs_hrtime_origin(void);
+
+#endif  // __zjs_hrtime_h__
@@ -0,0 +1,237 @@
+// Copyright (c) 2018, Intel Corporation.
+
+/*
+ * Blocking main loop backend for jslinux
+ *
+ * The main loop sleeps in zjs_loop_block() until one of three things happens:
+ * the deadline it was given passes (the next timer or service routine wakeup),
+ * another thread or signal handler calls zjs_loop_unblock() (e.g. a callback
+ * was signaled), or it is woken for any other registered reason. On Linux this
+ * is built on epoll with a timerfd for the deadline and an eventfd for the
+ * wakeups; elsewhere (e.g. MacOS) it falls back to poll() on a self-pipe.
+ */
+
+// C includes
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#else
+#include <poll.h>
+#endif
+
+// ZJS includes
+#include "zjs_linux_port.h"
+#include "zjs_util.h"
+
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_SEC  1000000000ULL
+
+// set when a wakeup has been posted but not yet consumed by the main loop, so
+//   that repeated signals only cost one write() between loop passes
+static u8_t wake_pending = 0;
+static bool loop_initialized = false;
+
+#ifdef __linux__
+static int epoll_fd = -1;
+static int event_fd = -1;
+static int timer_fd = -1;
+#else
+static int pipe_fds[2] = { -1, -1 };
+#endif
+
+typedef struct loop_stats {
+    u64_t blocks;          // calls that actually slept
+    u64_t timer_wakeups;   // woken by the deadline expiring
+    u64_t event_wakeups;   // woken by zjs_loop_unblock()
+    u64_t idle_ns;         // total time spent asleep
+    u64_t latency_ns;      // sum of deadline overshoot on timer wakeups
+    u64_t latency_max_ns;  // worst deadline overshoot
+} loop_stats_t;
+
+static loop_stats_t stats;
+
+static u64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+void zjs_loop_init(void)
+{
+    if (loop_initialized) {
+        return;
+    }
+    memset(&stats, 0, sizeof(stats));
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll_fd < 0 || event_fd < 0 || timer_fd < 0) {
+        ERR_PRINT("failed to create loop descriptors (errno=%d)\n", errno);
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = event_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev)) {
+        ERR_PRINT("failed to watch eventfd (errno=%d)\n", errno);
+        return;
+    }
+    ev.data.fd = timer_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev)) {
+        ERR_PRINT("failed to watch timerfd (errno=%d)\n", errno);
+        return;
+    }
+#else
+    if (pipe(pipe_fds)) {
+        ERR_PRINT("failed to create loop pipe (errno=%d)\n", errno);
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(pipe_fds[i], F_SETFL, fcntl(pipe_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(pipe_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    loop_initialized = true;
+}
+
+// INTERRUPT SAFE FUNCTION: may be called from other threads or signal handlers
+void zjs_loop_unblock(void)
+{
+    if (!loop_initialized) {
+        return;
+    }
+    if (__atomic_exchange_n(&wake_pending, 1, __ATOMIC_ACQ_REL)) {
+        // main loop already has a wakeup coming
+        return;
+    }
+#ifdef __linux__
+    u64_t one = 1;
+    ssize_t rval = write(event_fd, &one, sizeof(one));
+#else
+    u8_t one = 1;
+    ssize_t rval = write(pipe_fds[1], &one, sizeof(one));
+#endif
+    (void)rval;
+}
+
+static void drain_wakeups(void)
+{
+#ifdef __linux__
+    u64_t count;
+    ssize_t rval = read(event_fd, &count, sizeof(count));
+#else
+    u8_t junk[32];
+    ssize_t rval;
+    while ((rval = read(pipe_fds[0], junk, sizeof(junk))) > 0) {}
+#endif
+    (void)rval;
+    // anything signaled before this point will be seen by the next loop pass;
+    //   anything after will post a new wakeup
+    __atomic_store_n(&wake_pending, 0, __ATOMIC_RELEASE);
+}
+
+void zjs_loop_block(int time)
+{
+    // requires: time is in milliseconds, or ZJS_TICKS_FOREVER to wait until
+    //             unblocked
+    //  effects: sleeps until time expires or zjs_loop_unblock() is called
+    if (!loop_initialized || time == ZJS_TICKS_NONE) {
+        return;
+    }
+    if (__atomic_load_n(&wake_pending, __ATOMIC_ACQUIRE)) {
+        // don't bother sleeping, there's already work waiting
+        drain_wakeups();
+        return;
+    }
+
+    u64_t start = now_ns();
+    u64_t deadline = 0;
+    if (time != ZJS_TICKS_FOREVER) {
+        deadline = start + (u64_t)time * NSEC_PER_MSEC;
+    }
+
+    bool woke_timer = false;
+    bool woke_event = false;
+#ifdef __linux__
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (deadline) {
+        // arm for the absolute deadline; an all-zero spec disarms the timer
+        spec.it_value.tv_sec = deadline / NSEC_PER_SEC;
+        spec.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+
+    struct epoll_event events[2];
+    int count;
+    do {
+        count = epoll_wait(epoll_fd, events, 2, -1);
+    } while (count < 0 && errno == EINTR && !wake_pending);
+
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.fd == timer_fd) {
+            u64_t expirations;
+            ssize_t rval = read(timer_fd, &expirations, sizeof(expirations));
+            (void)rval;
+            woke_timer = true;
+        } else if (events[i].data.fd == event_fd) {
+            woke_event = true;
+        }
+    }
+#else
+    struct pollfd pfd = { .fd = pipe_fds[0], .events = POLLIN };
+    int count = poll(&pfd, 1, time);
+    if (count > 0) {
+        woke_event = true;
+    } else if (count == 0) {
+        woke_timer = true;
+    }
+#endif
+    if (woke_event || wake_pending) {
+        drain_wakeups();
+    }
+
+    u64_t end = now_ns();
+    stats.blocks++;
+    stats.idle_ns += end - start;
+    if (woke_event) {
+        stats.event_wakeups++;
+    }
+    if (woke_timer && deadline) {
+        u64_t late = end > deadline ? end - deadline : 0;
+        stats.timer_wakeups++;
+        stats.latency_ns += late;
+        if (late > stats.latency_max_ns) {
+            stats.latency_max_ns = late;
+        }
+    }
+}
+
+void zjs_loop_print_stats(void)
+{
+    u64_t avg = 0;
+    if (stats.timer_wakeups) {
+        avg = stats.latency_ns / stats.timer_wakeups;
+    }
+    ZJS_PRINT("\n--------- Main Loop Stats ------------\n");
+    ZJS_PRINT("[loop stats] blocks: %llu (timer wakeups: %llu, "
+              "event wakeups: %llu)\n",
+              (unsigned long long)stats.blocks,
+              (unsigned long long)stats.timer_wakeups,
+              (unsigned long long)stats.event_wakeups);
+    ZJS_PRINT("[loop stats] idle time: %llu ms\n",
+              (unsigned long long)(stats.idle_ns / NSEC_PER_MSEC));
+    ZJS_PRINT("[loop stats] timer wakeup latency: avg %llu us, max %llu us\n",
+              (unsigned long long)(avg / 1000),
+              (unsigned long long)(stats.latency_max_ns / 1000));
+    ZJS_PRINT("------------- End ----------------\n");
+}
@@ -4,6 +4,7 @@
 #define ZJS_LINUX_PORT_H_
 
 // C includes
+#include <errno.h>
 #include <stdint.h>
 #include <time.h>
 #include <unistd.h>
@@ -32,20 +33,17 @@ void zjs_port_timer_start(zjs_port_timer_t *timer, u32_t interval, u32_t repeat)
 
 void zjs_port_timer_stop(zjs_port_timer_t *timer);
 
-u8_t zjs_port_timer_test(zjs_port_timer_t *timer);
+u32_t zjs_port_timer_test(zjs_port_timer_t *timer);
 
 u32_t zjs_port_timer_get_uptime(void);
 
 #define ZJS_TICKS_NONE                 0
-#define ZJS_TICKS_FOREVER              0
+#define ZJS_TICKS_FOREVER              -1
 #define CONFIG_SYS_CLOCK_TICKS_PER_SEC 100
 #define zjs_sleep usleep
 
 #define SIZE32_OF(x) (sizeof((x)) / sizeof(u32_t))
 
-#define EAGAIN      11
-#define EMSGSIZE    12
-#define ENOSPC      28
 
 struct zjs_port_ring_buf {
     u32_t head; /**< Index in buf for the head element */
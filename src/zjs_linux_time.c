@@ -22,7 +22,7 @@ void zjs_port_timer_stop(zjs_port_timer_t *timer)
     timer->interval = 0;
 }
 
-u8_t zjs_port_timer_test(zjs_port_timer_t *timer)
+u32_t zjs_port_timer_test(zjs_port_timer_t *timer)
 {
     u32_t elapsed;
     struct timespec now;
@@ -33,7 +33,8 @@ u8_t zjs_port_timer_test(zjs_port_timer_t *timer)
               ((now.tv_nsec / 1000000) - timer->milli);
 
     if (elapsed >= timer->interval) {
-        return elapsed;
+        // a zero-length timer expires immediately, so never report 0
+        return elapsed ? elapsed : 1;
     }
     return 0;
 }
@@ -0,0 +1,137 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifdef ZJS_LOOP_STATS
+
+// C includes
+#include <string.h>
+
+// ZJS includes
+#include "zjs_hrtime.h"
+#include "zjs_loop_stats.h"
+#include "zjs_util.h"
+
+static const char *phase_names[ZJS_PHASE_COUNT] = {
+    "callbacks", "timers", "routines", "immediates", "jobs", "idle"
+};
+
+static zjs_loop_phase_stats_t phase_stats[ZJS_PHASE_COUNT];
+static u32_t iterations = 0;
+
+static u64_t last_mark;
+
+// returns ns since the last call
+static inline u32_t elapsed_ns()
+{
+    u64_t now = zjs_hrtime_ns();
+    u64_t delta = now - last_mark;
+    last_mark = now;
+    return delta > 0xffffffff ? 0xffffffff : (u32_t)delta;
+}
+
+static inline int bucket_index(u32_t us)
+{
+    if (us < 4) {
+        return us;
+    }
+    // four linear sub-buckets per power of two
+    int exp = 31 - __builtin_clz(us);
+    int sub = (us >> (exp - 2)) & 3;
+    return 4 + (exp - 2) * 4 + sub;
+}
+
+static inline u32_t bucket_high(int index)
+{
+    // highest value that falls in a bucket
+    if (index < 4) {
+        return index;
+    }
+    int exp = (index - 4) / 4 + 2;
+    u32_t sub = (index - 4) % 4;
+    u64_t low = (u64_t)(4 + sub) << (exp - 2);
+    return (u32_t)(low + ((u64_t)1 << (exp - 2)) - 1);
+}
+
+void zjs_loop_stats_init(void)
+{
+    memset(phase_stats, 0, sizeof(phase_stats));
+    for (int i = 0; i < ZJS_PHASE_COUNT; i++) {
+        phase_stats[i].min_us = 0xffffffff;
+    }
+    iterations = 0;
+    elapsed_ns();
+}
+
+void zjs_loop_stats_mark(zjs_loop_phase_t phase)
+{
+    u32_t ns = elapsed_ns();
+    u32_t us = ns / 1000;
+    zjs_loop_phase_stats_t *stats = &phase_stats[phase];
+    stats->total_ns += ns;
+    stats->count++;
+    if (us < stats->min_us) {
+        stats->min_us = us;
+    }
+    if (us > stats->max_us) {
+        stats->max_us = us;
+    }
+    stats->hist[bucket_index(us)]++;
+}
+
+void zjs_loop_stats_iteration(void)
+{
+    iterations++;
+}
+
+const zjs_loop_phase_stats_t *zjs_loop_stats_get(zjs_loop_phase_t phase)
+{
+    return &phase_stats[phase];
+}
+
+const char *zjs_loop_stats_phase_name(zjs_loop_phase_t phase)
+{
+    return phase_names[phase];
+}
+
+u32_t zjs_loop_stats_iterations(void)
+{
+    return iterations;
+}
+
+u32_t zjs_loop_stats_percentile(const zjs_loop_phase_stats_t *stats,
+                                u32_t percentile)
+{
+    if (!stats->count) {
+        return 0;
+    }
+    // rank of the sample we want, rounded up so p100 is the last sample
+    u64_t rank = ((u64_t)stats->count * percentile + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    u64_t seen = 0;
+    for (int i = 0; i < ZJS_HIST_BUCKETS; i++) {
+        seen += stats->hist[i];
+        if (seen >= rank) {
+            u32_t high = bucket_high(i);
+            return high < stats->max_us ? high : stats->max_us;
+        }
+    }
+    return stats->max_us;
+}
+
+void zjs_loop_stats_print(void)
+{
+    ZJS_PRINT("Loop phases (%u iterations):\n", iterations);
+    ZJS_PRINT("  %-10s %10s %12s %8s %8s %8s %8s\n", "phase", "count",
+              "total(us)", "p50", "p90", "p99", "max");
+    for (int i = 0; i < ZJS_PHASE_COUNT; i++) {
+        const zjs_loop_phase_stats_t *stats = &phase_stats[i];
+        ZJS_PRINT("  %-10s %10u %12u %8u %8u %8u %8u\n", phase_names[i],
+                  stats->count, (u32_t)(stats->total_ns / 1000),
+                  zjs_loop_stats_percentile(stats, 50),
+                  zjs_loop_stats_percentile(stats, 90),
+                  zjs_loop_stats_percentile(stats, 99), stats->max_us);
+    }
+}
+
+#endif  // ZJS_LOOP_STATS
@@ -0,0 +1,99 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_loop_stats_h__
+#define __zjs_loop_stats_h__
+
+/*
+ * Main loop phase instrumentation
+ *
+ * Enabled with -DZJS_LOOP_STATS (on by default for jslinux); otherwise the
+ * hooks below compile to nothing. The main loop calls zjs_loop_stats_mark()
+ * as each phase finishes, which charges the time since the previous mark to
+ * that phase and records it in a histogram.
+ */
+
+#ifdef ZJS_LOOP_STATS
+
+// ZJS includes
+#include "zjs_common.h"
+
+typedef enum zjs_loop_phase {
+    ZJS_PHASE_CALLBACKS,   // zjs_service_callbacks()
+    ZJS_PHASE_TIMERS,      // zjs_timers_process_events()
+    ZJS_PHASE_ROUTINES,    // zjs_service_routines()
+    ZJS_PHASE_IMMEDIATES,  // zjs_timers_process_immediates() and _ticks()
+    ZJS_PHASE_JOBS,        // jerry_run_all_enqueued_jobs()
+    ZJS_PHASE_IDLE,        // zjs_loop_block()
+    ZJS_PHASE_COUNT
+} zjs_loop_phase_t;
+
+// log-linear buckets: exact below 4us, then 4 per power of two up to 2^32us
+#define ZJS_HIST_BUCKETS 124
+
+typedef struct zjs_loop_phase_stats {
+    u64_t total_ns;
+    u32_t count;
+    u32_t min_us;
+    u32_t max_us;
+    u32_t hist[ZJS_HIST_BUCKETS];
+} zjs_loop_phase_stats_t;
+
+/**
+ * Start timing; called once before the main loop starts
+ */
+void zjs_loop_stats_init(void);
+
+/**
+ * Charge the time since the last mark to a phase
+ *
+ * @param phase  The phase that just finished
+ */
+void zjs_loop_stats_mark(zjs_loop_phase_t phase);
+
+/**
+ * Count one pass through the main loop
+ */
+void zjs_loop_stats_iteration(void);
+
+/**
+ * Get the stats for a phase
+ *
+ * @param phase  Phase to look up
+ *
+ * @return       Read-only stats, updated as the loop runs
+ */
+const zjs_loop_phase_stats_t *zjs_loop_stats_get(zjs_loop_phase_t phase);
+
+/**
+ * Get a phase name suitable for display or use as a property name
+ */
+const char *zjs_loop_stats_phase_name(zjs_loop_phase_t phase);
+
+/**
+ * Get the number of passes through the main loop
+ */
+u32_t zjs_loop_stats_iterations(void);
+
+/**
+ * Find a percentile in a phase's histogram
+ *
+ * @param stats       Stats returned from zjs_loop_stats_get()
+ * @param percentile  Percentile to find, 0-100
+ *
+ * @return            Approximate duration in microseconds
+ */
+u32_t zjs_loop_stats_percentile(const zjs_loop_phase_stats_t *stats,
+                                u32_t percentile);
+
+/**
+ * Print all phase stats
+ */
+void zjs_loop_stats_print(void);
+
+#else
+#define zjs_loop_stats_init() do {} while (0)
+#define zjs_loop_stats_mark(phase) do {} while (0)
+#define zjs_loop_stats_iteration() do {} while (0)
+#endif  // ZJS_LOOP_STATS
+
+#endif  // __zjs_loop_stats_h__
@@ -18,9 +18,18 @@
 #endif
 
 #include "zjs_callbacks.h"
+#if defined(ZJS_CALLBACK_TUNING) && \
+    (defined(BUILD_MODULE_EVENTS) || defined(BUILD_MODULE_EVENT))
+#define ZJS_PROCESS_EVENTS
+#include "zjs_event.h"
+#endif
+#include "zjs_hrtime.h"
 #include "zjs_modules.h"
 #include "zjs_modules_gen.h"
 #include "zjs_script.h"
+#ifdef ZJS_LINUX_BUILD
+#include "zjs_snapshot_cache.h"
+#endif
 #include "zjs_timers.h"
 #include "zjs_util.h"
 #include "jerryscript-ext/module.h"
@@ -40,6 +49,31 @@ static char *load_file;
 static u8_t num_routines = 0;
 struct routine_map svc_routine_map[NUM_SERVICE_ROUTINES];
 
+// require.cache statistics
+static u32_t cache_hits = 0;
+static u32_t cache_misses = 0;
+static u32_t module_reads = 0;  // JS modules read from the filesystem
+
+static void module_canonical_name(const char *name, char *canonical)
+{
+    // requires: canonical has room for strlen(name) + 1 bytes
+    //  effects: writes the name a module is found and cached under: name
+    //             without a leading "./" or "modules/" and without ".js", so
+    //             'foo', 'foo.js' and './modules/foo.js' all give 'foo'
+    while (!strncmp(name, "./", 2)) {
+        name += 2;
+    }
+    if (!strncmp(name, "modules/", 8)) {
+        name += 8;
+    }
+    size_t len = strlen(name);
+    if (len > 3 && !strcmp(name + len - 3, ".js")) {
+        len -= 3;
+    }
+    memcpy(canonical, name, len);
+    canonical[len] = '\0';
+}
+
 /*****************************************************************
 *   Real board JavaScript module resolver (ASHELL only currently)
 ******************************************************************/
@@ -70,10 +104,14 @@ static bool load_js_module_fs(const jerry_value_t module_name,
     ssize_t file_size = 0;
 
     // Attempt to read the file from the filesystem.
-    char *req_file_buffer = read_file_alloc(module, &file_size);
+    char file[module_size + 3];
+    module_canonical_name(module, file);
+    strcat(file, ".js");
+    char *req_file_buffer = read_file_alloc(file, &file_size);
     if (req_file_buffer == NULL) {
         return false;
     }
+    module_reads++;
 
     // Eval the code from the file.
     bool ret = javascript_eval_code(req_file_buffer, file_size, result);
@@ -101,19 +139,22 @@ static bool load_js_module_fs(const jerry_value_t module_name,
     jerry_size_t module_size = jerry_get_utf8_string_size(module_name) + 1;
     char module[module_size];
     zjs_copy_jstring(module_name, module, &module_size);
-    jerry_size_t size = MAX_MODULE_STR_LEN;
-    char full_path[size + 9];
+    char full_path[module_size + 11];
     char *str = NULL;
     u32_t len;
     bool ret = false;
-    sprintf(full_path, "modules/%s", module);
-    full_path[size + 8] = '\0';
+    module_canonical_name(module, full_path + 8);
+    memcpy(full_path, "modules/", 8);
+    strcat(full_path, ".js");
 
     if (zjs_read_script(full_path, &str, &len)) {
         return false;
     }
+    module_reads++;
 
-    (*result) = jerry_eval((jerry_char_t *)str, len, false);
+    if (!zjs_snapshot_cache_run(full_path, str, len, result)) {
+        (*result) = jerry_eval((jerry_char_t *)str, len, false);
+    }
     if (jerry_value_is_error(*result)) {
         ERR_PRINT("failed to evaluate JS\n");
         ret = false;
@@ -148,13 +189,8 @@ static bool load_js_module_obj(const jerry_value_t module_name,
         return false;
     }
 
-    // TODO: maybe we should just error if no .js extension here
     char mod_trim[module_size];
-    strncpy(mod_trim, module, module_size);
-    if (module_size > 3 && !strncmp(mod_trim + module_size - 3, ".js", 3)) {
-        // strip the ".js"
-        mod_trim[module_size - 3] = '\0';
-    }
+    module_canonical_name(module, mod_trim);
 
     (*result) = zjs_get_property(exports_obj, mod_trim);
     if (!jerry_value_is_object(*result)) {
@@ -200,17 +236,49 @@ static ZJS_DECL_FUNC(native_require_handler)
     char module[module_size];
     zjs_copy_jstring(argv[0], module, &module_size);
 
+    // modules load once and then come from require.cache until the script
+    //   deletes their entry; it's keyed by canonical name, so every spelling
+    //   of a module shares one entry
+    char canonical[module_size];
+    module_canonical_name(module, canonical);
+    ZVAL key = jerry_create_string((const jerry_char_t *)canonical);
+    ZVAL cache = zjs_get_property(function_obj, "cache");
+    bool use_cache = jerry_value_is_object(cache);
+    if (use_cache) {
+        ZVAL cached = jerry_has_own_property(cache, key);
+        if (jerry_get_boolean_value(cached)) {
+            cache_hits++;
+            return jerry_get_property(cache, key);
+        }
+    }
+    cache_misses++;
+
     // Try each of the resolvers to see if we can find the requested module
     jerry_value_t result = jerryx_module_resolve(argv[0], resolvers, 3);
     if (jerry_value_is_error(result)) {
         DBG_PRINT("Couldn't load module %s\n", module);
+        jerry_release_value(result);
         return NOTSUPPORTED_ERROR("Module not found");
     } else {
         DBG_PRINT("Module %s loaded\n", module);
     }
+    if (use_cache) {
+        ZVAL rval = jerry_set_property(cache, key, result);
+    }
     return result;
 }
 
+static ZJS_DECL_FUNC(require_get_cache_stats)
+{
+    // returns: object with the number of requires served from the cache
+    //            (hits) and loaded (misses), and JS module files read
+    jerry_value_t stats = zjs_create_object();
+    zjs_obj_add_number(stats, "hits", cache_hits);
+    zjs_obj_add_number(stats, "misses", cache_misses);
+    zjs_obj_add_number(stats, "reads", module_reads);
+    return stats;
+}
+
 // native eval handler
 static ZJS_DECL_FUNC(native_eval_handler)
 {
@@ -266,6 +334,142 @@ static ZJS_DECL_FUNC(process_exit)
     exit(status);
 }
 #endif
+
+static ZJS_DECL_FUNC(process_hrtime)
+{
+    // args: optional earlier result to subtract
+    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_ARRAY);
+
+    u64_t ns = zjs_hrtime_ns();
+    if (argc > 0) {
+        ZVAL sec = jerry_get_property_by_index(argv[0], 0);
+        ZVAL nsec = jerry_get_property_by_index(argv[0], 1);
+        if (!jerry_value_is_number(sec) || !jerry_value_is_number(nsec)) {
+            return TYPE_ERROR("expected hrtime() result");
+        }
+        double s = jerry_get_number_value(sec);
+        double n = jerry_get_number_value(nsec);
+        if (!(s >= 0 && n >= 0 && n < 1000000000)) {
+            return RANGE_ERROR("expected hrtime() result");
+        }
+        // a time later than now gives 0 rather than wrapping
+        u64_t prev = ns;
+        if (s <= ns / 1000000000) {
+            prev = (u64_t)s * 1000000000 + (u64_t)n;
+        }
+        ns = prev < ns ? ns - prev : 0;
+    }
+
+    // returns: [seconds, nanoseconds]
+    jerry_value_t rval = jerry_create_array(2);
+    ZVAL sec = jerry_create_number(ns / 1000000000);
+    ZVAL nsec = jerry_create_number(ns % 1000000000);
+    ZVAL rv1 = jerry_set_property_by_index(rval, 0, sec);
+    ZVAL rv2 = jerry_set_property_by_index(rval, 1, nsec);
+    return rval;
+}
+
+static ZJS_DECL_FUNC(process_hrtime_bigint)
+{
+    // there's no BigInt in JerryScript, but a double holds nanoseconds
+    //   exactly for over 100 days
+    return jerry_create_number(zjs_hrtime_ns());
+}
+
+#ifdef ZJS_CALLBACK_TUNING
+static ZJS_DECL_FUNC(process_set_callback_budget)
+{
+    // args: budget in microseconds
+    ZJS_VALIDATE_ARGS(Z_NUMBER);
+
+    double us = jerry_get_number_value(argv[0]);
+    if (us < 0) {
+        return RANGE_ERROR("budget must not be negative");
+    }
+    zjs_set_callback_budget((u32_t)us);
+    return ZJS_UNDEFINED;
+}
+
+static ZJS_DECL_FUNC(process_get_callback_budget)
+{
+    return jerry_create_number(zjs_get_callback_budget());
+}
+
+static ZJS_DECL_FUNC(process_get_callback_lane_depths)
+{
+    // returns: object with the number of callbacks waiting in each lane
+    jerry_value_t depths = zjs_create_object();
+    zjs_obj_add_number(depths, "hardware",
+                       zjs_get_callback_lane_depth(ZJS_CB_LANE_HW));
+    zjs_obj_add_number(depths, "js",
+                       zjs_get_callback_lane_depth(ZJS_CB_LANE_JS));
+    return depths;
+}
+
+static const char *overflow_policies[] = {
+    "drop-newest", "drop-oldest", "coalesce", "block", NULL
+};
+
+static ZJS_DECL_FUNC(process_set_callback_overflow_policy)
+{
+    // args: policy name
+    ZJS_VALIDATE_ARGS(Z_STRING);
+
+    char policy[16];
+    jerry_size_t size = sizeof(policy);
+    zjs_copy_jstring(argv[0], policy, &size);
+    for (int i = 0; overflow_policies[i]; i++) {
+        if (strequal(policy, overflow_policies[i])) {
+            zjs_set_callback_overflow_policy(i);
+            return ZJS_UNDEFINED;
+        }
+    }
+    return RANGE_ERROR("unknown overflow policy");
+}
+
+static jerry_value_t create_queue_stats()
+{
+    zjs_callback_queue_stats_t stats;
+    zjs_get_callback_queue_stats(&stats);
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_string(obj, "policy",
+                       overflow_policies[zjs_get_callback_overflow_policy()]);
+    zjs_obj_add_number(obj, "dropped", stats.dropped);
+    zjs_obj_add_number(obj, "coalesced", stats.coalesced);
+    zjs_obj_add_number(obj, "blocked", stats.blocked);
+    zjs_obj_add_number(obj, "grown", stats.grown);
+    ZVAL sizes = zjs_create_object();
+    zjs_obj_add_number(sizes, "hardware", stats.size[ZJS_CB_LANE_HW]);
+    zjs_obj_add_number(sizes, "js", stats.size[ZJS_CB_LANE_JS]);
+    zjs_obj_add_object(obj, "sizes", sizes);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(process_get_callback_queue_stats)
+{
+    return create_queue_stats();
+}
+
+#ifdef ZJS_PROCESS_EVENTS
+static void process_overflow()
+{
+    // effects: emits 'overflow' on the process object with queue stats
+    ZVAL global_obj = jerry_get_global_object();
+    ZVAL process = zjs_get_property(global_obj, "process");
+    ZVAL stats = create_queue_stats();
+    zjs_emit_event(process, "overflow", &stats, 1);
+}
+#endif
+#endif  // ZJS_CALLBACK_TUNING
+
+#ifdef ZJS_TRACE_CALLBACKS
+static ZJS_DECL_FUNC(process_dump_callback_trace)
+{
+    zjs_dump_callback_trace();
+    return ZJS_UNDEFINED;
+}
+#endif
+
 #ifdef ZJS_DYNAMIC_LOAD
 void zjs_modules_check_load_file()
 {
@@ -336,16 +540,47 @@ void zjs_modules_init()
 #endif // ZJS_DYNAMIC_LOAD
 
     // create the C handler for require JS call
-    zjs_obj_add_function(global_obj, "require", native_require_handler);
+    ZVAL require = jerry_create_external_function(native_require_handler);
+    ZVAL cache = zjs_create_object();
+    zjs_set_property(require, "cache", cache);
+    zjs_obj_add_function(require, "getCacheStats", require_get_cache_stats);
+    zjs_set_property(global_obj, "require", require);
+    cache_hits = cache_misses = module_reads = 0;
+
+    zjs_hrtime_init();
 
-#ifdef ZJS_LINUX_BUILD
     ZVAL process = zjs_create_object();
+#ifdef ZJS_LINUX_BUILD
     zjs_obj_add_function(process, "exit", process_exit);
-    zjs_set_property(global_obj, "process", process);
 #endif
+    ZVAL hrtime = jerry_create_external_function(process_hrtime);
+    zjs_obj_add_function(hrtime, "bigint", process_hrtime_bigint);
+    zjs_set_property(process, "hrtime", hrtime);
+#ifdef ZJS_CALLBACK_TUNING
+    zjs_obj_add_function(process, "setCallbackBudget",
+                         process_set_callback_budget);
+    zjs_obj_add_function(process, "getCallbackBudget",
+                         process_get_callback_budget);
+    zjs_obj_add_function(process, "getCallbackLaneDepths",
+                         process_get_callback_lane_depths);
+    zjs_obj_add_function(process, "setCallbackOverflowPolicy",
+                         process_set_callback_overflow_policy);
+    zjs_obj_add_function(process, "getCallbackQueueStats",
+                         process_get_callback_queue_stats);
+#endif
+#ifdef ZJS_TRACE_CALLBACKS
+    zjs_obj_add_function(process, "dumpCallbackTrace",
+                         process_dump_callback_trace);
+#endif
+    zjs_set_property(global_obj, "process", process);
 
     // initialize callbacks early in case any init functions use them
     zjs_init_callbacks();
+#ifdef ZJS_PROCESS_EVENTS
+    // process emits 'overflow' when callback signals are lost
+    zjs_make_emitter(process, ZJS_UNDEFINED, NULL, NULL);
+    zjs_set_callback_overflow_handler(process_overflow);
+#endif
     // Load global modules
     int gbl_modcount = sizeof(zjs_global_array) / sizeof(gbl_module_t);
     for (int i = 0; i < gbl_modcount; i++) {
@@ -407,12 +642,17 @@ s32_t zjs_service_routines(void)
     int i;
     for (i = 0; i < num_routines; ++i) {
         s32_t ret = svc_routine_map[i].func(svc_routine_map[i].handle);
-        wait = (wait < ret) ? wait : ret;
-    }
 #ifdef ZJS_LINUX_BUILD
-    if (wait == ZJS_TICKS_FOREVER) {
-        return 0;
-    }
+        // routines report time until their next event; keep the soonest
+        if (ret == ZJS_TICKS_FOREVER) {
+            continue;
+        }
+        if (wait == ZJS_TICKS_FOREVER || ret < wait) {
+            wait = ret;
+        }
+#else
+        wait = (wait < ret) ? wait : ret;
 #endif
+    }
     return wait;
 }
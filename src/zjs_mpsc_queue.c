@@ -0,0 +1,126 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// C includes
+#include <string.h>
+
+// ZJS includes
+#include "zjs_atomic.h"
+#include "zjs_mpsc_queue.h"
+#include "zjs_util.h"
+
+/*
+ * Record layout, each record starts on an even word position:
+ *
+ *   word 0     tag: (position << 2) | TAG_RECORD, or TAG_PAD for padding
+ *              that skips to the end of the buffer; 0 while unpublished
+ *   word 1     header: type | size32 << 16 | value << 24
+ *   word 2...  payload, rounded up to an even number of words
+ */
+
+#define TAG_RECORD 1
+#define TAG_PAD    3
+
+#define MAKE_TAG(pos, kind) (((pos) << 2) | (kind))
+#define MAKE_HEADER(type, value, size32) \
+    ((u32_t)(type) | ((u32_t)(size32) << 16) | ((u32_t)(value) << 24))
+
+static inline u32_t record_words(u8_t size32)
+{
+    // header words plus payload, rounded up to keep records on even positions
+    return (2 + size32 + 1) & ~1;
+}
+
+void zjs_mpsc_init(zjs_mpsc_queue_t *q, u32_t *buf, u32_t size32)
+{
+    if (size32 < 4 || (size32 & (size32 - 1))) {
+        ERR_PRINT("queue size %u is not a power of 2\n", size32);
+    }
+    memset(buf, 0, size32 * sizeof(u32_t));
+    q->buf = buf;
+    q->mask = size32 - 1;
+    q->head = 0;
+    q->tail = 0;
+    q->count = 0;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+int zjs_mpsc_put(zjs_mpsc_queue_t *q, u16_t type, u8_t value,
+                 const u32_t *data, u8_t size32)
+{
+    u32_t size = q->mask + 1;
+    u32_t need = record_words(size32);
+    if (need > size) {
+        return -EMSGSIZE;
+    }
+
+    u32_t tail, pad;
+    do {
+        // read head first so a stale tail can never appear to be behind it
+        u32_t head = ZJS_ATOMIC_LOAD(&q->head);
+        tail = ZJS_ATOMIC_LOAD(&q->tail);
+        u32_t offset = tail & q->mask;
+        // records never wrap; pad out to the end of the buffer instead
+        pad = (offset + need > size) ? size - offset : 0;
+        if (tail - head + pad + need > size) {
+            return -EMSGSIZE;
+        }
+    } while (!ZJS_ATOMIC_CAS(&q->tail, tail, tail + pad + need));
+
+    // the space from tail to tail + pad + need now belongs to this producer
+    if (pad) {
+        ZJS_ATOMIC_STORE(&q->buf[tail & q->mask], MAKE_TAG(tail, TAG_PAD));
+        tail += pad;
+    }
+    u32_t *rec = &q->buf[tail & q->mask];
+    rec[1] = MAKE_HEADER(type, value, size32);
+    if (size32) {
+        memcpy(&rec[2], data, size32 * sizeof(u32_t));
+    }
+    // publish; the consumer won't look past the tag until it matches
+    ZJS_ATOMIC_STORE(&rec[0], MAKE_TAG(tail, TAG_RECORD));
+    ZJS_ATOMIC_INC(&q->count);
+    return 0;
+}
+
+int zjs_mpsc_peek(zjs_mpsc_queue_t *q, zjs_mpsc_msg_t *msg)
+{
+    u32_t head = q->head;  // only the consumer writes head
+    while (1) {
+        u32_t *rec = &q->buf[head & q->mask];
+        u32_t tag = ZJS_ATOMIC_LOAD(&rec[0]);
+        if (tag == MAKE_TAG(head, TAG_PAD)) {
+            // skip the padding at the end of the buffer
+            rec[0] = 0;
+            head += q->mask + 1 - (head & q->mask);
+            ZJS_ATOMIC_STORE(&q->head, head);
+            continue;
+        }
+        if (tag != MAKE_TAG(head, TAG_RECORD)) {
+            // empty, or the next producer hasn't finished writing yet
+            return -EAGAIN;
+        }
+        u32_t header = rec[1];
+        msg->type = header & 0xffff;
+        msg->size32 = (header >> 16) & 0xff;
+        msg->value = header >> 24;
+        msg->data = &rec[2];
+        return 0;
+    }
+}
+
+void zjs_mpsc_consume(zjs_mpsc_queue_t *q, const zjs_mpsc_msg_t *msg)
+{
+    u32_t head = q->head;
+    u32_t need = record_words(msg->size32);
+    // clear the record so a stale tag can't be mistaken for a new one
+    memset(&q->buf[head & q->mask], 0, need * sizeof(u32_t));
+    ZJS_ATOMIC_STORE(&q->head, head + need);
+    ZJS_ATOMIC_DEC(&q->count);
+}
+
+u32_t zjs_mpsc_count(zjs_mpsc_queue_t *q)
+{
+    // the consumer may run ahead of a producer's increment, so clamp at 0
+    s32_t count = (s32_t)ZJS_ATOMIC_LOAD(&q->count);
+    return count > 0 ? count : 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_mpsc_queue_h__
+#define __zjs_mpsc_queue_h__
+
+#include "zjs_atomic.h"
+
+/*
+ * Lock-free multi-producer, single-consumer message queue
+ *
+ * Any number of producers (ISRs, driver threads, the main thread) may call
+ * zjs_mpsc_put() concurrently without taking a lock; exactly one consumer (the
+ * main thread) reads messages with zjs_mpsc_peek() / zjs_mpsc_consume().
+ *
+ * Producers reserve space by advancing the tail with compare-and-swap, copy
+ * their message in, then publish it by storing a sequence tag derived from its
+ * position in the first word of the record. The consumer only reads a record
+ * once its tag matches the head position, and clears it before moving the head
+ * forward, so records are never seen half written. Records are kept contiguous
+ * in the buffer so the consumer sees the header and payload in one place.
+ */
+
+typedef struct zjs_mpsc_queue {
+    u32_t *buf;          // storage, 32-bit words
+    u32_t mask;          // size of buf in words - 1
+    zjs_atomic_t tail;   // next word position to reserve (producers)
+    zjs_atomic_t head;   // next word position to read (consumer)
+    zjs_atomic_t count;  // number of published messages not yet consumed
+} zjs_mpsc_queue_t;
+
+typedef struct zjs_mpsc_msg {
+    u16_t type;          // application-specific
+    u8_t value;          // room for small integral values
+    u8_t size32;         // payload length in 32-bit words
+    const u32_t *data;   // payload, valid until zjs_mpsc_consume()
+} zjs_mpsc_msg_t;
+
+/**
+ * Initialize a queue
+ *
+ * @param q       Queue to initialize
+ * @param buf     Storage for the queue
+ * @param size32  Size of buf in 32-bit words, must be a power of two >= 4
+ */
+void zjs_mpsc_init(zjs_mpsc_queue_t *q, u32_t *buf, u32_t size32);
+
+/**
+ * Add a message to the queue
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param q       Queue to add to
+ * @param type    Application-specific message type
+ * @param value   Small integral value stored in the header
+ * @param data    Payload to copy, or NULL if size32 is 0
+ * @param size32  Payload length in 32-bit words
+ *
+ * @return        0 on success, -EMSGSIZE if there isn't room
+ */
+int zjs_mpsc_put(zjs_mpsc_queue_t *q, u16_t type, u8_t value,
+                 const u32_t *data, u8_t size32);
+
+/**
+ * Get the message at the head of the queue without removing it; consumer only
+ *
+ * @param q       Queue to read from
+ * @param msg     Filled in with the header and a pointer to the payload
+ *
+ * @return        0 on success, -EAGAIN if no message is ready
+ */
+int zjs_mpsc_peek(zjs_mpsc_queue_t *q, zjs_mpsc_msg_t *msg);
+
+/**
+ * Remove the message returned by the last zjs_mpsc_peek(); consumer only
+ *
+ * @param q       Queue to remove from
+ * @param msg     Message returned by zjs_mpsc_peek()
+ */
+void zjs_mpsc_consume(zjs_mpsc_queue_t *q, const zjs_mpsc_msg_t *msg);
+
+/**
+ * Get the number of messages waiting in the queue
+ *
+ * @param q       Queue to check
+ *
+ * @return        Message count; may be stale if producers are active
+ */
+u32_t zjs_mpsc_count(zjs_mpsc_queue_t *q);
+
+#endif  // __zjs_mpsc_queue_h__
@@ -0,0 +1,178 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// C includes
+#include <stddef.h>
+#include <string.h>
+
+// ZJS includes
+#include "zjs_atomic.h"
+#include "zjs_msgblock.h"
+#include "zjs_util.h"
+
+// payload size and number of blocks in each pool, smallest first; this could
+//   be defined with config options in the future
+#ifndef ZJS_MSGBLOCK_POOLS
+#ifdef ZJS_LINUX_BUILD
+#define ZJS_MSGBLOCK_POOLS { { 256, 16 }, { 1024, 8 }, { 4096, 4 } }
+#else
+#define ZJS_MSGBLOCK_POOLS { { 128, 4 }, { 512, 2 } }
+#endif
+#endif
+
+struct zjs_msgblock {
+    zjs_atomic_t refs;
+    u32_t size;    // payload bytes in use
+    u16_t index;   // position in its pool
+    u8_t pool;     // pool it came from
+    u8_t data[] __attribute__((aligned(8)));
+};
+
+typedef struct pool_config {
+    u32_t capacity;
+    u16_t count;
+} pool_config_t;
+
+typedef struct msgblock_pool {
+    u32_t capacity;     // payload bytes per block
+    u32_t stride;       // bytes per block, including the header
+    u16_t count;
+    u8_t *storage;
+    u16_t *next;        // free list links, index + 1 of the next free block
+    zjs_atomic_t top;   // free list head: tag << 16 | (index + 1), 0 if empty
+} msgblock_pool_t;
+
+static const pool_config_t pool_configs[] = ZJS_MSGBLOCK_POOLS;
+#define POOL_COUNT (sizeof(pool_configs) / sizeof(pool_config_t))
+
+static msgblock_pool_t pools[POOL_COUNT];
+static zjs_atomic_t in_use = 0;
+static bool initialized = false;
+
+#define BLOCK_AT(pool, i) \
+    ((zjs_msgblock_t *)((pool)->storage + (u32_t)(i) * (pool)->stride))
+
+// the tag in the top half of the free list head changes on every update, so a
+//   pop that raced with a pop and push of the same block fails its CAS
+#define NEXT_TOP(top, link) ((((top) + 0x10000) & 0xffff0000) | (link))
+
+static void push_free(msgblock_pool_t *pool, u16_t index)
+{
+    u32_t top;
+    do {
+        top = ZJS_ATOMIC_LOAD(&pool->top);
+        pool->next[index] = top & 0xffff;
+    } while (!ZJS_ATOMIC_CAS(&pool->top, top, NEXT_TOP(top, index + 1)));
+}
+
+static zjs_msgblock_t *pop_free(msgblock_pool_t *pool)
+{
+    u32_t top, link;
+    do {
+        top = ZJS_ATOMIC_LOAD(&pool->top);
+        link = top & 0xffff;
+        if (!link) {
+            return NULL;
+        }
+    } while (!ZJS_ATOMIC_CAS(&pool->top, top,
+                             NEXT_TOP(top, pool->next[link - 1])));
+    return BLOCK_AT(pool, link - 1);
+}
+
+void zjs_msgblock_init(void)
+{
+    if (initialized) {
+        return;
+    }
+    for (int i = 0; i < POOL_COUNT; i++) {
+        msgblock_pool_t *pool = &pools[i];
+        pool->capacity = pool_configs[i].capacity;
+        pool->stride = (sizeof(zjs_msgblock_t) + pool->capacity + 7) & ~7;
+        pool->count = pool_configs[i].count;
+        pool->storage = zjs_malloc(pool->stride * pool->count);
+        pool->next = zjs_malloc(sizeof(u16_t) * pool->count);
+        pool->top = 0;
+        if (!pool->storage || !pool->next) {
+            ERR_PRINT("no memory for %u byte message blocks\n",
+                      pool->capacity);
+            zjs_free(pool->storage);
+            zjs_free(pool->next);
+            pool->storage = NULL;
+            pool->next = NULL;
+            pool->count = 0;
+            continue;
+        }
+        // push in reverse so the first block is handed out first
+        for (int j = pool->count - 1; j >= 0; j--) {
+            zjs_msgblock_t *block = BLOCK_AT(pool, j);
+            block->pool = i;
+            block->index = j;
+            push_free(pool, j);
+        }
+    }
+    initialized = true;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+zjs_msgblock_t *zjs_msgblock_alloc(u32_t size)
+{
+    // fall back to larger pools when the best fit is used up
+    for (int i = 0; i < POOL_COUNT; i++) {
+        if (pools[i].capacity < size) {
+            continue;
+        }
+        zjs_msgblock_t *block = pop_free(&pools[i]);
+        if (block) {
+            block->size = size;
+            ZJS_ATOMIC_STORE(&block->refs, 1);
+            ZJS_ATOMIC_INC(&in_use);
+            return block;
+        }
+    }
+    return NULL;
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+void zjs_msgblock_ref(zjs_msgblock_t *block)
+{
+    ZJS_ATOMIC_INC(&block->refs);
+}
+
+// INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+void zjs_msgblock_unref(zjs_msgblock_t *block)
+{
+    if (ZJS_ATOMIC_DEC(&block->refs) == 1) {
+        ZJS_ATOMIC_DEC(&in_use);
+        push_free(&pools[block->pool], block->index);
+    }
+}
+
+void *zjs_msgblock_data(zjs_msgblock_t *block)
+{
+    return block->data;
+}
+
+zjs_msgblock_t *zjs_msgblock_from_data(const void *data)
+{
+    return (zjs_msgblock_t *)((u8_t *)data - offsetof(zjs_msgblock_t, data));
+}
+
+u32_t zjs_msgblock_size(zjs_msgblock_t *block)
+{
+    return block->size;
+}
+
+u32_t zjs_msgblock_capacity(zjs_msgblock_t *block)
+{
+    return pools[block->pool].capacity;
+}
+
+void zjs_msgblock_set_size(zjs_msgblock_t *block, u32_t size)
+{
+    u32_t capacity = pools[block->pool].capacity;
+    block->size = size < capacity ? size : capacity;
+}
+
+u32_t zjs_msgblock_in_use(void)
+{
+    return ZJS_ATOMIC_LOAD(&in_use);
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_msgblock_h__
+#define __zjs_msgblock_h__
+
+// ZJS includes
+#include "zjs_common.h"
+
+/*
+ * Pooled, reference counted message blocks
+ *
+ * A producer (ISR, driver or network thread) takes a block from a pool, fills
+ * it in place and hands it to the main thread with zjs_defer_block(), so only
+ * the block handle travels through the callback queue and the payload is never
+ * copied. The last zjs_msgblock_unref() returns the block to its pool.
+ *
+ * Blocks come from a few fixed size classes set up at init time, so allocating
+ * and releasing never calls malloc and is safe from interrupts.
+ */
+
+typedef struct zjs_msgblock zjs_msgblock_t;
+
+/**
+ * Set up the block pools; called from zjs_init_callbacks()
+ */
+void zjs_msgblock_init(void);
+
+/**
+ * Take a block from the smallest pool that fits
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ *
+ * @param size    Payload size in bytes
+ *
+ * @return        A block with one reference and its size set to size, or NULL
+ *                  if no pool has a free block that large
+ */
+zjs_msgblock_t *zjs_msgblock_alloc(u32_t size);
+
+/**
+ * Add a reference to a block
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ */
+void zjs_msgblock_ref(zjs_msgblock_t *block);
+
+/**
+ * Drop a reference to a block, returning it to its pool after the last one
+ *
+ * INTERRUPT SAFE FUNCTION: No JerryScript VM, allocs, or release prints!
+ */
+void zjs_msgblock_unref(zjs_msgblock_t *block);
+
+/**
+ * Get a block's payload, aligned to 8 bytes
+ */
+void *zjs_msgblock_data(zjs_msgblock_t *block);
+
+/**
+ * Get the block that holds a payload returned by zjs_msgblock_data()
+ */
+zjs_msgblock_t *zjs_msgblock_from_data(const void *data);
+
+/**
+ * Get the number of payload bytes in use
+ */
+u32_t zjs_msgblock_size(zjs_msgblock_t *block);
+
+/**
+ * Get the most payload bytes the block can hold
+ */
+u32_t zjs_msgblock_capacity(zjs_msgblock_t *block);
+
+/**
+ * Set the number of payload bytes in use, e.g. after filling a block with less
+ * data than requested; clamped to the block's capacity
+ */
+void zjs_msgblock_set_size(zjs_msgblock_t *block, u32_t size);
+
+/**
+ * Get the number of blocks currently allocated from all pools
+ */
+u32_t zjs_msgblock_in_use(void);
+
+#endif  // __zjs_msgblock_h__
@@ -261,9 +261,7 @@ jerry_value_t ocf_object;
  */
 void oc_signal_main_loop(void)
 {
-#ifndef ZJS_LINUX_BUILD
     zjs_loop_unblock();
-#endif
 }
 
 #ifdef OC_CLIENT
@@ -480,7 +478,20 @@ static int app_init(void)
 
 s32_t main_poll_routine(void *handle)
 {
+#ifdef ZJS_LINUX_BUILD
+    // oc_main_poll returns the absolute time of the next event, or 0 if none
+    oc_clock_time_t next = oc_main_poll();
+    if (!next) {
+        return ZJS_TICKS_FOREVER;
+    }
+    oc_clock_time_t now = oc_clock_time();
+    if (next <= now) {
+        return ZJS_TICKS_NONE;
+    }
+    return (s32_t)((next - now) * 1000 / OC_CLOCK_SECOND);
+#else
     return (s32_t)oc_main_poll();
+#endif
 }
 
 static const oc_handler_t handler = {
@@ -1,33 +1,110 @@
 // Copyright (c) 2016, Linaro Limited.
 #ifdef BUILD_MODULE_PERFORMANCE
 
-#ifdef ZJS_LINUX_BUILD
-// C includes
-#include <sys/time.h>
-#endif
-
 // ZJS includes
+#include "zjs_hrtime.h"
+#include "zjs_loop_stats.h"
 #include "zjs_util.h"
 
 static ZJS_DECL_FUNC(zjs_performance_now)
 {
     if (argc != 0)
         return zjs_error("no args expected");
-#ifdef ZJS_LINUX_BUILD
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    uint64_t useconds = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
-#else
-    uint64_t useconds = (uint64_t)k_uptime_get() * 1000;
-#endif
-    return jerry_create_number((double)useconds / 1000);
+    return jerry_create_number(zjs_hrtime_elapsed_ms());
+}
+
+#ifdef ZJS_LOOP_STATS
+static jerry_value_t create_phase_stats(const zjs_loop_phase_stats_t *stats)
+{
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "count", stats->count);
+    zjs_obj_add_number(obj, "total", (double)stats->total_ns / 1000000);
+    zjs_obj_add_number(obj, "mean", stats->count ?
+                       (double)stats->total_ns / stats->count / 1000000 : 0);
+    zjs_obj_add_number(obj, "min",
+                       stats->count ? (double)stats->min_us / 1000 : 0);
+    zjs_obj_add_number(obj, "max", (double)stats->max_us / 1000);
+    zjs_obj_add_number(obj, "p50",
+                       (double)zjs_loop_stats_percentile(stats, 50) / 1000);
+    zjs_obj_add_number(obj, "p90",
+                       (double)zjs_loop_stats_percentile(stats, 90) / 1000);
+    zjs_obj_add_number(obj, "p99",
+                       (double)zjs_loop_stats_percentile(stats, 99) / 1000);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_event_loop_stats)
+{
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "iterations", zjs_loop_stats_iterations());
+    for (int i = 0; i < ZJS_PHASE_COUNT; i++) {
+        jerry_value_t phase = create_phase_stats(zjs_loop_stats_get(i));
+        zjs_obj_add_object(obj, zjs_loop_stats_phase_name(i), phase);
+        jerry_release_value(phase);
+    }
+    return obj;
 }
 
+static jerry_value_t create_utilization(double idle, double active)
+{
+    jerry_value_t obj = zjs_create_object();
+    zjs_obj_add_number(obj, "idle", idle);
+    zjs_obj_add_number(obj, "active", active);
+    double total = idle + active;
+    zjs_obj_add_number(obj, "utilization", total > 0 ? active / total : 0);
+    return obj;
+}
+
+static ZJS_DECL_FUNC(zjs_performance_event_loop_utilization)
+{
+    // args: optional earlier result, optional later result
+    ZJS_VALIDATE_ARGS_OPTCOUNT(optcount, Z_OPTIONAL Z_OBJECT,
+                               Z_OPTIONAL Z_OBJECT);
+
+    double idle = 0, active = 0;
+    if (optcount == 2) {
+        if (!zjs_obj_get_double(argv[1], "idle", &idle) ||
+            !zjs_obj_get_double(argv[1], "active", &active)) {
+            return TYPE_ERROR("expected eventLoopUtilization() result");
+        }
+    } else {
+        for (int i = 0; i < ZJS_PHASE_COUNT; i++) {
+            double ms = (double)zjs_loop_stats_get(i)->total_ns / 1000000;
+            if (i == ZJS_PHASE_IDLE) {
+                idle += ms;
+            } else {
+                active += ms;
+            }
+        }
+    }
+
+    if (optcount >= 1) {
+        // report the difference since an earlier result
+        double idle0, active0;
+        if (!zjs_obj_get_double(argv[0], "idle", &idle0) ||
+            !zjs_obj_get_double(argv[0], "active", &active0)) {
+            return TYPE_ERROR("expected eventLoopUtilization() result");
+        }
+        idle -= idle0;
+        active -= active0;
+    }
+    return create_utilization(idle, active);
+}
+#endif  // ZJS_LOOP_STATS
+
 static jerry_value_t zjs_performance_init()
 {
     // create global performance object
     jerry_value_t performance_obj = zjs_create_object();
     zjs_obj_add_function(performance_obj, "now", zjs_performance_now);
+    zjs_obj_add_readonly_number(performance_obj, "timeOrigin",
+                                zjs_hrtime_origin());
+#ifdef ZJS_LOOP_STATS
+    zjs_obj_add_function(performance_obj, "eventLoopStats",
+                         zjs_performance_event_loop_stats);
+    zjs_obj_add_function(performance_obj, "eventLoopUtilization",
+                         zjs_performance_event_loop_utilization);
+#endif
     return performance_obj;
 }
 
@@ -0,0 +1,250 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifdef ZJS_LINUX_BUILD
+
+// C includes
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ZJS includes
+#include "zjs_snapshot_cache.h"
+#include "zjs_util.h"
+
+#define CACHE_MAGIC 0x534a5a53  // "SZJS"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// written ahead of the snapshot in each cache file, and checked on load so a
+//   hash collision or a truncated file is treated as a miss
+typedef struct cache_header {
+    u32_t magic;
+    u32_t source_len;
+    u64_t source_hash;
+    u64_t engine_id;
+    u32_t snapshot_len;
+    u32_t reserved;
+} cache_header_t;
+
+// JerryScript starts each snapshot with a magic word and its snapshot format
+//   version; a snapshot is only run if these match what this engine writes
+#define ENGINE_HEADER_WORDS 2
+
+static char *cache_dir = NULL;
+static u64_t engine_id = 0;
+static u32_t engine_header[ENGINE_HEADER_WORDS];
+static bool engine_header_known = false;
+
+static u64_t fnv1a(u64_t hash, const void *data, size_t len)
+{
+    const u8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static u64_t get_engine_id()
+{
+    // effects: returns a hash that changes whenever jslinux is rebuilt, since
+    //            snapshots are only valid for the engine that saved them
+    static const char build[] = __DATE__ " " __TIME__;
+    u32_t version[2] = { JERRY_API_MAJOR_VERSION, JERRY_API_MINOR_VERSION };
+    u64_t hash = fnv1a(FNV_OFFSET, version, sizeof(version));
+    hash = fnv1a(hash, build, sizeof(build));
+
+    // this file may not be rebuilt when JerryScript is, but the binary is
+    //   always relinked
+    struct stat st;
+    if (stat("/proc/self/exe", &st) == 0) {
+        hash = fnv1a(hash, &st.st_size, sizeof(st.st_size));
+        hash = fnv1a(hash, &st.st_mtime, sizeof(st.st_mtime));
+    }
+    return hash;
+}
+
+bool zjs_snapshot_cache_init(const char *dir)
+{
+    zjs_free(cache_dir);
+    cache_dir = NULL;
+    if (!dir) {
+        return true;
+    }
+
+    if (!jerry_is_feature_enabled(JERRY_FEATURE_SNAPSHOT_SAVE) ||
+        !jerry_is_feature_enabled(JERRY_FEATURE_SNAPSHOT_EXEC)) {
+        ERR_PRINT("JerryScript was built without snapshot support\n");
+        return false;
+    }
+
+    if (mkdir(dir, 0755) && errno != EEXIST) {
+        ERR_PRINT("could not create snapshot cache '%s'\n", dir);
+        return false;
+    }
+
+    cache_dir = zjs_malloc(strlen(dir) + 1);
+    if (!cache_dir) {
+        return false;
+    }
+    strcpy(cache_dir, dir);
+    engine_id = get_engine_id();
+    return true;
+}
+
+static bool engine_accepts(const u32_t *snapshot, u32_t size)
+{
+    // effects: returns true if snapshot starts with the same format header
+    //            as the snapshots this engine generates, so it will run it
+    //            rather than reject it
+    if (!engine_header_known) {
+        // generate an empty snapshot once to learn the header
+        const jerry_char_t *empty = (const jerry_char_t *)"";
+        u32_t buf[64];
+        jerry_value_t rval = jerry_generate_snapshot(empty, 0, empty, 0, 0,
+                                                     buf, sizeof(buf));
+        bool ok = !jerry_value_is_error(rval) &&
+                  jerry_get_number_value(rval) >= sizeof(engine_header);
+        jerry_release_value(rval);
+        if (!ok) {
+            return false;
+        }
+        memcpy(engine_header, buf, sizeof(engine_header));
+        engine_header_known = true;
+    }
+    return size >= sizeof(engine_header) &&
+           !memcmp(snapshot, engine_header, sizeof(engine_header));
+}
+
+static u32_t *load_snapshot(const char *path, const cache_header_t *expect,
+                            u32_t *size)
+{
+    // effects: returns the snapshot saved at path if its header matches
+    //            expect, with its size in *size; NULL otherwise
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    cache_header_t header;
+    u32_t *snapshot = NULL;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != expect->magic ||
+        header.source_len != expect->source_len ||
+        header.source_hash != expect->source_hash ||
+        header.engine_id != expect->engine_id ||
+        header.snapshot_len == 0 || header.snapshot_len % sizeof(u32_t)) {
+        DBG_PRINT("stale snapshot %s\n", path);
+        goto done;
+    }
+
+    snapshot = zjs_malloc(header.snapshot_len);
+    if (snapshot && fread(snapshot, header.snapshot_len, 1, f) != 1) {
+        DBG_PRINT("truncated snapshot %s\n", path);
+        zjs_free(snapshot);
+        snapshot = NULL;
+    } else if (snapshot && !engine_accepts(snapshot, header.snapshot_len)) {
+        DBG_PRINT("incompatible snapshot %s\n", path);
+        zjs_free(snapshot);
+        snapshot = NULL;
+    }
+    *size = header.snapshot_len;
+
+done:
+    fclose(f);
+    return snapshot;
+}
+
+static u32_t *save_snapshot(const char *path, cache_header_t *header,
+                            const char *name, const char *source)
+{
+    // effects: parses source into a snapshot and writes it to path; returns
+    //            the snapshot, with its size in header->snapshot_len, or
+    //            NULL if the source doesn't parse or is too large
+    // bytecode is usually smaller than the source it came from
+    size_t buf_size = ((size_t)header->source_len * 2 + 4096) & ~3;
+    u32_t *snapshot = zjs_malloc(buf_size);
+    if (!snapshot) {
+        return NULL;
+    }
+
+    jerry_value_t rval = jerry_generate_snapshot((const jerry_char_t *)name,
+                                                 strlen(name),
+                                                 (const jerry_char_t *)source,
+                                                 header->source_len,
+                                                 0,
+                                                 snapshot,
+                                                 buf_size);
+    if (jerry_value_is_error(rval)) {
+        // let the caller parse it and report any syntax error
+        jerry_release_value(rval);
+        zjs_free(snapshot);
+        return NULL;
+    }
+    header->snapshot_len = (u32_t)jerry_get_number_value(rval);
+    jerry_release_value(rval);
+
+    // write to a temporary file and rename it, so a concurrent run never
+    //   sees a partial snapshot
+    char tmp_path[strlen(path) + 12];
+    sprintf(tmp_path, "%s.%d", path, (int)getpid());
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        DBG_PRINT("could not write snapshot %s\n", path);
+        return snapshot;
+    }
+    bool ok = fwrite(header, sizeof(*header), 1, f) == 1 &&
+              fwrite(snapshot, header->snapshot_len, 1, f) == 1;
+    ok = !fclose(f) && ok;
+    if (!ok || rename(tmp_path, path)) {
+        DBG_PRINT("could not write snapshot %s\n", path);
+        unlink(tmp_path);
+    }
+    return snapshot;
+}
+
+bool zjs_snapshot_cache_run(const char *name, const char *source, u32_t len,
+                            jerry_value_t *result)
+{
+    if (!cache_dir) {
+        return false;
+    }
+
+    cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_MAGIC;
+    header.source_len = len;
+    header.source_hash = fnv1a(FNV_OFFSET, source, len);
+    header.engine_id = engine_id;
+
+    // the file name covers both the source and the engine, so an edited
+    //   script or a rebuilt jslinux looks for a new file and misses
+    u64_t key = fnv1a(header.source_hash, &engine_id, sizeof(engine_id));
+    char path[strlen(cache_dir) + 28];
+    sprintf(path, "%s/%016llx.snapshot", cache_dir, (unsigned long long)key);
+
+    u32_t size = 0;
+    u32_t *snapshot = load_snapshot(path, &header, &size);
+    if (snapshot) {
+        DBG_PRINT("loaded snapshot %s for %s\n", path, name);
+    } else {
+        snapshot = save_snapshot(path, &header, name, source);
+        if (!snapshot) {
+            return false;
+        }
+        size = header.snapshot_len;
+        DBG_PRINT("saved snapshot %s for %s\n", path, name);
+    }
+
+    *result = jerry_exec_snapshot(snapshot, size, 0,
+                                  JERRY_SNAPSHOT_EXEC_COPY_DATA);
+    // the snapshot was checked before it ran, so an error here was thrown by
+    //   the script itself and the snapshot is still good
+    zjs_free(snapshot);
+    return true;
+}
+
+#endif  // ZJS_LINUX_BUILD
@@ -0,0 +1,51 @@
+// Copyright (c) 2018, Intel Corporation.
+
+#ifndef __zjs_snapshot_cache_h__
+#define __zjs_snapshot_cache_h__
+
+/*
+ * Persistent snapshot cache for jslinux
+ *
+ * With --snapshot-cache <dir>, each script jslinux runs is compiled to a
+ * JerryScript snapshot and saved in dir, named by a hash of its source and of
+ * the jslinux binary. Later runs of the same source execute the snapshot and
+ * skip the parser. A changed script or a rebuilt jslinux hashes to a new name,
+ * so stale snapshots are never loaded; the script is parsed and saved again.
+ */
+
+#ifdef ZJS_LINUX_BUILD
+
+// ZJS includes
+#include "zjs_common.h"
+
+// JerryScript includes
+#include "jerryscript.h"
+
+/**
+ * Start caching snapshots in a directory, creating it if needed
+ *
+ * @param dir  Directory to keep snapshots in, or NULL to stop caching
+ *
+ * @return     false if the directory can't be used, or the engine was built
+ *               without snapshot support
+ */
+bool zjs_snapshot_cache_init(const char *dir);
+
+/**
+ * Run a script from its cached snapshot, saving the snapshot first if needed
+ *
+ * @param name    Resource name of the script, for error messages
+ * @param source  Script source
+ * @param len     Length of source in bytes
+ * @param result  Receives the completion value, or the error the script threw
+ *
+ * @return        true if the script ran from a snapshot; false if caching is
+ *                  off or no snapshot could be made, and the caller should
+ *                  parse the script itself
+ */
+bool zjs_snapshot_cache_run(const char *name, const char *source, u32_t len,
+                            jerry_value_t *result);
+
+#endif  // ZJS_LINUX_BUILD
+
+#endif  // __zjs_snapshot_cache_h__
@@ -18,31 +18,308 @@
 #include "zjs_callbacks.h"
 #include "zjs_util.h"
 
+// initial number of slots in the timer heap and handle table, doubled as
+//   needed
+#define INITIAL_TIMER_HEAP_SIZE 8
+
+// timer handles hold a slot index in these low bits and a generation count in
+//   the rest, so a stale handle can't clear a newer timer; handles stay below
+//   2^26, small enough to be direct integer values in JerryScript, without a
+//   heap number, and are never 0, so JS can test them for truth; the index
+//   bits limit live timers to as many as there can be callbacks
+#define TIMER_INDEX_BITS ZJS_CALLBACK_INDEX_BITS
+#define TIMER_INDEX_MASK ((1 << TIMER_INDEX_BITS) - 1)
+#define TIMER_MAX_SLOTS  (1 << TIMER_INDEX_BITS)
+#define TIMER_GEN_MASK   ((1 << (26 - TIMER_INDEX_BITS)) - 1)
+#define TIMER_HANDLE(index, gen) \
+    (((((u32_t)(gen) & TIMER_GEN_MASK) << TIMER_INDEX_BITS) | (index)) + 1)
+// initial number of words in each call queue, doubled as needed
+#define INITIAL_CALL_QUEUE_SIZE 32
+
+// default slack in ms for new timers; override with process.setTimerSlack()
+#ifndef ZJS_TIMER_SLACK
+#define ZJS_TIMER_SLACK 0
+#endif
+
 typedef struct zjs_timer {
+#ifndef ZJS_LINUX_BUILD
     zjs_port_timer_t timer;
+#endif
     jerry_value_t *argv;
     u32_t argc;
     zjs_callback_id callback_id;
     bool repeat;
-#ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    u32_t interval;
+    // a one-shot timer whose callback has been signaled
     bool completed;
+    // slot in timer_slots, whose handle JS uses for this timer
+    u16_t slot;
+    // position in timer_heap, or one of the TIMER_* states below
+    s32_t index;
+    u32_t interval;
+    u32_t slack;    // ms the timer may run late, to share a wakeup
+    u64_t due;      // absolute time in ms the timer is due, before slack
+#ifdef ZJS_LINUX_BUILD
+    u64_t expires;  // absolute expiration time in ms, with slack applied
+    struct zjs_timer *next;  // link in expired_timers
 #endif
-    struct zjs_timer *next;
 } zjs_timer_t;
 
-static zjs_timer_t *zjs_timers = NULL;
+// the timer has been deleted
+#define TIMER_DELETED -1
+// the one-shot timer fired but its args are in use until the callback runs
+#define TIMER_EXPIRED -2
+
+// binary min-heap of active timers; on Linux it is ordered by expiration time
+//   so the next deadline is always timer_heap[0], on Zephyr the kernel does
+//   the scheduling and the heap just gives O(1) lookup for removal
+static zjs_timer_t **timer_heap = NULL;
+static u32_t heap_len = 0;
+static u32_t heap_size = 0;
+
+// table of live timers indexed by handle, so JS only holds a number for each
+//   timer rather than an object
+typedef struct timer_slot {
+    zjs_timer_t *timer;  // NULL if free
+    u16_t gen;           // bumped each time the slot is freed
+    s16_t next_free;     // next slot in the free list, or -1
+} timer_slot_t;
+
+static timer_slot_t *timer_slots = NULL;
+static u32_t slots_size = 0;
+// FIFO list of free slots, so a freed slot's generation moves on slowly
+static s16_t free_head = -1;
+static s16_t free_tail = -1;
+
+#ifdef ZJS_LINUX_BUILD
+// one-shot timers that were signaled on the last pass
+static zjs_timer_t *expired_timers = NULL;
+#endif
+
+// FIFO of JS calls, kept as words in a ring: an ID, the arg count, the
+//   function, then the args; it only allocates when it grows, so queueing a
+//   call is a handful of stores with no timer, callback or JS object
+typedef struct call_queue {
+    jerry_value_t *buf;
+    u32_t mask;   // size of buf in words - 1
+    u32_t head;   // next word to read, free-running
+    u32_t tail;   // next word to write, free-running
+    u32_t count;  // calls queued
+} call_queue_t;
+
+// words ahead of the args in each call
+#define CALL_HEADER 3
+
+// setImmediate() calls, run after I/O callbacks each pass
+static call_queue_t immediates;
+// process.nextTick() calls, run before promise jobs each pass
+static call_queue_t ticks;
+static u32_t next_immediate_id = 1;
+
+static u32_t default_slack = ZJS_TIMER_SLACK;
+// timers fired, and wakeups that fired at least one timer
+static u32_t timers_fired = 0;
+static u32_t timer_wakeups = 0;
+
+static bool slot_alloc(zjs_timer_t *tm)
+{
+    // effects: gives tm a slot in the handle table
+    if (free_head < 0) {
+        u32_t size = slots_size ? slots_size * 2 : INITIAL_TIMER_HEAP_SIZE;
+        if (size > TIMER_MAX_SLOTS) {
+            return false;
+        }
+        timer_slot_t *slots = zjs_malloc(sizeof(timer_slot_t) * size);
+        if (!slots) {
+            return false;
+        }
+        if (timer_slots) {
+            memcpy(slots, timer_slots, sizeof(timer_slot_t) * slots_size);
+            zjs_free(timer_slots);
+        }
+        // link the new slots into the free list, lowest first
+        for (u32_t i = slots_size; i < size; i++) {
+            slots[i].timer = NULL;
+            slots[i].gen = 0;
+            slots[i].next_free = (i + 1 < size) ? i + 1 : -1;
+        }
+        free_head = slots_size;
+        free_tail = size - 1;
+        timer_slots = slots;
+        slots_size = size;
+    }
+    timer_slot_t *slot = &timer_slots[free_head];
+    tm->slot = free_head;
+    free_head = slot->next_free;
+    if (free_head < 0) {
+        free_tail = -1;
+    }
+    slot->timer = tm;
+    return true;
+}
+
+static void free_timer(zjs_timer_t *tm)
+{
+    // effects: frees tm and its slot, so its handle no longer finds it
+    timer_slot_t *slot = &timer_slots[tm->slot];
+    slot->timer = NULL;
+    slot->gen = (slot->gen + 1) & TIMER_GEN_MASK;
+    slot->next_free = -1;
+    if (free_tail >= 0) {
+        timer_slots[free_tail].next_free = tm->slot;
+    } else {
+        free_head = tm->slot;
+    }
+    free_tail = tm->slot;
+    zjs_free(tm);
+}
+
+static inline u32_t timer_handle(zjs_timer_t *tm)
+{
+    return TIMER_HANDLE(tm->slot, timer_slots[tm->slot].gen);
+}
+
+static zjs_timer_t *find_timer(u32_t handle)
+{
+    // returns: the timer with handle, or NULL if it has been freed
+    handle--;
+    u32_t index = handle & TIMER_INDEX_MASK;
+    if (index >= slots_size || handle >> TIMER_INDEX_BITS !=
+                               timer_slots[index].gen) {
+        return NULL;
+    }
+    return timer_slots[index].timer;
+}
+
+static zjs_timer_t *find_timer_number(double value)
+{
+    // returns: the timer with the handle value from JS, or NULL if it has
+    //   been freed or value is NaN or out of the handle range
+    if (!(value >= 1 && value <= (1 << 26))) {
+        return NULL;
+    }
+    return find_timer((u32_t)value);
+}
+
+static inline bool timer_before(zjs_timer_t *a, zjs_timer_t *b)
+{
+#ifdef ZJS_LINUX_BUILD
+    return a->expires < b->expires;
+#else
+    return false;
+#endif
+}
+
+static inline void heap_set(u32_t i, zjs_timer_t *tm)
+{
+    timer_heap[i] = tm;
+    tm->index = i;
+}
+
+static void heap_sift_up(u32_t i)
+{
+    zjs_timer_t *tm = timer_heap[i];
+    while (i > 0) {
+        u32_t parent = (i - 1) / 2;
+        if (!timer_before(tm, timer_heap[parent])) {
+            break;
+        }
+        heap_set(i, timer_heap[parent]);
+        i = parent;
+    }
+    heap_set(i, tm);
+}
+
+static void heap_sift_down(u32_t i)
+{
+    zjs_timer_t *tm = timer_heap[i];
+    while (1) {
+        u32_t child = 2 * i + 1;
+        if (child >= heap_len) {
+            break;
+        }
+        if (child + 1 < heap_len &&
+            timer_before(timer_heap[child + 1], timer_heap[child])) {
+            child++;
+        }
+        if (!timer_before(timer_heap[child], tm)) {
+            break;
+        }
+        heap_set(i, timer_heap[child]);
+        i = child;
+    }
+    heap_set(i, tm);
+}
+
+static bool heap_insert(zjs_timer_t *tm)
+{
+    if (heap_len >= heap_size) {
+        u32_t size = heap_size ? heap_size * 2 : INITIAL_TIMER_HEAP_SIZE;
+        zjs_timer_t **heap = zjs_malloc(sizeof(zjs_timer_t *) * size);
+        if (!heap) {
+            return false;
+        }
+        if (timer_heap) {
+            memcpy(heap, timer_heap, sizeof(zjs_timer_t *) * heap_len);
+            zjs_free(timer_heap);
+        }
+        timer_heap = heap;
+        heap_size = size;
+    }
+    heap_set(heap_len++, tm);
+    heap_sift_up(tm->index);
+    return true;
+}
 
-static const jerry_object_native_info_t timer_type_info = {
-    .free_cb = free_handle_nop
-};
+static void heap_remove(zjs_timer_t *tm)
+{
+    // requires: tm is in the heap
+    u32_t i = tm->index;
+    zjs_timer_t *last = timer_heap[--heap_len];
+    tm->index = TIMER_DELETED;
+    if (last != tm) {
+        heap_set(i, last);
+        if (i > 0 && timer_before(last, timer_heap[(i - 1) / 2])) {
+            heap_sift_up(i);
+        } else {
+            heap_sift_down(i);
+        }
+    }
+}
 
+static u64_t timers_now(void)
+{
 #ifdef ZJS_LINUX_BUILD
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#else
+    return (u64_t)k_uptime_get();
+#endif
+}
+
+static u64_t align_deadline(u64_t due, u32_t slack)
+{
+    // returns: the time in [due, due + slack] with the most trailing zero
+    //            bits; timers whose windows overlap tend to pick the same
+    //            time, and so expire together
+    if (!slack) {
+        return due;
+    }
+    u64_t latest = due + slack;
+    int bit = 63 - __builtin_clzll(due ^ latest);
+    return latest & ~(((u64_t)1 << bit) - 1);
+}
+
+#ifdef ZJS_LINUX_BUILD
+
 // FIXME - reverted patch #1542 to old timer implementation
 jerry_value_t *pre_timer(void *h, u32_t *argc)
 {
-    zjs_timer_t *handle = (zjs_timer_t *)h;
+    zjs_timer_t *handle = find_timer((uintptr_t)h);
+    if (!handle) {
+        *argc = 0;
+        return NULL;
+    }
     *argc = handle->argc;
     return handle->argv;
 }
@@ -53,28 +330,56 @@ static bool delete_timer(zjs_timer_t *tm);
 
 static void post_timer(void *handle, jerry_value_t ret_val)
 {
-    zjs_timer_t *timer = (zjs_timer_t *)handle;
+    // the callback may have cleared its own timer, so look it up again
+    zjs_timer_t *timer = find_timer((uintptr_t)handle);
 
-    if (!timer->repeat) {
+    if (timer && !timer->repeat) {
+        timer->completed = true;
         delete_timer(timer);
     }
 }
 
+static void start_timer(zjs_timer_t *tm)
+{
+    // effects: starts the kernel timer for tm->due plus slack; a timer with
+    //            slack runs one period at a time, so each expiry is aligned
+    u64_t now = timers_now();
+    if (tm->due < now) {
+        tm->due = now;
+    }
+    u64_t at = align_deadline(tm->due, tm->slack);
+    k_timer_start(&tm->timer, (s32_t)(at - now),
+                  tm->slack ? 0 : tm->interval);
+}
+
 static void timer_callback(zjs_port_timer_t *handle)
 {
+    static u32_t last_wakeup = 0;
     zjs_timer_t *timer = (zjs_timer_t *)handle->user_data;
 
+    // timers expiring in the same tick share one interrupt
+    u32_t now = zjs_port_timer_get_uptime();
+    timers_fired++;
+    if (now != last_wakeup || timer_wakeups == 0) {
+        last_wakeup = now;
+        timer_wakeups++;
+    }
+
     zjs_signal_callback(timer->callback_id, timer->argv,
                         sizeof(jerry_value_t) * timer->argc);
 
     if (!timer->repeat) {
         zjs_port_timer_stop(handle);
+    } else if (timer->slack) {
+        // keep to the original schedule, so slack doesn't add up
+        timer->due += timer->interval;
+        start_timer(timer);
     }
 }
 #endif
 
 /*
- * Allocate a new timer and add it to list
+ * Allocate a new timer and add it to the heap
  *
  * interval     Time until expiration (in ticks)
  * callback     JS callback function
@@ -96,21 +401,33 @@ static zjs_timer_t *add_timer(u32_t interval,
     }
 
 #ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    zjs_port_timer_init(&tm->timer, NULL);
+    // a repeating zero interval would expire forever in one pass
+    if (repeat && interval == 0) {
+        interval = 1;
+    }
+#endif
     tm->interval = interval;
-    tm->completed = false;
+    tm->slack = default_slack;
+    tm->due = timers_now() + interval;
+#ifdef ZJS_LINUX_BUILD
+    tm->expires = align_deadline(tm->due, tm->slack);
 #else
     zjs_port_timer_init(&tm->timer, timer_callback);
     tm->timer.user_data = tm;
 #endif
     tm->repeat = repeat;
-    tm->next = NULL;
+    tm->completed = false;
+    tm->index = TIMER_DELETED;
     tm->argc = argc;
+    if (!slot_alloc(tm)) {
+        zjs_free(tm);
+        ERR_PRINT("out of timer handles\n");
+        return NULL;
+    }
     if (tm->argc) {
         tm->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
         if (!tm->argv) {
-            zjs_free(tm);
+            free_timer(tm);
             ERR_PRINT("out of memory allocating timer args\n");
             return NULL;
         }
@@ -121,55 +438,73 @@ static zjs_timer_t *add_timer(u32_t interval,
         tm->argv = NULL;
     }
 
+    if (!heap_insert(tm)) {
+        for (int i = 0; i < tm->argc; ++i) {
+            jerry_release_value(tm->argv[i]);
+        }
+        zjs_free(tm->argv);
+        free_timer(tm);
+        ERR_PRINT("out of memory growing timer heap\n");
+        return NULL;
+    }
+
+    // the callback gets the handle rather than tm, which may be freed first
+    void *handle = (void *)(uintptr_t)timer_handle(tm);
     if (tm->repeat) {
-        tm->callback_id = zjs_add_callback(callback, this, tm, NULL);
+        tm->callback_id = zjs_add_callback(callback, this, handle, NULL);
     } else {
-        tm->callback_id = zjs_add_callback_once(callback, this, tm, post_timer);
+        tm->callback_id = zjs_add_callback_once(callback, this, handle,
+                                                post_timer);
     }
 
-    ZJS_LIST_APPEND(zjs_timer_t, zjs_timers, tm);
-
     DBG_PRINT("add timer, id=%d, interval=%u, repeat=%u, argv=%p, argc=%u\n",
               tm->callback_id, interval, repeat, argv, argc);
 #ifdef ZJS_LINUX_BUILD
-    // FIXME - reverted patch #1542 to old timer implementation
-    zjs_port_timer_start(&tm->timer, interval, 0);
+    // make sure the main loop recalculates its sleep time
+    zjs_loop_unblock();
 #else
-    zjs_port_timer_start(&tm->timer, repeat ? interval : 0, interval);
+    start_timer(tm);
 #endif
     return tm;
 }
 
 /*
- * Remove a timer from the list
+ * Remove a timer from the heap
  *
- * id           ID of timer, returned from add_timer
+ * tm           Timer returned from add_timer
  *
- * returns      True if the timer was removed successfully (if the ID is valid)
+ * returns      True if the timer was removed successfully (if it was active)
  */
 static bool delete_timer(zjs_timer_t *tm)
 {
+    // NOTE: tm is freed unless it's an expired timer kept for the next pass
     if (tm) {
-        // If the timer isn't in the list, its already been deleted
-        if (zjs_timers == NULL ||
-            !ZJS_LIST_REMOVE(zjs_timer_t, zjs_timers, tm)) {
+        // If the timer isn't in the heap, its already been deleted
+        if (tm->index < 0) {
             return false;
         }
+        heap_remove(tm);
+        // NOTE: an expired timer keeps its args until the next pass
+#ifdef ZJS_LINUX_BUILD
+        if (tm->completed) {
+            tm->index = TIMER_EXPIRED;
+            tm->next = expired_timers;
+            expired_timers = tm;
+            return true;
+        }
+#endif
+#ifndef ZJS_LINUX_BUILD
         zjs_port_timer_stop(&tm->timer);
+#endif
         for (int i = 0; i < tm->argc; ++i) {
             jerry_release_value(tm->argv[i]);
         }
         // remove callbacks except for expired once timers
-#ifdef ZJS_LINUX_BUILD
-        // FIXME - reverted patch #1542 to old timer implementation
         if (tm->repeat || !tm->completed) {
-#else
-        if (tm->repeat) {
-#endif
             zjs_remove_callback(tm->callback_id);
         }
         zjs_free(tm->argv);
-        zjs_free(tm);
+        free_timer(tm);
         return true;
     }
     return false;
@@ -182,7 +517,6 @@ static ZJS_DECL_FUNC_ARGS(add_timer_helper, bool repeat)
 
     u32_t interval = (u32_t)(jerry_get_number_value(argv[1]));
     jerry_value_t callback = argv[0];
-    jerry_value_t timer_obj = zjs_create_object();
 
 #ifdef ZJS_FIND_FUNC_NAME
     if (repeat) {
@@ -195,11 +529,14 @@ static ZJS_DECL_FUNC_ARGS(add_timer_helper, bool repeat)
 #endif
     zjs_timer_t *handle = add_timer(interval, callback, this, repeat,
                                     argc - 2, argv);
-    if (handle->callback_id == -1)
+    if (!handle) {
         return zjs_error("timer alloc failed");
-    jerry_set_object_native_pointer(timer_obj, handle, &timer_type_info);
-
-    return timer_obj;
+    }
+    if (handle->callback_id == -1) {
+        delete_timer(handle);
+        return zjs_error("timer alloc failed");
+    }
+    return jerry_create_number(timer_handle(handle));
 }
 
 // native setInterval handler
@@ -217,11 +554,15 @@ static ZJS_DECL_FUNC(native_set_timeout_handler)
 // native clearInterval handler
 static ZJS_DECL_FUNC(native_clear_interval_handler)
 {
-    // args: timer object
-    // FIXME: timers should be ints, not objects!
-    ZJS_VALIDATE_ARGS(Z_OBJECT);
-
-    ZJS_GET_HANDLE_OR_NULL(argv[0], zjs_timer_t, handle, timer_type_info);
+    // args: timer handle
+    ZJS_VALIDATE_ARGS(Z_NUMBER Z_OBJECT);
+
+    // timers used to be objects, so take anything that converts to a handle
+    ZVAL num = jerry_value_to_number(argv[0]);
+    zjs_timer_t *handle = NULL;
+    if (jerry_value_is_number(num)) {
+        handle = find_timer_number(jerry_get_number_value(num));
+    }
 
     if (!delete_timer(handle))
         DBG_PRINT("timer not found\n");
@@ -229,39 +570,294 @@ static ZJS_DECL_FUNC(native_clear_interval_handler)
     return ZJS_UNDEFINED;
 }
 
+static u32_t slack_number(double value)
+{
+    // returns: value as a slack in ms, with NaN and negatives taken as 0,
+    //   and capped so a deadline still fits the kernel's s32_t delay
+    if (!(value > 0)) {
+        return 0;
+    }
+    return value < 0x7fffffff ? (u32_t)value : 0x7fffffff;
+}
+
+static ZJS_DECL_FUNC(native_set_timer_slack_handler)
+{
+    // args: timer handle, slack in milliseconds
+    ZJS_VALIDATE_ARGS(Z_NUMBER, Z_NUMBER);
+
+    zjs_timer_t *tm = find_timer_number(jerry_get_number_value(argv[0]));
+    if (!tm || tm->index < 0) {
+        DBG_PRINT("timer not found\n");
+        return ZJS_UNDEFINED;
+    }
+    tm->slack = slack_number(jerry_get_number_value(argv[1]));
+
+    // reschedule now, rather than after the next expiry
 #ifdef ZJS_LINUX_BUILD
-// FIXME - reverted patch #1542 to old timer implementation
+    tm->expires = align_deadline(tm->due, tm->slack);
+    heap_sift_up(tm->index);
+    heap_sift_down(tm->index);
+    zjs_loop_unblock();
+#else
+    // the kernel only knows the current expiry, which may already include
+    //   the old slack
+    tm->due = timers_now() + k_timer_remaining_get(&tm->timer);
+    start_timer(tm);
+#endif
+    return ZJS_UNDEFINED;
+}
+
+static ZJS_DECL_FUNC(native_set_default_slack_handler)
+{
+    // args: slack in milliseconds
+    ZJS_VALIDATE_ARGS(Z_NUMBER);
+
+    default_slack = slack_number(jerry_get_number_value(argv[0]));
+    return ZJS_UNDEFINED;
+}
+
+static ZJS_DECL_FUNC(native_get_default_slack_handler)
+{
+    return jerry_create_number(default_slack);
+}
+
+static ZJS_DECL_FUNC(native_get_timer_stats_handler)
+{
+    jerry_value_t stats = zjs_create_object();
+    zjs_obj_add_number(stats, "fired", timers_fired);
+    zjs_obj_add_number(stats, "wakeups", timer_wakeups);
+    return stats;
+}
+
+static bool queue_grow(call_queue_t *q, u32_t needed)
+{
+    // effects: moves the queue to a buffer with room for needed more words
+    u32_t used = q->tail - q->head;
+    u32_t size = q->buf ? (q->mask + 1) * 2 : INITIAL_CALL_QUEUE_SIZE;
+    while (size - used < needed) {
+        size *= 2;
+    }
+    jerry_value_t *buf = zjs_malloc(sizeof(jerry_value_t) * size);
+    if (!buf) {
+        return false;
+    }
+    for (u32_t i = 0; i < used; i++) {
+        buf[i] = q->buf[(q->head + i) & q->mask];
+    }
+    zjs_free(q->buf);
+    q->buf = buf;
+    q->mask = size - 1;
+    q->head = 0;
+    q->tail = used;
+    return true;
+}
+
+static bool queue_push(call_queue_t *q, u32_t id, jerry_value_t func,
+                       u32_t argc, const jerry_value_t argv[])
+{
+    // effects: queues a call to func with argv, acquiring the values
+    u32_t needed = CALL_HEADER + argc;
+    if (!q->buf || q->mask + 1 - (q->tail - q->head) < needed) {
+        if (!queue_grow(q, needed)) {
+            return false;
+        }
+    }
+    q->buf[q->tail++ & q->mask] = id;
+    q->buf[q->tail++ & q->mask] = argc;
+    q->buf[q->tail++ & q->mask] = jerry_acquire_value(func);
+    for (u32_t i = 0; i < argc; i++) {
+        q->buf[q->tail++ & q->mask] = jerry_acquire_value(argv[i]);
+    }
+    q->count++;
+    return true;
+}
+
+static void queue_call_next(call_queue_t *q)
+{
+    // requires: q is not empty
+    //  effects: removes the oldest call and makes it, unless it was cleared
+    // copy the call out first, since it may queue more calls and move buf
+    u32_t argc = q->buf[(q->head + 1) & q->mask];
+    jerry_value_t func = q->buf[(q->head + 2) & q->mask];
+    jerry_value_t argv[argc];
+    for (u32_t i = 0; i < argc; i++) {
+        argv[i] = q->buf[(q->head + CALL_HEADER + i) & q->mask];
+    }
+    q->head += CALL_HEADER + argc;
+    q->count--;
+
+    if (!jerry_value_is_undefined(func)) {
+        ZVAL rval = jerry_call_function(func, ZJS_UNDEFINED, argv, argc);
+        if (jerry_value_is_error(rval)) {
+            zjs_print_error_message(rval, func);
+        }
+    }
+    jerry_release_value(func);
+    for (u32_t i = 0; i < argc; i++) {
+        jerry_release_value(argv[i]);
+    }
+}
+
+static bool queue_clear(call_queue_t *q, u32_t id)
+{
+    // effects: cancels the queued call with id; it stays in the queue but
+    //            only releases its args when its turn comes
+    u32_t pos = q->head;
+    for (u32_t i = 0; i < q->count; i++) {
+        u32_t argc = q->buf[(pos + 1) & q->mask];
+        if (q->buf[pos & q->mask] == id) {
+            jerry_value_t *func = &q->buf[(pos + 2) & q->mask];
+            jerry_release_value(*func);
+            *func = ZJS_UNDEFINED;
+            return true;
+        }
+        pos += CALL_HEADER + argc;
+    }
+    return false;
+}
+
+static void queue_free(call_queue_t *q)
+{
+    u32_t pos = q->head;
+    for (u32_t i = 0; i < q->count; i++) {
+        u32_t argc = q->buf[(pos + 1) & q->mask];
+        for (u32_t j = 2; j < CALL_HEADER + argc; j++) {
+            jerry_release_value(q->buf[(pos + j) & q->mask]);
+        }
+        pos += CALL_HEADER + argc;
+    }
+    zjs_free(q->buf);
+    memset(q, 0, sizeof(call_queue_t));
+}
+
+static ZJS_DECL_FUNC(native_set_immediate_handler)
+{
+    // args: callback[, pass-through args]
+    ZJS_VALIDATE_ARGS(Z_FUNCTION);
+
+    u32_t id = next_immediate_id++;
+    if (!next_immediate_id) {
+        // zero is never a valid ID
+        next_immediate_id = 1;
+    }
+    if (!queue_push(&immediates, id, argv[0], argc - 1, argv + 1)) {
+        return zjs_error("immediate alloc failed");
+    }
+    return jerry_create_number(id);
+}
+
+static ZJS_DECL_FUNC(native_clear_immediate_handler)
+{
+    // args: immediate ID
+    ZJS_VALIDATE_ARGS(Z_OPTIONAL Z_NUMBER);
+
+    if (argc < 1 ||
+        !queue_clear(&immediates, (u32_t)jerry_get_number_value(argv[0]))) {
+        DBG_PRINT("immediate not found\n");
+    }
+    return ZJS_UNDEFINED;
+}
+
+static ZJS_DECL_FUNC(native_next_tick_handler)
+{
+    // args: callback[, pass-through args]
+    ZJS_VALIDATE_ARGS(Z_FUNCTION);
+
+    if (!queue_push(&ticks, 0, argv[0], argc - 1, argv + 1)) {
+        return zjs_error("tick alloc failed");
+    }
+    return ZJS_UNDEFINED;
+}
+
+u8_t zjs_timers_process_immediates()
+{
+    // immediates queued from these calls wait for the next pass
+    u32_t count = immediates.count;
+    for (u32_t i = 0; i < count; i++) {
+        queue_call_next(&immediates);
+    }
+    return count ? 1 : 0;
+}
+
+u8_t zjs_timers_calls_pending()
+{
+    return (immediates.count || ticks.count) ? 1 : 0;
+}
+
+u8_t zjs_timers_process_ticks()
+{
+    // ticks queued from these calls run too, before anything else
+    u8_t serviced = 0;
+    while (ticks.count) {
+        queue_call_next(&ticks);
+        serviced = 1;
+    }
+    return serviced;
+}
+
+#ifdef ZJS_LINUX_BUILD
+static void free_expired_timers()
+{
+    // effects: release one-shot timers signaled on an earlier pass, whose
+    //            callbacks have run by now
+    while (expired_timers) {
+        zjs_timer_t *tm = expired_timers;
+        expired_timers = tm->next;
+        for (int i = 0; i < tm->argc; ++i) {
+            jerry_release_value(tm->argv[i]);
+        }
+        zjs_free(tm->argv);
+        free_timer(tm);
+    }
+}
+
 s32_t zjs_timers_process_events()
 {
-    s32_t wait = ZJS_TICKS_FOREVER;
-    for (zjs_timer_t *tm = zjs_timers; tm; tm = tm->next) {
-        if (tm->completed) {
-            delete_timer(tm);
-        } else if (zjs_port_timer_test(&tm->timer) > 0) {
-            // timer has expired, signal the callback
-            DBG_PRINT("signaling timer. id=%d, argv=%p, argc=%u\n",
-                      tm->callback_id, tm->argv, tm->argc);
-            zjs_signal_callback(tm->callback_id, tm->argv,
-                                tm->argc * sizeof(jerry_value_t));
-
-            // reschedule or remove timer
-            if (tm->repeat) {
-                zjs_port_timer_start(&tm->timer, tm->interval, 0);
-            } else {
-                // delete this timer next time around
-                tm->completed = true;
+    free_expired_timers();
+
+    // read the clock once per pass; anything due by now fires
+    u64_t now = timers_now();
+    u32_t fired = 0;
+    while (heap_len && timer_heap[0]->expires <= now) {
+        zjs_timer_t *tm = timer_heap[0];
+
+        // timer has expired, signal the callback
+        DBG_PRINT("signaling timer. id=%d, argv=%p, argc=%u\n",
+                  tm->callback_id, tm->argv, tm->argc);
+        zjs_signal_callback(tm->callback_id, tm->argv,
+                            tm->argc * sizeof(jerry_value_t));
+
+        fired++;
+
+        // reschedule or remove timer
+        if (tm->repeat) {
+            // keep to the original schedule, so slack doesn't add up, but
+            //   skip periods that were missed entirely
+            tm->due += tm->interval;
+            if (tm->due <= now) {
+                tm->due = now + tm->interval;
             }
+            tm->expires = align_deadline(tm->due, tm->slack);
+            heap_sift_down(0);
+        } else {
+            // the once callback removes itself after it is called, and the
+            //   args are released on the next pass
+            tm->completed = true;
+            delete_timer(tm);
         }
-
-        /*
-         * On Linux, we don't block on a semaphore; we just need to return if
-         * there were any timers serviced. If there was any timers in the list
-         * then we signal.
-         */
-        wait = 1;
+    }
+    if (fired) {
+        timers_fired += fired;
+        timer_wakeups++;
     }
 
-    return !(wait == ZJS_TICKS_FOREVER);
+    // the main loop may sleep until the soonest pending deadline
+    if (!heap_len) {
+        return ZJS_TICKS_FOREVER;
+    }
+    // deadlines over 24 days away would overflow the wait time
+    u64_t wait = timer_heap[0]->expires - now;
+    return wait > 0x7fffffff ? 0x7fffffff : (s32_t)wait;
 }
 #endif
 
@@ -280,20 +876,42 @@ void zjs_timers_init()
     // create the C handler for clearTimeout JS call (same as clearInterval)
     zjs_obj_add_function(global_obj, "clearTimeout",
                          native_clear_interval_handler);
-}
-
-static void free_timer(zjs_timer_t *tm)
-{
-    for (int i = 0; i < tm->argc; ++i) {
-        jerry_release_value(tm->argv[i]);
+    zjs_obj_add_function(global_obj, "setImmediate",
+                         native_set_immediate_handler);
+    zjs_obj_add_function(global_obj, "clearImmediate",
+                         native_clear_immediate_handler);
+    zjs_obj_add_function(global_obj, "setTimerSlack",
+                         native_set_timer_slack_handler);
+
+    ZVAL process = zjs_get_property(global_obj, "process");
+    if (jerry_value_is_object(process)) {
+        zjs_obj_add_function(process, "nextTick", native_next_tick_handler);
+        zjs_obj_add_function(process, "setTimerSlack",
+                             native_set_default_slack_handler);
+        zjs_obj_add_function(process, "getTimerSlack",
+                             native_get_default_slack_handler);
+        zjs_obj_add_function(process, "getTimerStats",
+                             native_get_timer_stats_handler);
     }
-    zjs_port_timer_stop(&tm->timer);
-    zjs_remove_callback(tm->callback_id);
-    zjs_free(tm->argv);
-    zjs_free(tm);
 }
 
 void zjs_timers_cleanup()
 {
-    ZJS_LIST_FREE(zjs_timer_t, zjs_timers, free_timer);
+    // delete from the end so no reordering is needed
+    while (heap_len) {
+        delete_timer(timer_heap[heap_len - 1]);
+    }
+#ifdef ZJS_LINUX_BUILD
+    free_expired_timers();
+#endif
+    queue_free(&immediates);
+    queue_free(&ticks);
+    zjs_free(timer_heap);
+    timer_heap = NULL;
+    heap_size = 0;
+    zjs_free(timer_slots);
+    timer_slots = NULL;
+    slots_size = 0;
+    free_head = -1;
+    free_tail = -1;
 }
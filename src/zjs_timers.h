@@ -12,6 +12,28 @@
  */
 s32_t zjs_timers_process_events();
 void zjs_timers_init();
+
+/**
+ * Run the calls queued with setImmediate() before this pass; calls they
+ * queue wait for the next pass
+ *
+ * @return          1 if any calls ran, 0 otherwise
+ */
+u8_t zjs_timers_process_immediates();
+
+/**
+ * Check whether setImmediate() or process.nextTick() calls are waiting
+ *
+ * @return          1 if any are waiting, so the main loop shouldn't sleep
+ */
+u8_t zjs_timers_calls_pending();
+
+/**
+ * Run the calls queued with process.nextTick(), including any they queue
+ *
+ * @return          1 if any calls ran, 0 otherwise
+ */
+u8_t zjs_timers_process_ticks();
 // Stops and frees all timers
 void zjs_timers_cleanup();
 
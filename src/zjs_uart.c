@@ -96,24 +96,38 @@ static uart_handle *new_uart_handle(void)
     return h;
 }
 
-static void uart_c_callback(void *h, const void *args)
+static bool emit_read(const void *data, u32_t len)
 {
+    // returns: true if the data was long enough to be emitted
     if (!handle) {
         DBG_PRINT("UART handle not found\n");
-        return;
+        return false;
     }
-    if (handle->size >= handle->min) {
-        zjs_buffer_t *buffer;
-        ZVAL buf = zjs_buffer_create(handle->size, &buffer);
-        if (buffer) {
-            memcpy(buffer->buffer, args, handle->size);
-        }
-        zjs_emit_event(handle->uart_obj, "read", &buf, 1);
+    if (len < handle->min) {
+        return false;
+    }
+    zjs_buffer_t *buffer;
+    ZVAL buf = zjs_buffer_create(len, &buffer);
+    if (buffer) {
+        memcpy(buffer->buffer, data, len);
+    }
+    zjs_emit_event(handle->uart_obj, "read", &buf, 1);
+    return true;
+}
 
+static void uart_c_callback(void *h, const void *args)
+{
+    if (emit_read(args, handle ? handle->size : 0)) {
         handle->size = 0;
     }
 }
 
+// a zjs_deferred_work callback
+static void uart_read_block(const void *buffer, u32_t length)
+{
+    emit_read(buffer, length);
+}
+
 static void uart_irq_handler(struct device *dev)
 {
     uart_irq_update(dev);
@@ -127,8 +141,18 @@ static void uart_irq_handler(struct device *dev)
     }
 
     if (uart_irq_rx_ready(dev)) {
-        u32_t len = uart_fifo_read(dev, handle->buf, handle->max);
         rx = true;
+        // read straight into a message block, so only its handle is queued
+        zjs_msgblock_t *block = zjs_msgblock_alloc(handle->max);
+        if (block) {
+            u32_t len = uart_fifo_read(dev, zjs_msgblock_data(block),
+                                       handle->max);
+            zjs_msgblock_set_size(block, len);
+            zjs_defer_block(uart_read_block, block);
+            return;
+        }
+        // no blocks free, fall back to copying through the callback queue
+        u32_t len = uart_fifo_read(dev, handle->buf, handle->max);
         handle->buf[len] = '\0';
         handle->size = len;
         zjs_signal_callback(read_id, handle->buf, len);
@@ -1,6 +1,8 @@
 // Copyright (c) 2016-2017, Intel Corporation.
 
 // C includes
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,8 +10,14 @@
 // ZJS includes
 #include "zjs_board.h"
 #include "zjs_callbacks.h"
+#include "zjs_loop_stats.h"
+#include "zjs_mpsc_queue.h"
+#include "zjs_msgblock.h"
 #include "zjs_util.h"
 
+// JerryScript includes
+#include "jerryscript.h"
+
 static int passed = 0;
 static int total = 0;
 
@@ -67,9 +75,30 @@ static void c_callback4(void *handle, const void *args)
     cb4_called = 1;
 }
 
-static void test_c_callbacks()
+static char lane_order[4];
+static int lane_calls = 0;
+static void c_callback_lane(void *handle, const void *args)
+{
+    if (lane_calls < sizeof(lane_order)) {
+        lane_order[lane_calls++] = *(char *)handle;
+    }
+}
+
+static void reset_callbacks(void)
 {
+    // effects: removes and frees every callback, then sets the callback
+    //            system up again, so a test starts with empty lanes and
+    //            cleared stats without registering the deferred work
+    //            callbacks a second time
+    zjs_remove_all_callbacks();
+    while (zjs_service_callbacks()) {
+    }
     zjs_init_callbacks();
+}
+
+static void test_c_callbacks()
+{
+    reset_callbacks();
     // test multiple signals
     zjs_callback_id id1 = zjs_add_c_callback(NULL, c_callback1);
     for (int i = 0; i < 10; i++) {
@@ -96,7 +125,7 @@ static void test_c_callbacks()
     zjs_assert(handle_and_args, "handle and args passed correctly");
     zjs_remove_callback(id3);
 
-    // test callback ID recycling
+    // test callback slot recycling
     zjs_callback_id list[10];
     for (int i = 0; i < 10; i++) {
         list[i] = zjs_add_c_callback(NULL, c_callback4);
@@ -106,10 +135,102 @@ static void test_c_callbacks()
         zjs_remove_callback(list[i]);
     }
     zjs_service_callbacks();
-    zjs_callback_id less = zjs_add_c_callback(NULL, c_callback4);
-    zjs_assert(less < next, "callback IDs are recycled");
+    zjs_callback_id more[10];
+    bool recycled = false, new_ids = true;
+    for (int i = 0; i < 10; i++) {
+        more[i] = zjs_add_c_callback(NULL, c_callback4);
+        for (int j = 0; j < 10; j++) {
+            if (zjs_callback_index(more[i]) == zjs_callback_index(list[j])) {
+                recycled = true;
+                new_ids = new_ids && more[i] != list[j];
+            }
+        }
+    }
+    zjs_assert(recycled, "callback slots are recycled");
+    zjs_assert(new_ids, "recycled callback slots get new IDs");
     zjs_remove_callback(next);
-    zjs_remove_callback(less);
+    for (int i = 0; i < 10; i++) {
+        zjs_remove_callback(more[i]);
+    }
+    zjs_service_callbacks();
+
+    // test stale IDs are rejected after their slot is reused
+    count1 = 0;
+    zjs_callback_id stale = zjs_add_c_callback(NULL, c_callback1);
+    zjs_remove_callback(stale);
+    zjs_service_callbacks();
+    zjs_callback_id fresh = -1;
+    for (int i = 0; i < 64 && fresh == -1; i++) {
+        zjs_callback_id id = zjs_add_c_callback(NULL, c_callback1);
+        if (zjs_callback_index(id) == zjs_callback_index(stale)) {
+            fresh = id;
+        } else {
+            zjs_remove_callback(id);
+            zjs_service_callbacks();
+        }
+    }
+    zjs_signal_callback(stale, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(fresh != -1 && count1 == 0, "signal to stale ID is ignored");
+    zjs_remove_callback(fresh);
+
+    // test a slot's IDs don't repeat after 256 reuses
+    zjs_callback_id first = zjs_add_c_callback(NULL, c_callback1);
+    zjs_remove_callback(first);
+    zjs_service_callbacks();
+    int reuses = 0;
+    bool repeated = false;
+    for (u32_t i = 0; i < 4000000 && reuses < 300; i++) {
+        zjs_callback_id id = zjs_add_c_callback(NULL, c_callback1);
+        if (zjs_callback_index(id) == zjs_callback_index(first)) {
+            reuses++;
+            repeated = repeated || id == first;
+        }
+        zjs_remove_callback(id);
+        zjs_service_callbacks();
+    }
+    zjs_assert(reuses == 300 && !repeated,
+               "callback IDs don't repeat after 256 reuses of a slot");
+
+    // test thousands of callbacks can exist at once, e.g. for timers
+    static zjs_callback_id many[4000];
+    bool all_added = true;
+    for (int i = 0; i < 4000; i++) {
+        many[i] = zjs_add_c_callback(NULL, c_callback1);
+        all_added = all_added && many[i] >= 0;
+    }
+    zjs_assert(all_added, "4000 callbacks at once");
+    for (int i = 0; i < 4000; i++) {
+        zjs_remove_callback(many[i]);
+    }
+    while (zjs_service_callbacks()) {
+    }
+
+    // test the hardware lane is serviced before the JS lane
+    zjs_service_callbacks();
+    char js_name = 'j', hw_name = 'h';
+    zjs_callback_id js_id = zjs_add_c_callback(&js_name, c_callback_lane);
+    zjs_callback_id hw_id = zjs_add_c_callback(&hw_name, c_callback_lane);
+    zjs_set_callback_lane(js_id, ZJS_CB_LANE_JS);
+    zjs_signal_callback(js_id, NULL, 0);
+    zjs_signal_callback(js_id, NULL, 0);
+    zjs_signal_callback(hw_id, NULL, 0);
+    zjs_assert(zjs_get_callback_lane_depth(ZJS_CB_LANE_JS) == 2 &&
+               zjs_get_callback_lane_depth(ZJS_CB_LANE_HW) == 1,
+               "lane depths counted");
+    u32_t budget = zjs_get_callback_budget();
+    zjs_set_callback_budget(0);
+    zjs_service_callbacks();
+    zjs_assert(lane_calls == 2 && lane_order[0] == 'h' && lane_order[1] == 'j',
+               "hardware lane first, one per lane with zero budget");
+    zjs_assert(zjs_callbacks_pending(), "leftover signal reported pending");
+    zjs_set_callback_budget(budget);
+    zjs_service_callbacks();
+    zjs_assert(lane_calls == 3 &&
+               zjs_get_callback_lane_depth(ZJS_CB_LANE_JS) == 0 &&
+               !zjs_callbacks_pending(), "lanes drained");
+    zjs_remove_callback(js_id);
+    zjs_remove_callback(hw_id);
 
     // test zjs_call_callback
     zjs_callback_id id4 = zjs_add_c_callback(NULL, c_callback4);
@@ -118,6 +239,252 @@ static void test_c_callbacks()
     zjs_remove_callback(id4);
 }
 
+// Measure the JerryScript heap used by each live timer
+
+#define MEM_VALUES 1000
+
+static const jerry_object_native_info_t mem_object_info = { NULL };
+static jerry_value_t mem_callback = 0;
+
+static ZJS_DECL_FUNC(mem_noop)
+{
+    return ZJS_UNDEFINED;
+}
+
+static jerry_value_t make_number(u32_t i)
+{
+    return jerry_create_number(i);
+}
+
+static jerry_value_t make_object(u32_t i)
+{
+    // an object with a native pointer, which is what each timer used to be
+    static int native;
+    jerry_value_t obj = zjs_create_object();
+    jerry_set_object_native_pointer(obj, &native, &mem_object_info);
+    return obj;
+}
+
+static jerry_value_t make_timer(u32_t i)
+{
+    ZVAL global = jerry_get_global_object();
+    ZVAL set_timeout = zjs_get_property(global, "setTimeout");
+    jerry_value_t args[] = { mem_callback, jerry_create_number(1000000) };
+    return jerry_call_function(set_timeout, ZJS_UNDEFINED, args, 2);
+}
+
+static void clear_timer(jerry_value_t handle)
+{
+    ZVAL global = jerry_get_global_object();
+    ZVAL clear_timeout = zjs_get_property(global, "clearTimeout");
+    ZVAL rval = jerry_call_function(clear_timeout, ZJS_UNDEFINED, &handle, 1);
+}
+
+static u32_t heap_in_use()
+{
+    jerry_heap_stats_t stats;
+    jerry_gc();
+    jerry_get_memory_stats(&stats);
+    return stats.allocated_bytes;
+}
+
+static s32_t heap_per_value(jerry_value_t (*make)(u32_t),
+                            void (*clear)(jerry_value_t))
+{
+    // effects: holds MEM_VALUES values from make in an array, then clears
+    //            and releases them
+    //  returns: heap bytes in use per value, including its array element
+    u32_t before = heap_in_use();
+    jerry_value_t array = jerry_create_array(MEM_VALUES);
+    for (u32_t i = 0; i < MEM_VALUES; i++) {
+        ZVAL value = make(i);
+        ZVAL rval = jerry_set_property_by_index(array, i, value);
+    }
+    u32_t after = heap_in_use();
+    for (u32_t i = 0; clear && i < MEM_VALUES; i++) {
+        ZVAL value = jerry_get_property_by_index(array, i);
+        clear(value);
+    }
+    jerry_release_value(array);
+    return ((s32_t)after - (s32_t)before) / MEM_VALUES;
+}
+
+static void test_timer_memory()
+{
+    if (!jerry_is_feature_enabled(JERRY_FEATURE_MEM_STATS)) {
+        printf("SKIP - timer heap use, build with MEM_STATS=on to measure\n");
+        return;
+    }
+    mem_callback = jerry_create_external_function(mem_noop);
+
+    // array elements cost the same whatever they hold, so subtract them
+    s32_t element = heap_per_value(make_number, NULL);
+    s32_t object = heap_per_value(make_object, NULL) - element;
+    s32_t timer = heap_per_value(make_timer, clear_timer) - element;
+    printf("heap bytes per timer: %d, per timer object before: %d\n", timer,
+           object);
+    zjs_assert(timer <= 0, "timers use no heap beyond their callback");
+    zjs_assert(timer < object, "timer handles use less heap than objects");
+
+    jerry_release_value(mem_callback);
+    while (zjs_service_callbacks()) {
+    }
+}
+
+// Test callback queue growth and overflow policies
+
+#define SEQ_MAX 4096
+static u32_t seq_seen[SEQ_MAX];
+static int seq_count = 0;
+static void c_callback_seq(void *handle, const void *args)
+{
+    if (seq_count < SEQ_MAX) {
+        seq_seen[seq_count++] = ((const u32_t *)args)[0];
+    }
+}
+
+static int overflow_reports = 0;
+static void overflow_report(void)
+{
+    overflow_reports++;
+}
+
+static u32_t fill_lane(zjs_callback_id id, u32_t *args, u32_t size,
+                       u32_t first)
+{
+    // effects: signals id with increasing sequence numbers until a signal is
+    //            lost or merged because the lane is full
+    //  returns: the next sequence number
+    zjs_callback_queue_stats_t stats;
+    zjs_get_callback_queue_stats(&stats);
+    u32_t before = stats.dropped + stats.coalesced;
+    u32_t seq = first;
+    do {
+        args[0] = seq++;
+        zjs_signal_callback(id, args, size);
+        zjs_get_callback_queue_stats(&stats);
+    } while (stats.dropped + stats.coalesced == before &&
+             seq - first < SEQ_MAX);
+    return seq;
+}
+
+static void drain_lanes(void)
+{
+    seq_count = 0;
+    while (zjs_service_callbacks()) {
+    }
+}
+
+static void test_callback_overflow()
+{
+    reset_callbacks();
+    zjs_callback_queue_stats_t stats;
+    zjs_get_callback_queue_stats(&stats);
+    u32_t initial = stats.size[ZJS_CB_LANE_HW];
+    zjs_set_callback_overflow_handler(overflow_report);
+    zjs_callback_id id = zjs_add_c_callback(NULL, c_callback_seq);
+    u32_t args[30] = { 0 };
+
+    // drop newest, after the lane has grown as far as it can
+    u32_t next = fill_lane(id, args, sizeof(args), 0);
+    zjs_get_callback_queue_stats(&stats);
+    zjs_assert(stats.grown > 0 && stats.size[ZJS_CB_LANE_HW] > initial,
+               "overflow: full lane grows first");
+    drain_lanes();
+    bool in_order = true;
+    for (int i = 0; i < seq_count; i++) {
+        in_order = in_order && seq_seen[i] == i;
+    }
+    zjs_assert(stats.dropped == 1 && seq_count == next - 1 && in_order,
+               "overflow: drop-newest loses only the last signal");
+    zjs_assert(overflow_reports == 1, "overflow: handler called once");
+
+    // drop oldest
+    zjs_set_callback_overflow_policy(ZJS_CB_OVERFLOW_DROP_OLDEST);
+    next = fill_lane(id, args, sizeof(args), 0);
+    drain_lanes();
+    zjs_assert(seq_count > 0 && seq_seen[0] == 1 &&
+               seq_seen[seq_count - 1] == next - 1,
+               "overflow: drop-oldest keeps the newest signal");
+
+    // coalesce
+    zjs_set_callback_overflow_policy(ZJS_CB_OVERFLOW_COALESCE);
+    zjs_get_callback_queue_stats(&stats);
+    u32_t dropped = stats.dropped;
+    fill_lane(id, args, sizeof(args), 0);
+    zjs_get_callback_queue_stats(&stats);
+    zjs_assert(stats.coalesced == 1 && stats.dropped == dropped,
+               "overflow: coalesce merges into a pending signal");
+    drain_lanes();
+
+    // blocking the main thread would deadlock, so it drops instead
+    zjs_set_callback_overflow_policy(ZJS_CB_OVERFLOW_BLOCK);
+    fill_lane(id, args, sizeof(args), 0);
+    zjs_get_callback_queue_stats(&stats);
+    zjs_assert(stats.dropped == dropped + 1 && stats.blocked == 0,
+               "overflow: main thread never blocks");
+    drain_lanes();
+
+    zjs_set_callback_overflow_policy(ZJS_CB_OVERFLOW_DROP_NEWEST);
+    zjs_set_callback_overflow_handler(NULL);
+    zjs_remove_callback(id);
+    zjs_service_callbacks();
+}
+
+// Test coalescing of repeated signals
+
+static u32_t latest_seen[2];
+static int latest_calls = 0;
+static void c_callback_latest(void *handle, const void *args)
+{
+    memcpy(latest_seen, args, sizeof(latest_seen));
+    latest_calls++;
+}
+
+static void test_callback_coalesce()
+{
+    reset_callbacks();
+
+    // zero-arg signals collapse into one call until it's serviced
+    count1 = 0;
+    zjs_callback_id id = zjs_add_c_callback(NULL, c_callback1);
+    zjs_assert(zjs_set_callback_coalesce(id, 0), "coalesce: set up");
+    for (int i = 0; i < 10; i++) {
+        zjs_signal_callback(id, NULL, 0);
+    }
+    zjs_assert(zjs_get_callback_lane_depth(ZJS_CB_LANE_HW) == 1,
+               "coalesce: one signal queued");
+    zjs_service_callbacks();
+    zjs_assert(count1 == 1, "coalesce: called once");
+    zjs_signal_callback(id, NULL, 0);
+    zjs_service_callbacks();
+    zjs_assert(count1 == 2, "coalesce: signal after service calls again");
+    zjs_remove_callback(id);
+
+    // the latest args win
+    id = zjs_add_c_callback(NULL, c_callback_latest);
+    zjs_set_callback_coalesce(id, sizeof(latest_seen));
+    for (u32_t i = 1; i <= 5; i++) {
+        u32_t args[2] = { i, i * 10 };
+        zjs_signal_callback(id, args, sizeof(args));
+    }
+    zjs_service_callbacks();
+    zjs_assert(latest_calls == 1 && latest_seen[0] == 5 &&
+               latest_seen[1] == 50, "coalesce: latest args win");
+    u32_t big[3] = { 0 };
+    zjs_assert(zjs_signal_callback(id, big, sizeof(big)) == -EMSGSIZE,
+               "coalesce: args too big rejected");
+    zjs_remove_callback(id);
+
+    // callbacks that carry unrelated work in each signal never coalesce
+    id = zjs_add_c_callback(NULL, c_callback1);
+    zjs_set_callback_shared(id);
+    zjs_assert(!zjs_set_callback_coalesce(id, 0),
+               "coalesce: refused for shared callback");
+    zjs_remove_callback(id);
+    zjs_service_callbacks();
+}
+
 static void test_hex_to_byte()
 {
     zjs_assert(check_hex_to_byte("00", 0), "hex to byte: 00");
@@ -458,6 +825,310 @@ static void test_list_macros()
     zjs_assert(head == NULL, "list head was NULL");
 }
 
+// Test lock-free callback queue
+
+static void test_mpsc_queue()
+{
+    u32_t buf[16];
+    zjs_mpsc_queue_t q;
+    zjs_mpsc_msg_t msg;
+    zjs_mpsc_init(&q, buf, 16);
+
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == -EAGAIN, "queue: empty peek");
+
+    u32_t args[3] = { 0x11, 0x22, 0x33 };
+    zjs_assert(zjs_mpsc_put(&q, 7, 0, args, 3) == 0, "queue: put with args");
+    zjs_assert(zjs_mpsc_put(&q, 8, 0xfe, NULL, 0) == 0, "queue: put no args");
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == 0 && msg.type == 7 &&
+               msg.size32 == 3 && msg.data[0] == 0x11 && msg.data[2] == 0x33,
+               "queue: header and payload in one peek");
+    zjs_mpsc_consume(&q, &msg);
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == 0 && msg.type == 8 &&
+               msg.value == 0xfe && msg.size32 == 0, "queue: second message");
+    zjs_mpsc_consume(&q, &msg);
+
+    // 8 words used so far, so the second record must wrap with padding
+    u32_t more[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    zjs_assert(zjs_mpsc_put(&q, 9, 0, more, 4) == 0, "queue: put to end");
+    zjs_assert(zjs_mpsc_put(&q, 10, 0, more, 2) == 0, "queue: put wraps");
+    zjs_assert(zjs_mpsc_put(&q, 11, 0, more, 8) == -EMSGSIZE,
+               "queue: put to full queue fails");
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == 0 && msg.type == 9 &&
+               msg.size32 == 4 && msg.data[3] == 4, "queue: last message");
+    zjs_mpsc_consume(&q, &msg);
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == 0 && msg.type == 10 &&
+               msg.size32 == 2 && msg.data == buf + 2,
+               "queue: wrapped message");
+    zjs_mpsc_consume(&q, &msg);
+    zjs_assert(zjs_mpsc_peek(&q, &msg) == -EAGAIN, "queue: empty again");
+}
+
+// Contention benchmark: N producer threads signal through each queue while
+//   the main thread drains it, checking every producer's messages arrive in
+//   order; the ring buffer needs a lock since it only allows one producer
+
+#define BENCH_PRODUCERS 4
+#define BENCH_MESSAGES  100000
+#define BENCH_QUEUE_SIZE 256
+
+typedef struct bench_producer {
+    u32_t id;
+    int (*put)(u16_t type, const u32_t *data, u8_t size32);
+} bench_producer_t;
+
+static zjs_mpsc_queue_t bench_queue;
+static struct zjs_port_ring_buf bench_ring;
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static u32_t bench_buf[BENCH_QUEUE_SIZE];
+
+static int bench_queue_put(u16_t type, const u32_t *data, u8_t size32)
+{
+    return zjs_mpsc_put(&bench_queue, type, 0, data, size32);
+}
+
+static int bench_ring_put(u16_t type, const u32_t *data, u8_t size32)
+{
+    pthread_mutex_lock(&bench_mutex);
+    int ret = zjs_port_ring_buf_put(&bench_ring, type, 0, (u32_t *)data,
+                                    size32);
+    pthread_mutex_unlock(&bench_mutex);
+    return ret;
+}
+
+static void *bench_produce(void *arg)
+{
+    bench_producer_t *p = (bench_producer_t *)arg;
+    for (u32_t i = 0; i < BENCH_MESSAGES; i++) {
+        u32_t data[2] = { i, ~i };
+        while (p->put(p->id, data, 2)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static bool bench_queue_get(u16_t *type, u32_t *data)
+{
+    zjs_mpsc_msg_t msg;
+    if (zjs_mpsc_peek(&bench_queue, &msg)) {
+        return false;
+    }
+    *type = msg.type;
+    memcpy(data, msg.data, msg.size32 * sizeof(u32_t));
+    zjs_mpsc_consume(&bench_queue, &msg);
+    return true;
+}
+
+static bool bench_ring_get(u16_t *type, u32_t *data)
+{
+    u8_t value, size = 2;
+    pthread_mutex_lock(&bench_mutex);
+    int ret = zjs_port_ring_buf_get(&bench_ring, type, &value, data, &size);
+    pthread_mutex_unlock(&bench_mutex);
+    return ret == 0;
+}
+
+static double run_contention_bench(int (*put)(u16_t, const u32_t *, u8_t),
+                                   bool (*get)(u16_t *, u32_t *),
+                                   bool *in_order)
+{
+    pthread_t threads[BENCH_PRODUCERS];
+    bench_producer_t producers[BENCH_PRODUCERS];
+    u32_t expected[BENCH_PRODUCERS] = { 0 };
+    struct timespec start, end;
+
+    *in_order = true;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        producers[i].id = i;
+        producers[i].put = put;
+        pthread_create(&threads[i], NULL, bench_produce, &producers[i]);
+    }
+    u32_t received = 0;
+    while (received < BENCH_PRODUCERS * BENCH_MESSAGES) {
+        u16_t type;
+        u32_t data[2];
+        if (!get(&type, data)) {
+            sched_yield();
+            continue;
+        }
+        if (type >= BENCH_PRODUCERS || data[0] != expected[type] ||
+            data[1] != ~data[0]) {
+            *in_order = false;
+        } else {
+            expected[type]++;
+        }
+        received++;
+    }
+    for (int i = 0; i < BENCH_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1000.0 +
+           (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+static void test_mpsc_contention()
+{
+    bool in_order;
+    u32_t total = BENCH_PRODUCERS * BENCH_MESSAGES;
+
+    zjs_mpsc_init(&bench_queue, bench_buf, BENCH_QUEUE_SIZE);
+    double lockfree = run_contention_bench(bench_queue_put, bench_queue_get,
+                                           &in_order);
+    zjs_assert(in_order, "queue: contended messages arrive intact in order");
+
+    zjs_port_ring_buf_init(&bench_ring, sizeof(bench_buf), bench_buf);
+    double locked = run_contention_bench(bench_ring_put, bench_ring_get,
+                                         &in_order);
+
+    printf("%d producers x %d messages: lock-free queue %.1f ms "
+           "(%.0f ns/msg), locked ring buffer %.1f ms (%.0f ns/msg)\n",
+           BENCH_PRODUCERS, BENCH_MESSAGES, lockfree,
+           lockfree * 1000000 / total, locked, locked * 1000000 / total);
+}
+
+#ifdef ZJS_LOOP_STATS
+// Measure what the loop stats add to each pass through the main loop
+
+#define MARK_COUNT    1000000
+#define JS_CALL_COUNT 100000
+
+static double ns_since(const struct timespec *start, u32_t count)
+{
+    // returns: average ns per operation for count operations since start
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start->tv_sec) * 1000000000.0 +
+            (end.tv_nsec - start->tv_nsec)) / count;
+}
+
+static void test_loop_stats_overhead()
+{
+    struct timespec start;
+    zjs_loop_stats_init();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (u32_t i = 0; i < MARK_COUNT; i++) {
+        zjs_loop_stats_mark(i % ZJS_PHASE_COUNT);
+    }
+    double mark_ns = ns_since(&start, MARK_COUNT);
+    const zjs_loop_phase_stats_t *stats =
+        zjs_loop_stats_get(ZJS_PHASE_CALLBACKS);
+    zjs_assert(stats->count == (MARK_COUNT + ZJS_PHASE_COUNT - 1) /
+                               ZJS_PHASE_COUNT,
+               "loop stats: every mark counted");
+
+    // compare with the least JS a pass could run: one empty function call
+    const char *source = "(function () {})";
+    ZVAL func = jerry_eval((const jerry_char_t *)source, strlen(source),
+                           false);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (u32_t i = 0; i < JS_CALL_COUNT; i++) {
+        ZVAL rval = jerry_call_function(func, ZJS_UNDEFINED, NULL, 0);
+    }
+    double call_ns = ns_since(&start, JS_CALL_COUNT);
+
+    // a pass marks every phase once
+    double pass_ns = mark_ns * ZJS_PHASE_COUNT;
+    printf("loop stats: %.0f ns per mark, %.0f ns per pass; one empty JS "
+           "call takes %.0f ns, so marks add %.1f%% to a pass that makes "
+           "it\n", mark_ns, pass_ns, call_ns,
+           pass_ns * 100 / (pass_ns + call_ns));
+    zjs_loop_stats_init();
+}
+#endif  // ZJS_LOOP_STATS
+
+// Test message blocks and zero-copy deferred work
+
+static const void *block_seen_data = NULL;
+static u32_t block_seen_len = 0;
+static bool block_seen_intact = false;
+static void block_work(const void *buffer, u32_t length)
+{
+    const u8_t *bytes = (const u8_t *)buffer;
+    block_seen_data = buffer;
+    block_seen_len = length;
+    block_seen_intact = true;
+    for (int i = 0; i < length; i++) {
+        if (bytes[i] != (u8_t)i) {
+            block_seen_intact = false;
+        }
+    }
+}
+
+static void test_msgblocks()
+{
+    reset_callbacks();
+    zjs_service_callbacks();
+    u32_t base = zjs_msgblock_in_use();
+
+    zjs_msgblock_t *small = zjs_msgblock_alloc(10);
+    zjs_assert(small && zjs_msgblock_size(small) == 10 &&
+               zjs_msgblock_capacity(small) >= 10,
+               "msgblock: alloc small block");
+    zjs_assert(((uintptr_t)zjs_msgblock_data(small) & 7) == 0,
+               "msgblock: payload aligned");
+    zjs_assert(zjs_msgblock_from_data(zjs_msgblock_data(small)) == small,
+               "msgblock: block from payload");
+    zjs_msgblock_ref(small);
+    zjs_msgblock_unref(small);
+    zjs_assert(zjs_msgblock_in_use() == base + 1,
+               "msgblock: still held after ref/unref");
+    zjs_msgblock_unref(small);
+    zjs_assert(zjs_msgblock_in_use() == base, "msgblock: freed on last unref");
+
+    zjs_msgblock_t *again = zjs_msgblock_alloc(10);
+    zjs_assert(again == small, "msgblock: freed block reused");
+    zjs_msgblock_unref(again);
+
+    zjs_assert(zjs_msgblock_alloc(1 << 20) == NULL,
+               "msgblock: oversized alloc fails");
+
+    // exhaust every pool, then check the blocks all come back
+    zjs_msgblock_t *held[64];
+    int count = 0;
+    while (count < 64 && (held[count] = zjs_msgblock_alloc(1))) {
+        count++;
+    }
+    zjs_assert(count > 0 && count < 64 && zjs_msgblock_alloc(1) == NULL,
+               "msgblock: pools run out");
+    for (int i = 0; i < count; i++) {
+        zjs_msgblock_unref(held[i]);
+    }
+    zjs_assert(zjs_msgblock_in_use() == base, "msgblock: all blocks returned");
+
+    // several KB through the callback queue with no copies
+    u32_t len = 3000;
+    zjs_msgblock_t *block = zjs_msgblock_alloc(len);
+    zjs_assert(block != NULL, "msgblock: alloc large block");
+    if (block) {
+        u8_t *data = zjs_msgblock_data(block);
+        for (int i = 0; i < len; i++) {
+            data[i] = (u8_t)i;
+        }
+        zjs_defer_block(block_work, block);
+        zjs_service_callbacks();
+        zjs_assert(block_seen_data == data && block_seen_len == len &&
+                   block_seen_intact, "msgblock: deferred without copying");
+        zjs_assert(zjs_msgblock_in_use() == base,
+                   "msgblock: released after deferred work");
+    }
+
+    // large zjs_defer_work() payloads go through a block instead of the stack
+    u8_t payload[200];
+    for (int i = 0; i < sizeof(payload); i++) {
+        payload[i] = (u8_t)i;
+    }
+    block_seen_data = NULL;
+    zjs_defer_work(block_work, payload, sizeof(payload));
+    zjs_assert(zjs_msgblock_in_use() == base + 1,
+               "msgblock: large deferred work uses a block");
+    zjs_service_callbacks();
+    zjs_assert(block_seen_len == sizeof(payload) && block_seen_intact &&
+               zjs_msgblock_in_use() == base,
+               "msgblock: large deferred work delivered");
+}
+
 // Test zjs_str_matches function
 
 static void test_str_matches()
@@ -525,7 +1196,18 @@ void zjs_run_unit_tests()
     test_default_convert_pin();
     test_compress_32();
     test_validate_args();
+    // needs the callbacks the runtime set up, so it goes before the tests
+    //   that reset them
+    test_timer_memory();
     test_c_callbacks();
+    test_callback_overflow();
+    test_callback_coalesce();
+    test_mpsc_queue();
+    test_mpsc_contention();
+#ifdef ZJS_LOOP_STATS
+    test_loop_stats_overhead();
+#endif
+    test_msgblocks();
     test_list_macros();
     test_str_matches();
     test_split_pin_name();
@@ -433,7 +433,6 @@ int zjs_require_string_if_prop_map(jerry_value_t obj, const char *prop,
 
 void free_handle_nop(void *h);
 
-#ifndef ZJS_LINUX_BUILD
 #ifndef ZJS_ASHELL
 /*
  * Unblock the main loop
@@ -442,6 +441,8 @@ void zjs_loop_unblock(void);
 
 /*
  * Block in the main loop for a specified amount of time
+ *
+ * On Linux, time is in milliseconds; ZJS_TICKS_FOREVER waits until unblocked
  */
 void zjs_loop_block(int time);
 
@@ -454,6 +455,12 @@ void zjs_loop_init(void);
 #define zjs_loop_block(time) do {} while(0)
 #define zjs_loop_init() do {} while(0)
 #endif
+
+#ifdef ZJS_LINUX_BUILD
+/*
+ * Print main loop sleep/wakeup statistics (jslinux --loopstats)
+ */
+void zjs_loop_print_stats(void);
 #endif
 
 // Type definition to be used with macros below
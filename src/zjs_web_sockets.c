@@ -540,16 +540,17 @@ static void process_packet(ws_connection_t *con, u8_t *data, u32_t len)
     con->wptr += packet->payload_len;
 
     u16_t plen = packet->payload_len;
+    // a close frame's status code is big-endian, and 1005 means it had none
+    u16_t code = 1005;
 
-    // FIXME: deferred emit calls below can be changed to direct
-
+    // we're on the main thread already, so listeners run right away
     switch (packet->opcode) {
     case WS_PACKET_CONTINUATION:
         // continuation frame
     case WS_PACKET_TEXT_DATA:
         // text data
-        zjs_defer_emit_event(con->conn, "message", &plen, sizeof(plen),
-                             trigger_data, zjs_release_args);
+        zjs_direct_emit_event(con->conn, "message", &plen, sizeof(plen),
+                              trigger_data, zjs_release_args);
         break;
     case WS_PACKET_BINARY_DATA:
         // binary data (TODO: why is this ignored?)
@@ -557,17 +558,19 @@ static void process_packet(ws_connection_t *con, u8_t *data, u32_t len)
         consume_data(con, packet->payload_len);
         break;
     case WS_PACKET_PING:
-        zjs_defer_emit_event(con->conn, "ping", &plen, sizeof(plen),
-                             trigger_data, zjs_release_args);
+        zjs_direct_emit_event(con->conn, "ping", &plen, sizeof(plen),
+                              trigger_data, zjs_release_args);
         break;
     case WS_PACKET_PONG:
-        zjs_defer_emit_event(con->conn, "pong", &plen, sizeof(plen),
-                             trigger_data, zjs_release_args);
+        zjs_direct_emit_event(con->conn, "pong", &plen, sizeof(plen),
+                              trigger_data, zjs_release_args);
         break;
     case WS_PACKET_CLOSE:
-        zjs_defer_emit_event(con->conn, "close", packet->payload,
-                             sizeof(packet->payload), pre_close_connection,
-                             close_connection);
+        if (packet->payload_len >= 2) {
+            code = (packet->payload[0] << 8) | packet->payload[1];
+        }
+        zjs_direct_emit_event(con->conn, "close", &code, sizeof(code),
+                              pre_close_connection, close_connection);
         break;
     default:
         DBG_PRINT("opcode 0x%02x not recognized\n", packet->opcode);
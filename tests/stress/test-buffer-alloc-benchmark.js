@@ -0,0 +1,27 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Buffer allocation benchmark: creates 20000 buffers of each of several
+// packet-sized lengths, and reports the time per buffer and how often the
+// size class pools could reuse memory.
+
+var performance = require('performance');
+
+var COUNT = 20000;
+var sizes = [16, 64, 128, 512];
+
+for (var i = 0; i < sizes.length; i++) {
+    var size = sizes[i];
+    var before = Buffer.getPoolStats();
+    var start = performance.now();
+    for (var j = 0; j < COUNT; j++) {
+        var buf = new Buffer(size);
+        buf.writeUInt8(j & 0xff, 0);
+    }
+    var ms = performance.now() - start;
+    var after = Buffer.getPoolStats();
+    var hits = after.hits - before.hits;
+    var misses = after.misses - before.misses;
+    var rate = hits + misses ? hits * 100 / (hits + misses) : 0;
+    console.log(size + ' bytes: ' + (ms * 1000 / COUNT).toFixed(3) +
+                ' us/buffer, pool hit rate ' + rate.toFixed(1) + '%');
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Buffer search benchmark: splits a 16KB buffer of CRLF-terminated lines,
+// once with a JS loop over readUInt8 and once with indexOf, and reports the
+// throughput of each.
+
+var performance = require('performance');
+
+var line = 'sensor=42,temp=21.5,humidity=40\r\n';
+var lines = [];
+while (lines.length * line.length < 16384) {
+    lines.push(line);
+}
+var data = new Buffer(lines.join(''));
+
+function run(name, next) {
+    var start = performance.now();
+    var offset = 0;
+    var count = 0;
+    while (true) {
+        var end = next(offset);
+        if (end < 0) {
+            break;
+        }
+        count++;
+        offset = end + 2;
+    }
+    var ms = performance.now() - start;
+    console.log(name + ': ' + count + ' lines in ' + ms.toFixed(3) + ' ms, ' +
+                (data.length / 1024 * 1000 / ms).toFixed(1) + ' KB/s');
+}
+
+run('readUInt8 loop', function (offset) {
+    for (var i = offset; i + 1 < data.length; i++) {
+        if (data.readUInt8(i) === 13 && data.readUInt8(i + 1) === 10) {
+            return i;
+        }
+    }
+    return -1;
+});
+
+run('indexOf', function (offset) {
+    return data.indexOf('\r\n', offset);
+});
@@ -0,0 +1,44 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Buffer view benchmark: parses a stream of length-prefixed frames, taking
+// each payload once with slice(), which shares the stream's memory, and once
+// by copying it into a new buffer, and reports the throughput of each.
+
+var performance = require('performance');
+
+var FRAMES = 2000;
+var PAYLOAD = 64;
+
+// each frame is a 2-byte big-endian length followed by the payload
+var stream = new Buffer(FRAMES * (PAYLOAD + 2));
+for (var i = 0; i < FRAMES; i++) {
+    var offset = i * (PAYLOAD + 2);
+    stream.writeUInt16BE(PAYLOAD, offset);
+    stream.fill(i & 0xff, offset + 2, offset + 2 + PAYLOAD);
+}
+
+function parse(name, take) {
+    var start = performance.now();
+    var offset = 0;
+    var sum = 0;
+    while (offset < stream.length) {
+        var len = stream.readUInt16BE(offset);
+        var payload = take(offset + 2, len);
+        sum += payload.readUInt8(0);
+        offset += 2 + len;
+    }
+    var ms = performance.now() - start;
+    var mb = stream.length / (1024 * 1024);
+    console.log(name + ': ' + ms.toFixed(3) + ' ms, ' +
+                (mb * 1000 / ms).toFixed(2) + ' MB/s (checksum ' + sum + ')');
+}
+
+parse('copy', function (start, len) {
+    var payload = new Buffer(len);
+    stream.copy(payload, 0, start, start + len);
+    return payload;
+});
+
+parse('slice', function (start, len) {
+    return stream.slice(start, start + len);
+});
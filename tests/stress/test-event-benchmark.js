@@ -0,0 +1,63 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// EventEmitter benchmark: emits to emitters with many events, each with a few
+// listeners, and reports how long each emit takes.
+
+var EventEmitter = require('events');
+var performance = require('performance');
+
+var EMITTERS = 10;
+var EVENTS = 50;
+var LISTENERS = 3;
+var ROUNDS = 20;
+
+var calls = 0;
+function listener() {
+    calls++;
+}
+
+var emitters = [];
+var names = [];
+for (var i = 0; i < EVENTS; i++) {
+    names.push('event' + i);
+}
+
+var start = performance.now();
+for (var e = 0; e < EMITTERS; e++) {
+    var emitter = new EventEmitter();
+    emitter.setMaxListeners(LISTENERS + 1);
+    for (var i = 0; i < EVENTS; i++) {
+        for (var j = 0; j < LISTENERS; j++) {
+            emitter.on(names[i], listener);
+        }
+    }
+    emitters.push(emitter);
+}
+var ms = performance.now() - start;
+console.log('added ' + EMITTERS * EVENTS * LISTENERS + ' listeners in ' +
+            ms.toFixed(3) + ' ms');
+
+function run(label, name) {
+    calls = 0;
+    var start = performance.now();
+    for (var r = 0; r < ROUNDS; r++) {
+        for (var e = 0; e < EMITTERS; e++) {
+            for (var i = 0; i < EVENTS; i++) {
+                emitters[e].emit(name(i));
+            }
+        }
+    }
+    var ms = performance.now() - start;
+    var emits = ROUNDS * EMITTERS * EVENTS;
+    console.log(label + ': ' + emits + ' emits, ' + calls + ' calls in ' +
+                ms.toFixed(3) + ' ms, ' + (ms * 1000 / emits).toFixed(2) +
+                ' us per emit');
+}
+
+// the last events added were the slowest to find in a list
+run('with listeners', function (i) {
+    return names[EVENTS - 1 - i];
+});
+run('no listeners', function (i) {
+    return 'missing' + i;
+});
@@ -0,0 +1,43 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Deferred call benchmark: chains 10000 calls through setTimeout(fn, 0),
+// setImmediate(fn) and process.nextTick(fn) in turn, and reports the time
+// per call for each. Each call queues the next one, so this measures the cost
+// of queueing a call and getting back to it from the main loop.
+
+var performance = require('performance');
+
+var COUNT = 10000;
+
+var methods = [
+    ['setTimeout(0)', function (fn) { setTimeout(fn, 0); }],
+    ['setImmediate', function (fn) { setImmediate(fn); }],
+    ['nextTick', function (fn) { process.nextTick(fn); }]
+];
+
+function run(index) {
+    if (index >= methods.length) {
+        return;
+    }
+    var name = methods[index][0];
+    var defer = methods[index][1];
+    var left = COUNT;
+    var start = performance.now();
+
+    function step() {
+        if (--left > 0) {
+            defer(step);
+            return;
+        }
+        var total = performance.now() - start;
+        console.log(name + ': ' + total.toFixed(3) + ' ms (' +
+                    (total * 1000 / COUNT).toFixed(3) + ' us/call)');
+        // start the next method from a timer, so it starts on a fresh pass
+        setTimeout(function () {
+            run(index + 1);
+        }, 0);
+    }
+    defer(step);
+}
+
+run(0);
@@ -0,0 +1,121 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Timer scheduling benchmark: keeps 10000 timers with random timeouts live at
+// once, cancels and replaces some of them at random while they're pending and
+// as others fire, and reports how long scheduling, cancelling and draining
+// the timers took.
+//
+// Timer handles are plain numbers, but 10000 of them still don't fit in the
+// default JS heap, so only the last RING handles are remembered and cancels
+// pick from those. Each timer's deadline is random, so the ones cancelled sit
+// at random places in the timer heap anyway.
+
+var performance = require('performance');
+
+var LIVE = 10000;
+var RING = 256;
+var ROUNDS = 20;
+var MAX_TIMEOUT = 2000;
+// chance that a timer firing cancels another one
+var CANCEL_ODDS = 0.2;
+
+var handles = [];
+var seqs = [];
+var createTime = 0;
+var cancelTime = 0;
+var created = 0;
+var cancelled = 0;
+var fired = 0;
+var peak = 0;
+var start = performance.now();
+var firstFire = 0;
+
+function randomSlot() {
+    return Math.floor(Math.random() * RING);
+}
+
+function createAt(i) {
+    // seqs tells a slot's timer apart from the ones that used it before
+    var seq = created++;
+    handles[i] = setTimeout(onTimeout, Math.floor(Math.random() * MAX_TIMEOUT),
+                            seq);
+    seqs[i] = seq;
+}
+
+function cancelAt(i) {
+    if (seqs[i] >= 0) {
+        clearTimeout(handles[i]);
+        seqs[i] = -1;
+        cancelled++;
+    }
+}
+
+function report() {
+    var end = performance.now();
+    console.log('timers created:   ' + created);
+    console.log('timers cancelled: ' + cancelled);
+    console.log('timers fired:     ' + fired);
+    console.log('most timers live: ' + peak);
+    console.log('create time:      ' + createTime.toFixed(3) + ' ms (' +
+                (createTime * 1000 / created).toFixed(3) + ' us/timer)');
+    console.log('cancel time:      ' + cancelTime.toFixed(3) + ' ms (' +
+                (cancelTime * 1000 / cancelled).toFixed(3) + ' us/timer)');
+    console.log('drain time:       ' + (end - firstFire).toFixed(3) + ' ms');
+    console.log('total time:       ' + (end - start).toFixed(3) + ' ms');
+    if (fired + cancelled !== created) {
+        console.log('FAIL: ' + (created - fired - cancelled) +
+                    ' timers were lost');
+    }
+}
+
+function onTimeout(seq) {
+    if (!fired) {
+        firstFire = performance.now();
+    }
+    fired++;
+    var i = seq % RING;
+    if (seqs[i] === seq) {
+        seqs[i] = -1;
+    }
+    if (Math.random() < CANCEL_ODDS) {
+        var t0 = performance.now();
+        cancelAt(randomSlot());
+        cancelTime += performance.now() - t0;
+    }
+    if (fired + cancelled === created) {
+        report();
+    }
+}
+
+// fill up to LIVE timers
+for (var i = 0; i < RING; i++) {
+    seqs.push(-1);
+    handles.push(0);
+}
+var t0 = performance.now();
+for (var i = 0; i < LIVE; i++) {
+    createAt(i % RING);
+}
+createTime += performance.now() - t0;
+peak = created;
+
+// churn: cancel timers at random and replace them, so the heap stays full
+for (var round = 0; round < ROUNDS; round++) {
+    var picks = [];
+    for (var j = 0; j < RING / 2; j++) {
+        picks.push(randomSlot());
+    }
+    var t1 = performance.now();
+    for (var j = 0; j < picks.length; j++) {
+        cancelAt(picks[j]);
+    }
+    var t2 = performance.now();
+    for (var j = 0; j < picks.length; j++) {
+        createAt(picks[j]);
+    }
+    cancelTime += t2 - t1;
+    createTime += performance.now() - t2;
+    if (created - cancelled > peak) {
+        peak = created - cancelled;
+    }
+}
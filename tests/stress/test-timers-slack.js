@@ -0,0 +1,39 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Timer slack benchmark: runs 20 intervals with unrelated periods for five
+// seconds, first exact and then with 50ms of slack, and reports how many
+// wakeups per second it took to fire them and how many the slack saved.
+
+var COUNT = 20;
+var DURATION = 5000;
+var SLACK = 50;
+
+function run(slack, done) {
+    process.setTimerSlack(slack);
+    var ids = [];
+    for (var i = 0; i < COUNT; i++) {
+        // periods from 97ms to 268ms, so exact timers rarely line up
+        ids.push(setInterval(function () {}, 97 + i * 9));
+    }
+    var before = process.getTimerStats();
+    setTimeout(function () {
+        var after = process.getTimerStats();
+        for (var i = 0; i < ids.length; i++) {
+            clearInterval(ids[i]);
+        }
+        var fired = after.fired - before.fired;
+        var wakeups = after.wakeups - before.wakeups;
+        var rate = wakeups * 1000 / DURATION;
+        console.log('slack ' + slack + 'ms: ' + fired + ' fired, ' +
+                    rate.toFixed(1) + ' wakeups/s');
+        done(rate);
+    }, DURATION);
+}
+
+run(0, function (exact) {
+    run(SLACK, function (slack) {
+        process.setTimerSlack(0);
+        console.log('saved ' + (exact - slack).toFixed(1) + ' wakeups/s (' +
+                    ((exact - slack) * 100 / exact).toFixed(0) + '%)');
+    });
+});
@@ -0,0 +1,30 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// WebSocket message latency benchmark: echoes each message straight back, so
+// tests/tools/test-ws-latency-client.js can time round trips from the host.
+// Build this before and after a change to message delivery and compare the
+// client's results. Set up the network as described in test-ws4-server.js.
+
+var WebSocket = require('ws');
+var performance = require('performance');
+
+var server = new WebSocket.Server({ host: '192.0.2.1', port: 8080 });
+
+server.on('connection', function (websocket) {
+    var count = 0;
+    var start = 0;
+    websocket.on('message', function (message) {
+        if (!count) {
+            start = performance.now();
+        }
+        count++;
+        websocket.send(message);
+    });
+    websocket.on('close', function () {
+        var ms = performance.now() - start;
+        console.log('echoed ' + count + ' messages in ' + ms.toFixed(3) +
+                    ' ms');
+    });
+});
+
+console.log('waiting for test-ws-latency-client.js');
@@ -101,4 +101,90 @@ assert(buf.readUInt8(4) == 0xce && buf.readUInt8(5) == 0xfa &&
        buf.readUInt8(6) == 0xad && buf.readUInt8(7) == 0xbe,
        "writeUInt32LE: write long, offset 4");
 
+// test signed integers
+var sbuf = new Buffer(8);
+sbuf.writeInt8(-2, 0);
+assert(sbuf.readUInt8(0) === 0xfe && sbuf.readInt8(0) === -2,
+       "writeInt8/readInt8: negative byte");
+sbuf.writeInt16BE(-300, 0);
+assert(sbuf.readUInt16BE(0) === 0xfed4 && sbuf.readInt16BE(0) === -300,
+       "writeInt16BE/readInt16BE");
+sbuf.writeInt16LE(-300, 2);
+assert(sbuf.readInt16LE(2) === -300 && sbuf.readInt16BE(2) === -11010,
+       "writeInt16LE/readInt16LE");
+sbuf.writeInt32BE(-123456789, 4);
+assert(sbuf.readInt32BE(4) === -123456789, "writeInt32BE/readInt32BE");
+sbuf.writeInt32LE(-2147483648, 0);
+assert(sbuf.readInt32LE(0) === -2147483648, "writeInt32LE/readInt32LE");
+
+// test floats and doubles
+var fbuf = new Buffer(8);
+fbuf.writeFloatLE(1.5, 0);
+assert(fbuf.readUInt32LE(0) === 0x3fc00000 && fbuf.readFloatLE(0) === 1.5,
+       "writeFloatLE/readFloatLE");
+fbuf.writeFloatBE(-0.25, 4);
+assert(fbuf.readFloatBE(4) === -0.25, "writeFloatBE/readFloatBE");
+fbuf.writeDoubleBE(3.141592653589793, 0);
+assert(fbuf.readDoubleBE(0) === 3.141592653589793 &&
+       fbuf.readUInt8(0) === 0x40, "writeDoubleBE/readDoubleBE");
+fbuf.writeDoubleLE(-1e300);
+assert(fbuf.readDoubleLE() === -1e300, "writeDoubleLE/readDoubleLE");
+assert.throws(function () {
+    fbuf.readDoubleLE(1);
+}, "readDoubleLE: out of bounds");
+
+// test variable width integers
+var vbuf = new Buffer(6);
+vbuf.writeUIntBE(0x123456, 0, 3);
+assert(vbuf.readUIntBE(0, 3) === 0x123456 && vbuf.readUInt8(0) === 0x12,
+       "writeUIntBE/readUIntBE: 3 bytes");
+vbuf.writeIntLE(-1000000, 0, 3);
+assert(vbuf.readIntLE(0, 3) === -1000000, "writeIntLE/readIntLE: 3 bytes");
+vbuf.writeIntBE(-123456789012, 0, 6);
+assert(vbuf.readIntBE(0, 6) === -123456789012,
+       "writeIntBE/readIntBE: 6 bytes");
+vbuf.writeUIntLE(0xffffffffffff, 0, 6);
+assert(vbuf.readUIntLE(0, 6) === 0xffffffffffff,
+       "writeUIntLE/readUIntLE: 6 bytes");
+assert.throws(function () {
+    vbuf.readIntLE(0, 7);
+}, "readIntLE: byteLength too large");
+
+// test bulk array readers
+var abuf = new Buffer([0x00, 0x01, 0xff, 0xfe, 0x80, 0x00, 0x7f]);
+var samples = abuf.readInt16Array(0, 3);
+assert(samples.length === 3 && samples[0] === 1 && samples[1] === -2 &&
+       samples[2] === -32768, "readInt16Array: big endian");
+samples = abuf.readInt16Array(1, 2, true);
+assert(samples[0] === -255 && samples[1] === -32514,
+       "readInt16Array: little endian, offset");
+assert(abuf.readUInt16Array(0).length === 3,
+       "readUInt16Array: count defaults to what fits");
+assert(abuf.readUInt8Array(5).join() === "0,127", "readUInt8Array");
+assert(abuf.readInt8Array(2, 2).join() === "-1,-2", "readInt8Array");
+assert.throws(function () {
+    abuf.readInt16Array(0, 4);
+}, "readInt16Array: count beyond buffer");
+
+// with typed arrays, the bulk readers return the matching typed array
+if (typeof Int16Array !== "undefined") {
+    assert(abuf.readInt16Array(0) instanceof Int16Array &&
+           abuf.readUInt16Array(0) instanceof Uint16Array &&
+           abuf.readInt8Array(0) instanceof Int8Array &&
+           abuf.readUInt8Array(0) instanceof Uint8Array &&
+           abuf.readInt32Array(0) instanceof Int32Array &&
+           abuf.readUInt32Array(0) instanceof Uint32Array &&
+           abuf.readFloatArray(0) instanceof Float32Array,
+           "read*Array: typed array of the matching type");
+    var fbuf = new Buffer(8);
+    fbuf.writeFloatLE(1.5, 0);
+    fbuf.writeFloatLE(-0.25, 4);
+    var floats = fbuf.readFloatArray(0, 2, true);
+    assert(floats[0] === 1.5 && floats[1] === -0.25,
+           "readFloatArray: little endian into a Float32Array");
+    samples = abuf.readInt16Array(0, 0);
+    assert(samples instanceof Int16Array && samples.length === 0,
+           "readInt16Array: empty typed array");
+}
+
 assert.result();
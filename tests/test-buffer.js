@@ -238,6 +238,139 @@ assert(ubuf.toString('utf8') === '¡ƵĴƧ ƦǾ©ĶƧ!', 'toString with utf8 enc
 assert(ubuf.toString('ascii') == "B!F5D4F' F&G>B)D6F'!",
        'toString with ascii encoding');
 
+// encodings
+var ebuf = new Buffer([0xfb, 0xff, 0x00, 0x41, 0xe9]);
+assert(ebuf.toString('hex') === 'fbff0041e9', 'toString with hex encoding');
+assert(ebuf.toString('base64') === '+/8AQek=', 'toString with base64 encoding');
+assert(ebuf.toString('base64url') === '-_8AQek',
+       'toString with base64url encoding');
+assert(ebuf.toString('latin1') === '\u00fb\u00ff\u0000A\u00e9',
+       'toString with latin1 encoding');
+assert(new Buffer('fbff0041e9', 'hex').toString('hex') === 'fbff0041e9',
+       'new Buffer with hex encoding');
+assert(new Buffer('abc', 'hex').length === 1,
+       'new Buffer with odd length hex');
+assert(new Buffer('+/8AQek=', 'base64').toString('hex') === 'fbff0041e9',
+       'new Buffer with base64 encoding');
+assert(new Buffer('-_8A Qek', 'base64url').toString('hex') === 'fbff0041e9',
+       'new Buffer with base64url encoding, skipping whitespace');
+assert(new Buffer('\u00fb\u00ffA', 'latin1').toString('hex') === 'fbff41',
+       'new Buffer with latin1 encoding');
+assert(new Buffer(0).toString('base64') === '', 'toString of empty buffer');
+var wbuf = new Buffer(4);
+wbuf.fill(0);
+assert(wbuf.write('cafe', 1, 2, 'hex') === 2 &&
+       wbuf.toString('hex') === '00cafe00', 'write with hex encoding');
+assert.throws(function () {
+    new Buffer('abc', 'unicorn64');
+}, "Error thrown with unsupported encoding in new Buffer()");
+
+// search and compare
+var sbuf = new Buffer('GET / HTTP/1.1\r\nHost: zephyr\r\n\r\nbody');
+assert(sbuf.indexOf('\r\n') === 14, 'indexOf: string');
+assert(sbuf.indexOf('\r\n', 15) === 29, 'indexOf: string from offset');
+assert(sbuf.indexOf(0x0a) === 15, 'indexOf: byte');
+assert(sbuf.indexOf(new Buffer('Host')) === 16, 'indexOf: buffer');
+assert(sbuf.indexOf('\r\n\r\n') === 29, 'indexOf: longer needle');
+assert(sbuf.indexOf('Host: zephyr\r\n') === 16,
+       'indexOf: needle long enough for skip table');
+assert(sbuf.indexOf('nothere') === -1, 'indexOf: not found');
+assert(sbuf.indexOf('body', -4) === 33, 'indexOf: negative offset');
+assert(sbuf.indexOf('0d0a', 0, 'hex') === 14, 'indexOf: hex encoding');
+assert(sbuf.lastIndexOf('\r\n') === 31, 'lastIndexOf: string');
+assert(sbuf.lastIndexOf('\r\n', 30) === 29, 'lastIndexOf: from offset');
+assert(sbuf.lastIndexOf(0x47) === 0, 'lastIndexOf: byte');
+assert(sbuf.includes('HTTP') && !sbuf.includes('HTTPS'), 'includes');
+
+var ca = new Buffer([1, 2, 3]);
+var cb = new Buffer([1, 2, 4]);
+assert(ca.equals(new Buffer([1, 2, 3])) && !ca.equals(cb), 'equals');
+assert(ca.compare(cb) === -1 && cb.compare(ca) === 1 &&
+       ca.compare(new Buffer([1, 2, 3])) === 0, 'compare');
+assert(ca.compare(new Buffer([1, 2])) === 1, 'compare: shorter target');
+assert(Buffer.compare(cb, ca) === 1, 'Buffer.compare');
+
+var joined = Buffer.concat([ca, new Buffer(0), cb]);
+assert(joined.toString('hex') === '010203010204', 'Buffer.concat');
+assert(Buffer.concat([ca, cb], 4).toString('hex') === '01020301',
+       'Buffer.concat: truncated');
+assert(Buffer.concat([ca], 5).toString('hex') === '0102030000',
+       'Buffer.concat: zero filled');
+assert.throws(function () {
+    Buffer.concat([ca, 'abc']);
+}, 'Buffer.concat: non-buffer in list');
+
+// slice and subarray share memory with the original buffer
+var whole = new Buffer('abcdefgh');
+var part = whole.slice(2, 5);
+assert(part.length === 3 && part.toString() === 'cde', 'slice: range');
+part.writeUInt8(0x43, 0);
+assert(whole.toString() === 'abCdefgh', 'slice: writes show in parent');
+whole.writeUInt8(0x45, 4);
+assert(part.toString() === 'CdE', 'slice: parent writes show in view');
+assert(whole.slice(-3).toString() === 'fgh', 'slice: negative start');
+assert(whole.slice(1, -6).toString() === 'b', 'slice: negative end');
+assert(whole.slice(5, 2).length === 0, 'slice: end before start');
+assert(whole.slice(6, 100).toString() === 'gh', 'slice: end clamped');
+assert(whole.subarray(1, 3).toString() === 'bC', 'subarray: range');
+var inner = part.slice(1);
+whole = null;
+part = null;
+assert(inner.toString() === 'dE', 'slice: view outlives its parent');
+
+// small buffers come from size class pools
+var before = Buffer.getPoolStats();
+var small = new Buffer(20);
+var large = new Buffer(1000);
+var after = Buffer.getPoolStats();
+assert(after.hits + after.misses === before.hits + before.misses + 1,
+       'getPoolStats: small buffer counted');
+assert(after.unpooled === before.unpooled + 1,
+       'getPoolStats: large buffer counted');
+assert(after.classes.length > 0 && after.hitRate >= 0 && after.hitRate <= 1,
+       'getPoolStats: classes and hit rate');
+assert(small.length === 20 && large.length === 1000,
+       'pooled buffer lengths');
+
+// copying another buffer
+var orig = new Buffer([7, 8, 9]);
+var copied = new Buffer(orig);
+copied.writeUInt8(1, 0);
+assert(orig.readUInt8(0) === 7 && copied.readUInt8(2) === 9,
+       'constructor: copies a buffer');
+
+// with typed arrays, buffers are Uint8Arrays sharing memory both ways
+if (typeof Uint8Array !== 'undefined') {
+    var tbuf = new Buffer([1, 2, 3, 4]);
+    assert(tbuf instanceof Uint8Array, 'typed array: buffer is a Uint8Array');
+    assert(tbuf[2] === 3, 'typed array: index read');
+    tbuf[1] = 0x42;
+    assert(tbuf.readUInt8(1) === 0x42, 'typed array: index write');
+
+    var u8 = new Uint8Array(tbuf.buffer);
+    u8[0] = 9;
+    assert(tbuf.readUInt8(0) === 9, 'typed array: buffer memory shared');
+
+    var ab = new ArrayBuffer(8);
+    var shared = new Buffer(ab, 2, 4);
+    shared.writeUInt16BE(0x1234, 0);
+    var view = new Uint8Array(ab);
+    assert(shared.length === 4 && view[2] === 0x12 && view[3] === 0x34,
+           'typed array: ArrayBuffer memory shared');
+    assert(shared.slice(1).buffer === ab, 'typed array: slice shares buffer');
+    assert(shared.slice(1)[0] === 0x34, 'typed array: slice offset');
+    assert.throws(function() {
+        new Buffer(ab, 6, 4);
+    }, 'typed array: ArrayBuffer range checked');
+
+    var fromU8 = new Buffer(new Uint8Array([5, 6, 7]));
+    assert(fromU8.length === 3 && fromU8[2] === 7,
+           'typed array: copies a Uint8Array');
+    var fromU16 = new Buffer(new Uint16Array([1, 0x102]));
+    assert(fromU16.length === 2 && fromU16[1] === 2,
+           'typed array: copies other typed arrays by element');
+}
+
 /*
  * We don't support Math functions currently or noAssert option to buffer writes
  *
@@ -0,0 +1,49 @@
+// Copyright (c) 2018, Intel Corporation.
+
+console.log("Test callback budget and lane depth APIs");
+
+var assert = require("Assert.js");
+
+assert(typeof process.getCallbackBudget() === "number",
+       "callbacks: default budget is a number");
+
+process.setCallbackBudget(2000);
+assert.equal(process.getCallbackBudget(), 2000, "callbacks: budget updated");
+
+assert.throws(function () {
+    process.setCallbackBudget(-1);
+}, "callbacks: negative budget throws");
+
+assert.throws(function () {
+    process.setCallbackBudget("fast");
+}, "callbacks: non-numeric budget throws");
+
+// only present in builds with CB_TRACE=on
+if (process.dumpCallbackTrace) {
+    process.dumpCallbackTrace();
+    assert(true, "callbacks: trace dumped");
+}
+
+var depths = process.getCallbackLaneDepths();
+assert(typeof depths.hardware === "number" && typeof depths.js === "number",
+       "callbacks: lane depths are numbers");
+
+// both timers expire in the same pass, so while the first one runs the
+//   second should be waiting in the JS lane
+var seen = -1;
+setTimeout(function () {
+    seen = process.getCallbackLaneDepths().js;
+}, 0);
+
+setTimeout(function () {
+    assert(seen >= 1, "callbacks: pending timer counted in JS lane");
+    assert.equal(process.getCallbackLaneDepths().js, 0,
+                 "callbacks: JS lane drained");
+
+    // a zero budget still services at least one callback per lane per pass
+    process.setCallbackBudget(0);
+    setTimeout(function () {
+        assert(true, "callbacks: serviced with zero budget");
+        assert.result();
+    }, 10);
+}, 0);
@@ -0,0 +1,76 @@
+// Copyright (c) 2018, Intel Corporation.
+
+console.log("Test callback queue overflow policy and stats");
+
+var assert = require("Assert.js");
+
+var stats = process.getCallbackQueueStats();
+assert.equal(stats.policy, "drop-newest", "overflow: default policy");
+assert(typeof stats.dropped === "number" &&
+       typeof stats.coalesced === "number" &&
+       typeof stats.blocked === "number" &&
+       typeof stats.grown === "number", "overflow: counters are numbers");
+assert(stats.sizes.hardware > 0 && stats.sizes.js > 0,
+       "overflow: lane sizes reported");
+
+var policies = ["drop-oldest", "coalesce", "block", "drop-newest"];
+for (var i = 0; i < policies.length; i++) {
+    process.setCallbackOverflowPolicy(policies[i]);
+    assert.equal(process.getCallbackQueueStats().policy, policies[i],
+                 "overflow: set policy " + policies[i]);
+}
+
+assert.throws(function () {
+    process.setCallbackOverflowPolicy("drop-everything");
+}, "overflow: unknown policy throws");
+
+assert.throws(function () {
+    process.setCallbackOverflowPolicy(1);
+}, "overflow: non-string policy throws");
+
+var overflows = 0;
+var overflowStats = null;
+process.on("overflow", function (stats) {
+    overflows++;
+    overflowStats = stats;
+});
+
+setTimeout(function () {
+    assert(overflows === 0 && process.getCallbackQueueStats().dropped === 0,
+           "overflow: nothing dropped under a small load");
+    fillLane();
+}, 10);
+
+// signal a JS callback from the main thread until the JS lane has grown as
+//   far as it can and starts dropping
+function fillLane() {
+    var cb = require("test_callbacks");
+    var calls = 0;
+    var id = cb.addCallback(function () {
+        calls++;
+    }, null);
+
+    var signals = 0;
+    var dropped = 0;
+    while (!dropped && signals < 200000) {
+        for (var i = 0; i < 1000; i++) {
+            cb.signalCallback(id);
+        }
+        signals += 1000;
+        dropped = process.getCallbackQueueStats().dropped;
+    }
+    assert(dropped > 0, "overflow: filling the JS lane drops signals");
+
+    var waitForDrain = setInterval(function () {
+        if (process.getCallbackLaneDepths().js > 0) {
+            return;
+        }
+        clearInterval(waitForDrain);
+        cb.removeCallback(id);
+        assert(overflows === 1 && overflowStats.dropped === dropped,
+               "overflow: event fires once with the stats");
+        assert.equal(calls, signals - dropped,
+                     "overflow: every signal kept is called");
+        assert.result();
+    }, 10);
+}
@@ -98,6 +98,107 @@ newAllListenersNum = eventEmitter.listenerCount("event_listener");
 assert(oldAllListenersNum !== 0 && newAllListenersNum === 0,
        "event: remove all listeners on event");
 
+// events are looked up by name across many emitters and names
+var manyEmitter = new event();
+var manyCounts = [];
+for (var i = 0; i < 40; i++) {
+    manyCounts.push(0);
+    manyEmitter.on("many_" + i, (function (index) {
+        return function () {
+            manyCounts[index]++;
+        };
+    })(i));
+}
+manyEmitter.on("data", function () {
+    manyCounts[0] += 100;
+});
+for (var i = 0; i < 40; i += 3) {
+    manyEmitter.emit("many_" + i);
+}
+manyEmitter.emit("data");
+var manyOk = manyCounts[0] === 101;
+for (var i = 1; i < 40; i++) {
+    manyOk = manyOk && manyCounts[i] === (i % 3 ? 0 : 1);
+}
+assert(manyOk, "event: emit finds the right event among many");
+
+var manyNames = manyEmitter.eventNames();
+assert(manyNames.length === 41 && manyNames[0] === "many_0" &&
+       manyNames[39] === "many_39" && manyNames[40] === "data",
+       "event: event names kept in the order added");
+assert(manyEmitter.emit("many_40") === false &&
+       eventEmitter.emit("many_1") === false,
+       "event: emit with no listeners on this emitter");
+
+// names of events whose listeners are all gone are dropped
+var churnEmitter = new event();
+var churnCalls = 0;
+function churnListener() {
+    churnCalls++;
+}
+for (var i = 0; i < 2000; i++) {
+    churnEmitter.on("churn_" + i, churnListener);
+    churnEmitter.emit("churn_" + i);
+    if (i % 2) {
+        churnEmitter.removeListener("churn_" + i, churnListener);
+    } else {
+        churnEmitter.removeAllListeners("churn_" + i);
+    }
+}
+churnEmitter.once("churn_once", churnListener);
+churnEmitter.emit("churn_once");
+assert(churnCalls === 2001 && churnEmitter.eventNames().length === 0,
+       "event: events without listeners are removed");
+churnEmitter.on("churn_1", churnListener);
+assert(churnEmitter.emit("churn_1") && churnEmitter.emit("churn_0") === false,
+       "event: a removed event name can be used again");
+
+// one-shot and prepended listeners
+var orderEmitter = new event();
+var order = [];
+orderEmitter.on("order", function () { order.push("on"); });
+orderEmitter.prependListener("order", function () { order.push("first"); });
+orderEmitter.once("order", function () { order.push("once"); });
+orderEmitter.prependOnceListener("order", function () {
+    order.push("firstOnce");
+});
+assert(orderEmitter.listenerCount("order") === 4,
+       "event: once and prepend add listeners");
+orderEmitter.emit("order");
+orderEmitter.emit("order");
+assert(order.join() === "firstOnce,first,on,once,first,on",
+       "event: prepend order and one-shot listeners");
+assert(orderEmitter.listenerCount("order") === 2,
+       "event: one-shot listeners removed after emit");
+
+var nestedCount = 0;
+orderEmitter.once("nested", function () {
+    nestedCount++;
+    orderEmitter.emit("nested");
+});
+orderEmitter.emit("nested");
+assert(nestedCount === 1, "event: one-shot listener not called by nested emit");
+
+// listeners added or removed during an emit don't affect that emit
+var snapshot = [];
+function snapshotB() { snapshot.push("b"); }
+function snapshotC() { snapshot.push("c"); }
+orderEmitter.on("snapshot", function () {
+    snapshot.push("a");
+    orderEmitter.removeListener("snapshot", snapshotB);
+    orderEmitter.on("snapshot", snapshotC);
+});
+orderEmitter.on("snapshot", snapshotB);
+orderEmitter.emit("snapshot");
+assert(snapshot.join() === "a,b", "event: emit calls a snapshot");
+snapshot = [];
+orderEmitter.removeAllListeners("snapshot");
+orderEmitter.on("snapshot", snapshotC);
+orderEmitter.on("snapshot", snapshotC);
+orderEmitter.removeListener("snapshot", snapshotC);
+orderEmitter.emit("snapshot");
+assert(snapshot.join() === "c", "event: remove one instance of a listener");
+
 // event response time is about 10 ms
 var OldlistenerNum, NewlistenerNum;
 setTimeout(function() {
@@ -0,0 +1,68 @@
+// Copyright (c) 2018, Intel Corporation.
+
+console.log("Test setImmediate, clearImmediate and process.nextTick");
+
+var assert = require("Assert.js");
+
+var order = [];
+
+var id = setImmediate(function (a, b) {
+    order.push("immediate");
+    assert(a === 1 && b === "two", "setImmediate: args passed");
+    process.nextTick(function () {
+        order.push("tick from immediate");
+    });
+    setImmediate(function () {
+        order.push("next immediate");
+    });
+}, 1, "two");
+assert(typeof id === "number", "setImmediate: returns an ID");
+
+var cleared = setImmediate(function () {
+    assert(false, "clearImmediate: cancelled immediate runs");
+});
+clearImmediate(cleared);
+clearImmediate(cleared);
+clearImmediate();
+
+process.nextTick(function (a) {
+    order.push("tick");
+    assert(a === 3, "nextTick: args passed");
+    process.nextTick(function () {
+        order.push("nested tick");
+    });
+}, 3);
+
+setTimeout(function () {
+    order.push("timeout");
+}, 0);
+
+Promise.resolve().then(function () {
+    order.push("promise");
+});
+
+order.push("script");
+
+setTimeout(function () {
+    assert.equal(order[0], "script", "nextTick: runs after the script");
+    assert.equal(order[1], "tick", "nextTick: runs first");
+    assert.equal(order[2], "nested tick", "nextTick: nested ticks run too");
+    var immediate = order.indexOf("immediate");
+    var tick = order.indexOf("tick from immediate");
+    var next = order.indexOf("next immediate");
+    assert(immediate > 0 && tick === immediate + 1,
+           "nextTick: queued from an immediate runs right after it");
+    assert(order.indexOf("promise") > tick,
+           "nextTick: runs before promise jobs");
+    assert(next > tick, "setImmediate: queued from an immediate waits");
+    assert.equal(order.length, 8, "setImmediate: cleared immediate skipped");
+
+    assert.throws(function () {
+        setImmediate(5);
+    }, "setImmediate: requires a function");
+    assert.throws(function () {
+        process.nextTick();
+    }, "nextTick: requires a function");
+
+    assert.result();
+}, 100);
@@ -0,0 +1,52 @@
+// Copyright (c) 2018, Intel Corporation.
+
+console.log("Test event loop phase stats");
+
+var performance = require("performance");
+var assert = require("Assert.js");
+
+var phases = ["callbacks", "timers", "routines", "immediates", "jobs",
+              "idle"];
+
+var start = performance.eventLoopUtilization();
+assert(typeof start.idle === "number" && typeof start.active === "number",
+       "loop: utilization has idle and active times");
+
+function busy(ms) {
+    var end = performance.now() + ms;
+    while (performance.now() < end) {}
+}
+
+setTimeout(function () {
+    busy(50);
+}, 10);
+
+setTimeout(function () {
+    var stats = performance.eventLoopStats();
+    assert(stats.iterations > 0, "loop: iterations counted");
+    for (var i = 0; i < phases.length; i++) {
+        var phase = stats[phases[i]];
+        assert(typeof phase.count === "number" && phase.count > 0,
+               "loop: " + phases[i] + " phase counted");
+        assert(phase.min <= phase.p50 && phase.p50 <= phase.p90 &&
+               phase.p90 <= phase.p99 && phase.p99 <= phase.max,
+               "loop: " + phases[i] + " percentiles ordered");
+    }
+    assert(stats.timers.max >= 40, "loop: busy timer recorded");
+    assert(stats.idle.total > 0, "loop: idle time recorded");
+
+    var now = performance.eventLoopUtilization();
+    var elu = performance.eventLoopUtilization(start);
+    assert(elu.active >= 40, "loop: busy time counted as active");
+    assert(elu.utilization > 0 && elu.utilization <= 1,
+           "loop: utilization is a fraction");
+
+    var between = performance.eventLoopUtilization(start, now);
+    assert(between.active <= now.active, "loop: delta between two results");
+
+    assert.throws(function () {
+        performance.eventLoopUtilization(5);
+    }, "loop: non-object argument throws");
+
+    assert.result();
+}, 200);
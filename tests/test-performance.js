@@ -5,6 +5,25 @@ var assert = require("Assert.js");
 
 var before = performance.now();
 
+assert(typeof performance.timeOrigin === "number",
+       "performance.timeOrigin: is a number");
+
+// hrtime is monotonic and counts whole nanoseconds
+var hr = process.hrtime();
+assert(hr.length === 2 && hr[1] >= 0 && hr[1] < 1e9,
+       "process.hrtime: returns [seconds, nanoseconds]");
+var ns = process.hrtime.bigint();
+var ns2 = process.hrtime.bigint();
+assert(ns2 >= ns, "process.hrtime.bigint: monotonic");
+var diff = process.hrtime(hr);
+assert(diff[0] === 0 && diff[1] >= 0,
+       "process.hrtime: difference from an earlier result");
+diff = process.hrtime([hr[0] + 1e6, 0]);
+assert(diff[0] === 0 && diff[1] === 0, "process.hrtime: later time gives 0");
+assert.throws(function() {
+    process.hrtime([NaN, -1]);
+}, "process.hrtime: rejects a malformed time");
+
 setTimeout(function() {
     var after = performance.now();
     var diff = after - before;
@@ -0,0 +1,39 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// Testing require.cache
+
+var assert = require("Assert.js");
+
+assert(typeof require.cache === "object" &&
+       require.cache["Assert"] === assert,
+       "require: loaded module is cached by canonical name");
+assert(require("Assert.js") === assert,
+       "require: same exports returned again");
+assert(require("Assert") === assert &&
+       require("./modules/Assert.js") === assert,
+       "require: every spelling of a module shares one entry");
+
+var events = require("events");
+assert(require("events") === events, "require: native module cached");
+
+// load once, then hit the cache
+delete require.cache["Assert"];
+var before = require.getCacheStats();
+for (var i = 0; i < 1000; i++) {
+    require("Assert.js");
+}
+var after = require.getCacheStats();
+assert(after.misses - before.misses === 1 && after.hits - before.hits === 999,
+       "require: 1000 requires load the module once");
+assert(after.reads - before.reads <= 1,
+       "require: 1000 requires read the file at most once");
+assert(require("Assert.js") !== assert,
+       "require: deleting the cache entry reloads the module");
+
+assert.throws(function () {
+    require("no-such-module.js");
+}, "require: missing module throws");
+assert(require.cache["no-such-module"] === undefined,
+       "require: missing module not cached");
+
+assert.result();
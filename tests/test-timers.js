@@ -80,6 +80,58 @@ assert.throws(function () {
     clearTimeout(NotExistedTimeoutID);
 }, "clearTimeout: timeoutID does not exist");
 
+// test timer IDs are small integers, and a stale ID can't clear a new timer
+assert(typeof testTimeoutID === "number" &&
+       testTimeoutID === Math.floor(testTimeoutID),
+       "setTimeout: returns an integer ID");
+var staleFired = false;
+var staleID = setTimeout(function () {
+    clearTimeout(staleID);
+    var fresh = setTimeout(function () {
+        staleFired = true;
+    }, 10);
+    clearTimeout(staleID);
+    assert(fresh !== staleID, "setTimeout: finished timer ID not reused");
+}, 10);
+
+// a legacy timer wrapper that converts to its ID still clears it
+var wrappedFlag = true;
+var wrapped = setTimeout(function () {
+    wrappedFlag = false;
+}, 100);
+clearTimeout({ valueOf: function () { return wrapped; } });
+
+setTimeout(function () {
+    assert(staleFired, "clearTimeout: stale ID ignored");
+    assert(wrappedFlag, "clearTimeout: object converted to ID");
+}, 1500);
+
+// test timer slack: a timer may run late, but never early
+assert(process.getTimerSlack() === 0, "timer slack: default is zero");
+process.setTimerSlack(30);
+assert(process.getTimerSlack() === 30, "timer slack: set default");
+var slackStart = Date.now();
+setTimeout(function () {
+    var elapsed = Date.now() - slackStart;
+    assert(elapsed >= 200, "timer slack: timer not early");
+}, 200);
+process.setTimerSlack(0);
+
+var slackFired = 0;
+var slackInterval = setInterval(function () {
+    if (++slackFired === 3) {
+        clearInterval(slackInterval);
+    }
+}, 100);
+setTimerSlack(slackInterval, 50);
+
+setTimeout(function () {
+    assert(slackFired === 3, "timer slack: interval keeps its schedule");
+    var stats = process.getTimerStats();
+    assert(stats.fired >= stats.wakeups && stats.wakeups > 0,
+           "timer slack: stats count fired timers and wakeups");
+}, 1500);
+
 setTimeout(function () {
     assert.result();
 }, 2000);
@@ -0,0 +1,44 @@
+// Copyright (c) 2018, Intel Corporation.
+
+// CMD: node test-ws-latency-client.js [count]
+// Sends messages one at a time to tests/stress/test-ws-latency.js and reports
+// round trip times.
+
+var WebSocket = require("ws");
+
+var total = parseInt(process.argv[2]) || 200;
+var times = [];
+var sent;
+
+var ws = new WebSocket("ws://192.0.2.1:8080");
+
+function next() {
+    sent = process.hrtime();
+    ws.send("ping " + times.length);
+}
+
+ws.on("open", next);
+
+ws.on("message", function(data) {
+    var diff = process.hrtime(sent);
+    times.push(diff[0] * 1e3 + diff[1] / 1e6);
+    if (times.length < total) {
+        next();
+        return;
+    }
+
+    ws.close();
+    times.sort(function(a, b) { return a - b; });
+    var sum = times.reduce(function(a, b) { return a + b; }, 0);
+    function pct(p) {
+        return times[Math.min(times.length - 1,
+                              Math.floor(times.length * p / 100))].toFixed(3);
+    }
+    console.log(total + " round trips: mean " + (sum / total).toFixed(3) +
+                " ms, p50 " + pct(50) + " ms, p99 " + pct(99) + " ms, max " +
+                times[times.length - 1].toFixed(3) + " ms");
+});
+
+ws.on("error", function(error) {
+    console.log("error: " + error.message);
+});